@@ -2,6 +2,7 @@
 #define SETTINGS_H
 
 #include <string>
+#include <algorithm>
 #include <fstream>
 #include <filesystem>
 #include <nlohmann/json.hpp>
@@ -13,6 +14,18 @@ struct Settings {
     float ui_font_size = 15.0f;
     float editor_font_size = 18.0f;
 
+    // Playback device; zeros leave the choice to the device and backend
+    unsigned int audio_sample_rate = 0;
+    unsigned int audio_period_frames = 0;
+    unsigned int audio_periods = 0;
+    float audio_render_ahead_ms = 100.0f;
+    float audio_crossfade_ms = 20.0f; // Between songs, 0 = cut
+    bool audio_adaptive_quality = true;
+    int audio_max_voices = 256; // 0 = unlimited
+    int audio_voice_stealing = 0; // VoiceStealing: OLDEST, QUIETEST, SAME_INSTRUMENT
+    bool live_updates = true;
+    int live_update_boundary = 2; // SwapBoundary: NEXT_BLOCK, BEAT, BAR
+
     static Settings load(const std::string& filename = "settings.json") {
         Settings s;
         if (fs::exists(filename)) {
@@ -22,9 +35,22 @@ struct Settings {
                 in >> j;
                 if (j.contains("ui_font_size")) s.ui_font_size = j["ui_font_size"];
                 if (j.contains("editor_font_size")) s.editor_font_size = j["editor_font_size"];
+                if (j.contains("audio_sample_rate")) s.audio_sample_rate = j["audio_sample_rate"];
+                if (j.contains("audio_period_frames")) s.audio_period_frames = j["audio_period_frames"];
+                if (j.contains("audio_periods")) s.audio_periods = j["audio_periods"];
+                if (j.contains("audio_render_ahead_ms")) s.audio_render_ahead_ms = j["audio_render_ahead_ms"];
+                if (j.contains("audio_crossfade_ms")) s.audio_crossfade_ms = j["audio_crossfade_ms"];
+                if (j.contains("audio_adaptive_quality")) s.audio_adaptive_quality = j["audio_adaptive_quality"];
+                if (j.contains("audio_max_voices")) s.audio_max_voices = j["audio_max_voices"];
+                if (j.contains("audio_voice_stealing")) s.audio_voice_stealing = j["audio_voice_stealing"];
+                if (j.contains("live_updates")) s.live_updates = j["live_updates"];
+                if (j.contains("live_update_boundary")) s.live_update_boundary = j["live_update_boundary"];
             } catch (...) {
                 // Fallback to defaults on parse error
             }
+            // Cast straight to enums, so keep a hand-edited file within their values
+            s.audio_voice_stealing = std::clamp(s.audio_voice_stealing, 0, 2);
+            s.live_update_boundary = std::clamp(s.live_update_boundary, 0, 2);
         }
         return s;
     }
@@ -33,6 +59,16 @@ struct Settings {
         json j;
         j["ui_font_size"] = ui_font_size;
         j["editor_font_size"] = editor_font_size;
+        j["audio_sample_rate"] = audio_sample_rate;
+        j["audio_period_frames"] = audio_period_frames;
+        j["audio_periods"] = audio_periods;
+        j["audio_render_ahead_ms"] = audio_render_ahead_ms;
+        j["audio_crossfade_ms"] = audio_crossfade_ms;
+        j["audio_adaptive_quality"] = audio_adaptive_quality;
+        j["audio_max_voices"] = audio_max_voices;
+        j["audio_voice_stealing"] = audio_voice_stealing;
+        j["live_updates"] = live_updates;
+        j["live_update_boundary"] = live_update_boundary;
         std::ofstream out(filename);
         out << j.dump(4);
     }
@@ -30,6 +30,8 @@
 #include <functional>
 #include <algorithm>
 #include <cmath>
+#include <future>
+#include <chrono>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../third_party/stb_image.h"
@@ -50,6 +52,10 @@ struct EditorTab {
     double last_parse_time = 0;
     int last_cursor_line = -1;
     double last_text_change_time = 0;
+    // Its script is what plays, so edits go live (see AudioPlayer::update_song)
+    bool is_live = false;
+    bool live_edit_pending = false;
+    std::future<Song> live_parse;
 };
 
 void load_fonts(AppFonts& fonts, float ui_size, float editor_size, bool update_texture = true) {
@@ -435,8 +441,22 @@ int main(int, char**) {
 
     // Museq Engine State
     AudioPlayer player;
-    bool player_initialized = player.init();
-    char status_text[128] = "Status: Ready";
+    auto init_player = [&]() {
+        AudioDeviceConfig device_config;
+        device_config.sample_rate = settings.audio_sample_rate;
+        device_config.period_frames = settings.audio_period_frames;
+        device_config.periods = settings.audio_periods;
+        player.set_render_ahead_ms(settings.audio_render_ahead_ms);
+        player.set_adaptive_quality(settings.audio_adaptive_quality);
+        player.set_max_polyphony(static_cast<size_t>((std::max)(0, settings.audio_max_voices)), static_cast<VoiceStealing>(settings.audio_voice_stealing));
+        player.set_crossfade_ms(settings.audio_crossfade_ms);
+        player.set_track_scopes(true);
+        return player.init(device_config);
+    };
+    bool player_initialized = init_player();
+    player.set_instrument_profiling(true); // For the per-instrument DSP load tooltip
+    DspStats dsp_stats;
+    char status_text[256] = "Status: Ready";
     Song last_parsed_song;
 
     // Helper to find the active line from a SongElement tree
@@ -495,6 +515,29 @@ int main(int, char**) {
         return -1;
     };
 
+    // Earliest time an element written on 'line' starts playing, or -1 if nothing on that line plays
+    std::function<double(std::shared_ptr<SongElement>, int, double)> find_line_start;
+    find_line_start = [&](std::shared_ptr<SongElement> element, int line, double parent_offset_ms) -> double {
+        if (!element) return -1;
+
+        double absolute_start = parent_offset_ms + element->start_offset_ms;
+        if (element->source_line == line) return absolute_start;
+
+        auto comp = std::dynamic_pointer_cast<CompositeElement>(element);
+        if (!comp) return -1;
+
+        double running_offset = absolute_start;
+        for (auto& child : comp->children) {
+            if (!child) continue;
+            // Parallel and loop children all start with their block; sequential ones follow each other
+            double child_parent = (comp->type == CompositeType::SEQUENTIAL) ? running_offset : absolute_start;
+            double start = find_line_start(child, line, child_parent);
+            if (start >= 0) return start;
+            running_offset += child->start_offset_ms + child->get_duration_ms();
+        }
+        return -1;
+    };
+
     // Museq State
     std::vector<EditorTab> tabs;
     int active_tab_index = 0;
@@ -512,7 +555,7 @@ int main(int, char**) {
 
     // Effects (Mapped to PreprocIdentifier) - Cyan
     static const std::vector<std::string> effects_keywords = {
-        "delay", "distortion", "reverb", "bitcrush", "fadein", "fadeout", "tremolo", "effect"
+        "delay", "distortion", "reverb", "bitcrush", "fadein", "fadeout", "tremolo", "convolve", "chorus", "flanger", "effect"
     };
     for (auto& e : effects_keywords) {
         TextEditor::Identifier id;
@@ -522,7 +565,7 @@ int main(int, char**) {
 
     // Synthesizer / Parameters (Mapped to KnownIdentifier) - Purple
     static const std::vector<std::string> synth_keywords = {
-        "waveform", "envelope", "filter", "lfo", "gain", "pan", "bank", "preset", "portamento", 
+        "waveform", "envelope", "filter", "lfo", "gain", "pan", "bank", "preset", "portamento", "polyphony", "oldest", "quietest",
         "sine", "square", "triangle", "sawtooth", "noise",
         "lowpass", "highpass", "bandpass", "notch", "peak", "lshelf", "hshelf",
         "pitch", "amplitude", "cutoff",
@@ -578,12 +621,21 @@ int main(int, char**) {
     };
 
     // Helper for Play logic
-    auto play_logic = [&]() {
+    auto play_logic = [&](bool from_cursor = false) {
         if (player_initialized && !tabs.empty()) {
             auto& tab = current_tab();
             tab.last_parsed_song = ScriptParser::parse_string(tab.editor.GetText());
-            player.play(tab.last_parsed_song);
+            double start_ms = 0.0;
+            if (from_cursor) {
+                // Editor lines are 0-based, source lines 1-based
+                int line = tab.editor.GetCursorPosition().mLine + 1;
+                start_ms = (std::max)(0.0, find_line_start(tab.last_parsed_song.root, line, 0));
+            }
+            player.play(tab.last_parsed_song, false, start_ms);
             is_playing_preview = false;
+            for (auto& other : tabs) other.is_live = false;
+            tab.is_live = true;
+            tab.live_edit_pending = false;
         }
     };
 
@@ -928,7 +980,7 @@ int main(int, char**) {
         }
         if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_P)) {
             if (player.is_playing()) player.stop();
-            else play_logic();
+            else play_logic(io.KeyShift);
         }
         if (io.KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_S)) {
             close_all_popups();
@@ -953,6 +1005,19 @@ int main(int, char**) {
             if (tab.editor.IsTextChanged()) {
                 tab.last_text_change_time = ImGui::GetTime();
                 tab.is_dirty = true;
+                tab.live_edit_pending = tab.is_live;
+            }
+
+            // Live edits: the playing script is parsed off the UI thread, and the player swaps the
+            // changed parts in at the next beat or bar. Scripts with errors keep the last good version playing.
+            bool live = settings.live_updates && tab.is_live && !is_playing_preview && player.is_playing();
+            if (tab.live_parse.valid() && tab.live_parse.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                Song edited = tab.live_parse.get();
+                if (live && edited.errors.empty()) player.update_song(edited, static_cast<SwapBoundary>(settings.live_update_boundary));
+            }
+            if (live && tab.live_edit_pending && !tab.live_parse.valid() && ImGui::GetTime() - tab.last_text_change_time > 0.3) {
+                tab.live_edit_pending = false;
+                tab.live_parse = std::async(std::launch::async, [text = tab.editor.GetText()]() { return ScriptParser::parse_string(text); });
             }
 
             bool should_parse = false;
@@ -989,8 +1054,12 @@ int main(int, char**) {
                 double total = player.get_total_duration_ms();
                 size_t active = player.get_active_voice_count();
                 size_t scheduled = player.get_scheduled_voice_count();
-                
-                snprintf(status_text, sizeof(status_text), "Status: Playing (%.1f/%.1f ms) V:%zu/%zu %s", pos, total, active, scheduled, is_playing_preview ? "[PREVIEW]" : "");
+                dsp_stats = player.get_dsp_stats();
+
+                snprintf(status_text, sizeof(status_text), "Status: Playing (%.1f/%.1f ms) V:%zu/%zu DSP:%.0f%% (max %.0f%%) Late:%llu XRun:%llu %s%s",
+                         pos, total, active, scheduled, dsp_stats.load_avg * 100.0f, dsp_stats.load_max * 100.0f,
+                         static_cast<unsigned long long>(dsp_stats.deadline_misses), static_cast<unsigned long long>(dsp_stats.underruns),
+                         dsp_stats.quality != QualityLevel::FULL ? "[REDUCED QUALITY] " : "", is_playing_preview ? "[PREVIEW]" : "");
                 
                 // Highlight active line (only if not a preview)
                 if (!is_playing_preview) {
@@ -1369,26 +1438,85 @@ int main(int, char**) {
         ImGui::Begin("Visualizer", NULL, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoTitleBar);
         
         float vis_avail_w = ImGui::GetContentRegionAvail().x;
-        ImGui::BeginChild("WaveformView", ImVec2(vis_avail_w * 0.5f, 0));
-        ImGui::TextDisabled("Output Waveform");
-        static float vis_samples[512];
-        player.get_visualization_data(vis_samples, 512);
+        ImGui::BeginChild("WaveformView", ImVec2(vis_avail_w * 0.36f, 0));
+        // Master output or one instrument's mix, left channel above right
+        ScopeBus& scopes = player.get_scope_bus();
+        const ScopeBus::Layout& scope_layout = scopes.read_layout();
+        static int scope_tap = ScopeBus::MASTER;
+        if (scope_tap >= scope_layout.count) scope_tap = ScopeBus::MASTER;
+        ImGui::TextDisabled("Waveform");
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(140);
+        if (ImGui::BeginCombo("##ScopeTap", scope_layout.names[scope_tap])) {
+            for (int i = 0; i < scope_layout.count; ++i) {
+                if (ImGui::Selectable(scope_layout.names[i], i == scope_tap)) scope_tap = i;
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(100);
+        int scope_zoom = scopes.tap(scope_tap).get_decimation();
+        if (ImGui::SliderInt("Zoom", &scope_zoom, 1, 16)) scopes.tap(scope_tap).set_decimation(scope_zoom);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Keep every n-th frame, so the view spans n times as long");
+
+        static float scope_frames[512 * 2];
+        static float scope_left[512], scope_right[512];
+        int scope_count = scopes.tap(scope_tap).snapshot(scope_frames, 512);
+        for (int i = 0; i < 512; ++i) {
+            // Right-aligned, so the newest frame is always last
+            int src = i - (512 - scope_count);
+            scope_left[i] = src >= 0 ? scope_frames[src * 2] : 0.0f;
+            scope_right[i] = src >= 0 ? scope_frames[src * 2 + 1] : 0.0f;
+        }
+        float scope_height = (ImGui::GetContentRegionAvail().y - ImGui::GetStyle().ItemSpacing.y) * 0.5f;
         ImGui::PushStyleColor(ImGuiCol_PlotLines, ImVec4(0.0f, 0.8f, 1.0f, 1.0f));
-        ImGui::PlotLines("##Waveform", vis_samples, IM_ARRAYSIZE(vis_samples), 0, NULL, -1.0f, 1.0f, ImVec2(-FLT_MIN, -FLT_MIN));
+        ImGui::PlotLines("##WaveformLeft", scope_left, 512, 0, NULL, -1.0f, 1.0f, ImVec2(-FLT_MIN, scope_height));
+        ImGui::PlotLines("##WaveformRight", scope_right, 512, 0, NULL, -1.0f, 1.0f, ImVec2(-FLT_MIN, scope_height));
         ImGui::PopStyleColor();
         ImGui::EndChild();
 
         ImGui::SameLine();
 
-        ImGui::BeginChild("SpectrumView", ImVec2(0, 0));
+        ImGui::BeginChild("SpectrumView", ImVec2(vis_avail_w * 0.36f, 0));
         ImGui::TextDisabled("Spectrum Analyzer");
-        static float spec_samples[256];
-        player.get_spectrum_data(spec_samples, 256);
+        static float spec_samples[96];
+        player.get_spectrum_bands(spec_samples, IM_ARRAYSIZE(spec_samples));
+        // Log-spaced bands from 20 Hz to 20 kHz, in dB above -80 dBFS
+        for (float& band : spec_samples) band = (std::max)(0.0f, 80.0f + 20.0f * std::log10(band + 1e-9f));
         ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ImVec4(1.0f, 0.6f, 0.0f, 1.0f));
-        ImGui::PlotHistogram("##Spectrum", spec_samples, IM_ARRAYSIZE(spec_samples), 0, NULL, 0.0f, 0.05f, ImVec2(-FLT_MIN, -FLT_MIN));
+        ImGui::PlotHistogram("##Spectrum", spec_samples, IM_ARRAYSIZE(spec_samples), 0, NULL, 0.0f, 80.0f, ImVec2(-FLT_MIN, -FLT_MIN));
         ImGui::PopStyleColor();
         ImGui::EndChild();
 
+        ImGui::SameLine();
+
+        // Mixer meters: bars show short-term loudness from -60 LUFS up, red once a peak clips
+        ImGui::BeginChild("LevelsView", ImVec2(0, 0));
+        ImGui::TextDisabled("Levels");
+        const LevelReport& levels = player.get_levels();
+        auto level_row = [](const char* name, const Levels& level) {
+            float fraction = (std::max)(0.0f, (std::min)(1.0f, (level.short_term_lufs + 60.0f) / 60.0f));
+            float peak_db = level.peak > 1e-6f ? 20.0f * std::log10(level.peak) : -120.0f;
+            char overlay[48];
+            snprintf(overlay, sizeof(overlay), "%.1f LUFS  %.1f dB", level.short_term_lufs, peak_db);
+            ImGui::TextUnformatted(name);
+            ImGui::SameLine(90);
+            bool clipped = level.max_peak >= 1.0f;
+            ImGui::PushStyleColor(ImGuiCol_PlotHistogram, clipped ? ImVec4(0.9f, 0.2f, 0.2f, 1.0f) : ImVec4(0.2f, 0.8f, 0.3f, 1.0f));
+            ImGui::ProgressBar(fraction, ImVec2(-FLT_MIN, 0), overlay);
+            ImGui::PopStyleColor();
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Momentary %.1f LUFS, integrated %.1f LUFS\nRMS %.1f dBFS, max peak %.1f dBFS",
+                                  level.momentary_lufs, level.integrated_lufs,
+                                  level.rms > 1e-6f ? 20.0f * std::log10(level.rms) : -120.0f,
+                                  level.max_peak > 1e-6f ? 20.0f * std::log10(level.max_peak) : -120.0f);
+            }
+        };
+        level_row("Master", levels.master);
+        ImGui::Separator();
+        for (int i = 0; i < levels.track_count; ++i) level_row(levels.tracks[i].name, levels.tracks[i].levels);
+        ImGui::EndChild();
+
         ImGui::End();
 
         // --- 4. FOOTER (Transport Toolbar) ---
@@ -1399,6 +1527,19 @@ int main(int, char**) {
         // Group Left: Status
         ImGui::AlignTextToFramePadding();
         ImGui::Text("%s", status_text);
+        if (ImGui::IsItemHovered() && player.is_playing()) {
+            ImGui::BeginTooltip();
+            ImGui::Text("DSP load %.1f%% avg, %.1f%% min, %.1f%% max", dsp_stats.load_avg * 100.0f, dsp_stats.load_min * 100.0f, dsp_stats.load_max * 100.0f);
+            ImGui::Text("Callback %.1f%% of its period, %.2f%% per voice", dsp_stats.callback_load_max * 100.0f, dsp_stats.load_per_voice * 100.0f);
+            ImGui::Text("Buffered %.0f ms, output latency %.1f ms (device %.1f ms)", player.get_buffered_ms(), player.get_output_latency_ms(),
+                        player.get_device_latency_ms());
+            ImGui::Text("Quality: %s, %llu voices stolen", QualityGovernor::get_level_name(dsp_stats.quality), static_cast<unsigned long long>(dsp_stats.stolen_voices));
+            if (dsp_stats.instrument_count > 0) ImGui::Separator();
+            for (int i = 0; i < dsp_stats.instrument_count; ++i) {
+                ImGui::Text("%-24s %5.1f%%", dsp_stats.instruments[i].name, dsp_stats.instruments[i].load * 100.0f);
+            }
+            ImGui::EndTooltip();
+        }
         ImGui::SameLine();
         ImGui::TextDisabled("|");
         ImGui::SameLine();
@@ -1408,6 +1549,11 @@ int main(int, char**) {
             play_logic();
         }
         ImGui::SameLine();
+        if (ImGui::Button("[ >| ] Cursor", ImVec2(90, 0))) {
+            play_logic(true);
+        }
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Play from the line under the cursor (Ctrl+Shift+P)");
+        ImGui::SameLine();
         if (ImGui::Button("[ || ] Stop", ImVec2(80, 0))) {
             player.stop();
         }
@@ -1612,9 +1758,65 @@ int main(int, char**) {
                 settings.editor_font_size = std::clamp(settings.editor_font_size, 10.0f, 40.0f);
             }
 
+            ImGui::Spacing();
+            ImGui::Text("Audio Device");
+            ImGui::Separator();
+
+            const unsigned int rates[] = { 0, 44100, 48000, 88200, 96000 };
+            const char* rate_names[] = { "Native", "44100 Hz", "48000 Hz", "88200 Hz", "96000 Hz" };
+            int rate_idx = 0;
+            for (int i = 0; i < IM_ARRAYSIZE(rates); ++i) {
+                if (rates[i] == settings.audio_sample_rate) rate_idx = i;
+            }
+            if (ImGui::Combo("Sample Rate", &rate_idx, rate_names, IM_ARRAYSIZE(rate_names))) {
+                settings.audio_sample_rate = rates[rate_idx];
+            }
+
+            const unsigned int periods[] = { 0, 64, 128, 256, 512, 1024, 2048 };
+            const char* period_names[] = { "Default", "64 frames", "128 frames", "256 frames", "512 frames", "1024 frames", "2048 frames" };
+            int period_idx = 0;
+            for (int i = 0; i < IM_ARRAYSIZE(periods); ++i) {
+                if (periods[i] == settings.audio_period_frames) period_idx = i;
+            }
+            if (ImGui::Combo("Period Size", &period_idx, period_names, IM_ARRAYSIZE(period_names))) {
+                settings.audio_period_frames = periods[period_idx];
+            }
+
+            int period_count = static_cast<int>(settings.audio_periods);
+            if (ImGui::SliderInt("Periods", &period_count, 0, 8, period_count == 0 ? "Default" : "%d")) {
+                settings.audio_periods = static_cast<unsigned int>(period_count);
+            }
+            ImGui::SliderFloat("Render Ahead", &settings.audio_render_ahead_ms, 10.0f, 500.0f, "%.0f ms");
+            ImGui::SliderFloat("Crossfade", &settings.audio_crossfade_ms, 0.0f, 500.0f, settings.audio_crossfade_ms == 0.0f ? "Off" : "%.0f ms");
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("Fade from the playing song into the next one when switching or restarting playback.");
+            ImGui::Checkbox("Reduce quality when overloaded", &settings.audio_adaptive_quality);
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("Cheaper oscillators and filters, shorter tails and dropped quiet voices\nwhile rendering falls behind. Export always renders at full quality.");
+            ImGui::SliderInt("Max Voices", &settings.audio_max_voices, 0, 512, settings.audio_max_voices == 0 ? "Unlimited" : "%d");
+            const char* stealing_names[] = { "Oldest", "Quietest", "Same Instrument" };
+            ImGui::Combo("Voice Stealing", &settings.audio_voice_stealing, stealing_names, IM_ARRAYSIZE(stealing_names));
+            ImGui::Checkbox("Live edits", &settings.live_updates);
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("While a script plays, apply edits to it without restarting.\nUnchanged parts play on; the rest switches over at the chosen boundary.");
+            const char* boundary_names[] = { "Immediately", "Next Beat", "Next Bar" };
+            ImGui::Combo("Live Edit Boundary", &settings.live_update_boundary, boundary_names, IM_ARRAYSIZE(boundary_names));
+
+            if (player_initialized) {
+                ImGui::TextDisabled("Current: %.0f Hz, %u x %u frames, %.1f ms device latency", player.get_device_rate(),
+                                    player.get_periods(), player.get_period_frames(), player.get_device_latency_ms());
+            }
+
             ImGui::Separator();
             if (ImGui::Button("Apply", ImVec2(120, 0))) {
+                Settings previous = Settings::load();
                 settings.save();
+                // Reopening the device stops playback, so only when its setup changed
+                if (previous.audio_sample_rate != settings.audio_sample_rate || previous.audio_period_frames != settings.audio_period_frames ||
+                    previous.audio_periods != settings.audio_periods || !player_initialized) {
+                    player_initialized = init_player();
+                }
+                player.set_render_ahead_ms(settings.audio_render_ahead_ms);
+                player.set_adaptive_quality(settings.audio_adaptive_quality);
+                player.set_max_polyphony(static_cast<size_t>((std::max)(0, settings.audio_max_voices)), static_cast<VoiceStealing>(settings.audio_voice_stealing));
+                player.set_crossfade_ms(settings.audio_crossfade_ms);
                 rebuild_fonts = true;
                 show_settings_popup = false;
                 ImGui::CloseCurrentPopup();
@@ -7,54 +7,60 @@
 #include <iostream>
 #include <cstring>
 #include <algorithm>
-#include <complex>
 #include <vector>
 #include <cmath>
+#include <chrono>
 
 namespace {
-    const double PI = 3.14159265358979323846;
-
-    // Iterative FFT for better performance
-    void fft_iterative(std::vector<std::complex<double>>& a) {
-        int n = a.size();
-        for (int i = 1, j = 0; i < n; i++) {
-            int bit = n >> 1;
-            for (; j & bit; bit >>= 1) j ^= bit;
-            j ^= bit;
-            if (i < j) std::swap(a[i], a[j]);
-        }
-        for (int len = 2; len <= n; len <<= 1) {
-            double ang = 2 * PI / len;
-            std::complex<double> wlen(cos(ang), sin(ang));
-            for (int i = 0; i < n; i += len) {
-                std::complex<double> w(1);
-                for (int j = 0; j < len / 2; j++) {
-                    std::complex<double> u = a[i + j], v = a[i + j + len / 2] * w;
-                    a[i + j] = u + v;
-                    a[i + j + len / 2] = u - v;
-                    w *= wlen;
-                }
-            }
-        }
-    }
+    // Render blocks follow the device period between these, so small periods keep the ring short
+    const int MIN_RENDER_BLOCK_FRAMES = 64;
+    const int MAX_RENDER_BLOCK_FRAMES = 512;
+    // Spectrum analysis reads the output in chunks of this size
+    const int ANALYSIS_BLOCK_FRAMES = 512;
 }
 
 AudioPlayer::AudioPlayer() {
     m_device = new ma_device;
+    set_render_rate(DEFAULT_RENDER_RATE);
+    set_adaptive_quality(true);
+    set_max_polyphony(DEFAULT_MAX_POLYPHONY);
+    set_metering(true);
 }
 
 AudioPlayer::~AudioPlayer() {
+    if (m_loader_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_loader_mutex);
+            m_loader_running = false;
+        }
+        m_loader_cv.notify_one();
+        m_loader_thread.join();
+    }
+    if (m_render_thread.joinable()) {
+        m_render_thread_running = false;
+        m_render_thread.join();
+    }
     if (m_device) {
-        ma_device_uninit((ma_device*)m_device);
+        if (m_device_initialized) ma_device_uninit((ma_device*)m_device);
         delete (ma_device*)m_device;
     }
 }
 
-bool AudioPlayer::init() {
+bool AudioPlayer::init(const AudioDeviceConfig& device_config) {
+    if (m_device_initialized) {
+        stop();
+        ma_device_uninit((ma_device*)m_device);
+        m_device_initialized = false;
+    }
+
     ma_device_config config = ma_device_config_init(ma_device_type_playback);
     config.playback.format   = ma_format_f32;
     config.playback.channels = 2;
-    config.sampleRate        = 44100;
+    config.sampleRate        = device_config.sample_rate; // 0: native; the renderer converts to it
+    config.periodSizeInFrames = device_config.period_frames;
+    config.periods           = device_config.periods;
+    config.performanceProfile = ma_performance_profile_low_latency;
+    config.noPreSilencedOutputBuffer = MA_TRUE; // The callback writes every sample
     config.dataCallback      = data_callback;
     config.pUserData         = this;
 
@@ -62,81 +68,288 @@ bool AudioPlayer::init() {
         std::cerr << "Failed to initialize playback device." << std::endl;
         return false;
     }
+    m_device_initialized = true;
+    ma_device* device = (ma_device*)m_device;
+    m_device_rate = static_cast<float>(device->sampleRate);
+    m_period_frames = device->playback.internalPeriodSizeInFrames;
+    m_periods = device->playback.internalPeriods;
+    // The backend's buffer runs at its internal rate; express it in device frames
+    if (device->playback.internalSampleRate != 0 && device->playback.internalSampleRate != device->sampleRate) {
+        m_period_frames = static_cast<unsigned int>(static_cast<double>(m_period_frames) * device->sampleRate / device->playback.internalSampleRate);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_render_mutex);
+        // A backend that doesn't report its period gets the largest block
+        int period = (m_period_frames == 0) ? MAX_RENDER_BLOCK_FRAMES : static_cast<int>((std::min)(m_period_frames, static_cast<unsigned int>(MAX_RENDER_BLOCK_FRAMES)));
+        m_render_block_frames = (std::max)(MIN_RENDER_BLOCK_FRAMES, period);
+    }
+
+    {
+        // The callback is stopped; the render thread may be analyzing
+        std::lock_guard<std::mutex> lock(m_analysis_mutex);
+        m_analyzer.configure(m_spectrum_size, m_spectrum_overlap, m_device_rate);
+        m_analysis_position = m_analysis_tap.get_frames_kept();
+    }
 
+    if (!m_render_thread.joinable()) {
+        m_render_thread_running = true;
+        m_render_thread = std::thread(&AudioPlayer::render_thread_main, this);
+    }
+    if (!m_loader_thread.joinable()) {
+        m_loader_running = true;
+        m_loader_thread = std::thread(&AudioPlayer::loader_thread_main, this);
+    }
     return true;
 }
 
-void AudioPlayer::play(const Song& song, bool is_preview) {
-    stop();
+size_t AudioPlayer::get_render_ahead_frames() const {
+    // Two blocks, so one is still queued while the next renders
+    return (std::max)(static_cast<size_t>(m_render_block_frames) * 2, static_cast<size_t>(m_render_ahead_ms / 1000.0 * m_device_rate));
+}
+
+void AudioPlayer::render_thread_main() {
+    while (m_render_thread_running) {
+        double ahead_ms;
+        {
+            std::lock_guard<std::mutex> lock(m_render_mutex);
+            if (m_playing && !m_flush_requested) fill_ring();
+            ahead_ms = m_render_ahead_frames * 1000.0 / m_device_rate;
+        }
+        analyze_output();
+        // Wake often enough to top the ring up several times per render-ahead distance
+        double wait_ms = (std::max)(1.0, (std::min)(10.0, ahead_ms / 4.0));
+        std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long long>(wait_ms * 1000.0)));
+    }
+}
+
+void AudioPlayer::fill_ring() {
+    try_switch();
+    m_render_block.resize(static_cast<size_t>(m_render_block_frames) * 2);
+    // Top up whenever the ring is below its target; it has room for one block beyond it
+    while (!m_render_done && (m_ring.get_read_available() / 2) < m_render_ahead_frames) {
+        AudioRenderer* renderer = m_switcher.playing();
+        double fill = static_cast<double>(m_ring.get_read_available() / 2) / m_render_ahead_frames;
+        auto start = std::chrono::steady_clock::now();
+        m_switcher.render_block(m_render_block.data(), m_render_block_frames, fill);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (m_load_meter.add_block(seconds, m_render_block_frames, renderer->get_active_voice_count())) {
+            m_load_meter.add_instruments(renderer->take_instrument_costs());
+            m_load_meter.publish();
+        }
+        m_ring.write(m_render_block.data(), m_render_block.size());
+        m_frames_written += m_render_block_frames;
+        if (renderer->is_finished()) m_render_done = true;
+    }
+    // A song shorter than the crossfade ends it early
+    if (m_render_done) m_switcher.end_fade();
+}
+
+void AudioPlayer::try_switch() {
+    AudioRenderer* previous = m_switcher.playing();
+    // Crossfade only out of a song that is still sounding
+    int crossfade_frames = (!m_render_done && m_crossfade_ms > 0.0) ? (std::max)(1, static_cast<int>(m_crossfade_ms / 1000.0 * m_device_rate)) : 0;
+    if (m_switcher.try_switch(m_frames_written, crossfade_frames) != SongSwitcher::SwitchResult::SWITCHED) return;
+
+    AudioRenderer* next = m_switcher.playing();
+    if (m_track_scopes) {
+        previous->set_scope_bus(nullptr);
+        m_scopes.release_tracks();
+        next->set_scope_bus(&m_scopes);
+    }
+    m_render_done = next->is_finished();
+}
+
+void AudioPlayer::wake_loader() {
+    std::lock_guard<std::mutex> lock(m_loader_mutex);
+    m_loader_cv.notify_one();
+}
+
+void AudioPlayer::loader_thread_main() {
+    std::unique_lock<std::mutex> lock(m_loader_mutex);
+    uint64_t updated = 0;
+    while (true) {
+        m_loader_cv.wait(lock, [&] { return !m_loader_running || m_switcher.can_load(m_request.generation) || m_update.generation != updated; });
+        if (!m_loader_running) break;
+        // A new song goes first: it would replace the edited one anyway
+        if (!m_switcher.can_load(m_request.generation)) {
+            UpdateRequest update = m_update;
+            updated = update.generation;
+            lock.unlock();
+            prepare_update(update);
+            lock.lock();
+            continue;
+        }
+        SongSwitcher::Request request = m_request;
+        lock.unlock();
+        m_switcher.load(std::move(request));
+        lock.lock();
+    }
+}
 
-    m_renderer.load(song, 44100);
+void AudioPlayer::prepare_update(const UpdateRequest& update) {
+    AudioRenderer* renderer = m_switcher.playing();
+    std::unique_ptr<SongSwap> swap = renderer->prepare_swap(update.song);
+    // Dropped if a newer edit or another song came along meanwhile, or the song has ended
+    std::lock_guard<std::mutex> lock(m_render_mutex);
+    if (update.generation != m_update_generation || m_switcher.playing() != renderer
+        || m_switcher.is_switch_pending() || m_render_done) {
+        return;
+    }
+    renderer->swap_song(std::move(swap), update.grid_ms);
+}
+
+void AudioPlayer::analyze_output() {
+    std::lock_guard<std::mutex> lock(m_analysis_mutex);
+    if (m_spectrum_config_changed.exchange(false)) {
+        m_analyzer.configure(m_spectrum_size, m_spectrum_overlap, m_device_rate);
+    }
+    // Frames the callback wrote while the render thread was busy for longer than the tap holds are skipped
+    m_analysis_stereo.resize(ANALYSIS_BLOCK_FRAMES * 2);
+    m_analysis_block.resize(ANALYSIS_BLOCK_FRAMES);
+    while (int got = m_analysis_tap.read_since(m_analysis_position, m_analysis_stereo.data(), ANALYSIS_BLOCK_FRAMES)) {
+        for (int i = 0; i < got; ++i) m_analysis_block[i] = (m_analysis_stereo[i * 2] + m_analysis_stereo[i * 2 + 1]) * 0.5f;
+        m_analyzer.push(m_analysis_block.data(), got);
+    }
+}
+
+void AudioPlayer::set_track_scopes(bool enabled) {
+    // Under the render mutex, so it can't race a renderer swap
+    std::lock_guard<std::mutex> lock(m_render_mutex);
+    m_track_scopes = enabled;
+    m_switcher.playing()->set_scope_bus(enabled ? &m_scopes : nullptr);
+}
+
+void AudioPlayer::set_spectrum_analysis(int size, float overlap) {
+    m_spectrum_size = size;
+    m_spectrum_overlap = overlap;
+    m_spectrum_config_changed = true;
+}
+
+void AudioPlayer::play(const Song& song, bool is_preview, double start_ms) {
+    if (!m_playing) {
+        // Nothing is playing: start from an empty pipeline. The device keeps running from here on,
+        // so later songs take over without stopping it.
+        stop();
+        std::lock_guard<std::mutex> lock(m_render_mutex);
+        m_render_ahead_frames = get_render_ahead_frames();
+        m_ring.resize((m_render_ahead_frames + m_render_block_frames) * 2);
+        m_underruns = 0;
+        m_load_meter.reset(m_device_rate);
+        m_position_base_ms = start_ms;
+        m_frames_played = 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_loader_mutex);
+        m_request.song = song;
+        m_request.rate = m_device_rate;
+        m_request.start_ms = start_ms;
+        m_request.is_preview = is_preview;
+        m_request.generation = m_switcher.begin_request();
+    }
+    m_loader_cv.notify_one();
+    // The callback may have just reached the end of the previous song
     m_playing = true;
-    m_is_preview = is_preview;
-    m_preview_samples_elapsed = 0;
 
     if (ma_device_start((ma_device*)m_device) != MA_SUCCESS) {
         std::cerr << "Failed to start playback device." << std::endl;
     }
 }
 
+bool AudioPlayer::update_song(const Song& song, SwapBoundary boundary) {
+    if (!m_playing || m_switcher.is_switch_pending() || m_render_done) return false;
+    double beat_ms = 60000.0 / (std::max)(1, song.bpm);
+    {
+        std::lock_guard<std::mutex> lock(m_loader_mutex);
+        m_update.song = song;
+        m_update.grid_ms = (boundary == SwapBoundary::BAR) ? beat_ms * 4.0 : (boundary == SwapBoundary::BEAT) ? beat_ms : 0.0;
+        m_update.generation = ++m_update_generation;
+    }
+    m_loader_cv.notify_one();
+    return true;
+}
+
+void AudioPlayer::seek(double ms) {
+    std::lock_guard<std::mutex> lock(m_render_mutex);
+    AudioRenderer* renderer = m_switcher.playing();
+    m_switcher.end_fade();
+    renderer->seek(ms);
+    m_render_done = renderer->is_finished();
+    m_position_base_ms = ms;
+    if (m_playing) {
+        // The callback owns the read side: it drops the old audio before the render thread goes on
+        m_flush_requested = true;
+    } else {
+        m_ring.clear();
+        m_frames_played = 0;
+    }
+}
+
 void AudioPlayer::stop() {
     m_playing = false;
-    m_is_preview = false;
-    ma_device_stop((ma_device*)m_device);
+    if (m_device_initialized) ma_device_stop((ma_device*)m_device);
+    m_is_preview = false; // The callback is stopped
+    std::lock_guard<std::mutex> lock(m_render_mutex);
+    m_ring.clear();
+    m_switcher.clear_switches();
+    m_frames_written = 0;
+    m_frames_read = 0;
+    m_flush_requested = false;
+    // Whatever was loading no longer gets played
+    m_render_done = true;
+    m_switcher.cancel();
+}
+
+DspStats AudioPlayer::get_dsp_stats() {
+    DspStats stats = m_load_meter.read();
+    stats.underruns = get_underrun_count();
+    AudioRenderer* renderer = m_switcher.playing();
+    stats.quality = renderer->get_quality_level();
+    stats.stolen_voices = renderer->get_stolen_voice_count();
+    return stats;
 }
 
 bool AudioPlayer::is_playing() const {
-    return m_playing && !m_renderer.is_finished();
+    return m_playing;
 }
 
 double AudioPlayer::get_playback_position_ms() const {
-    return m_renderer.get_current_time_ms();
+    // What the device has played, not what has been rendered ahead of it
+    double played = m_flush_requested ? 0.0 : m_frames_played * 1000.0 / m_device_rate;
+    return m_position_base_ms + played;
 }
 
 double AudioPlayer::get_total_duration_ms() const {
-    return m_renderer.get_total_duration_ms();
+    return m_switcher.playing()->get_total_duration_ms();
 }
 
 size_t AudioPlayer::get_active_voice_count() const {
-    return m_renderer.get_active_voice_count();
+    return m_switcher.playing()->get_active_voice_count();
 }
 
 size_t AudioPlayer::get_scheduled_voice_count() const {
-    return m_renderer.get_scheduled_voice_count();
+    return m_switcher.playing()->get_scheduled_voice_count();
 }
 
 void AudioPlayer::get_visualization_data(float* out_buffer, int count) {
-    if (count > VIS_BUFFER_SIZE) count = VIS_BUFFER_SIZE;
-    
-    // Copy samples from the ring buffer in the correct order
-    int read_idx = (m_vis_write_idx - count + VIS_BUFFER_SIZE) % VIS_BUFFER_SIZE;
-    for (int i = 0; i < count; ++i) {
-        out_buffer[i] = m_vis_buffer[read_idx];
-        read_idx = (read_idx + 1) % VIS_BUFFER_SIZE;
-    }
+    count = (std::min)(count, MASTER_SCOPE_FRAMES);
+    m_vis_snapshot.resize(count * 2);
+    int got = m_scopes.tap(ScopeBus::MASTER).snapshot(m_vis_snapshot.data(), count);
+    // Right-aligned, so the newest frame is always last
+    int silent = count - got;
+    std::fill(out_buffer, out_buffer + silent, 0.0f);
+    for (int i = 0; i < got; ++i) out_buffer[silent + i] = (m_vis_snapshot[i * 2] + m_vis_snapshot[i * 2 + 1]) * 0.5f;
 }
 
 void AudioPlayer::get_spectrum_data(float* out_magnitudes, int count) {
-    const int N = 1024;
-    std::vector<std::complex<double>> data(N);
-    
-    float buffer[N];
-    get_visualization_data(buffer, N);
-    
-    for (int i = 0; i < N; ++i) {
-        // Hann window to reduce leakage
-        double window = 0.5 * (1.0 - cos(2.0 * PI * i / (N - 1)));
-        data[i] = std::complex<double>(buffer[i] * window, 0);
-    }
-    
-    fft_iterative(data);
-    
-    // Magnitudes (only first half)
-    for (int i = 0; i < count && i < N/2; ++i) {
-        // Normalize by N and apply a simple logarithmic-like scaling for better visual
-        float mag = (float)std::abs(data[i]) / N;
-        out_magnitudes[i] = mag;
-    }
+    const Spectrum& spectrum = m_analyzer.read();
+    int bins = (std::min)(count, static_cast<int>(spectrum.magnitudes.size()));
+    std::copy(spectrum.magnitudes.begin(), spectrum.magnitudes.begin() + bins, out_magnitudes);
+    std::fill(out_magnitudes + bins, out_magnitudes + count, 0.0f);
+}
+
+void AudioPlayer::get_spectrum_bands(float* out_bands, int count, float min_hz, float max_hz) {
+    m_analyzer.read().to_log_bands(out_bands, count, min_hz, max_hz);
 }
 
 void AudioPlayer::data_callback(ma_device* pDevice, void* pOutput, const void* pInput, unsigned int frameCount) {
@@ -146,38 +359,80 @@ void AudioPlayer::data_callback(ma_device* pDevice, void* pOutput, const void* p
         return;
     }
 
-    player->m_renderer.render_block((float*)pOutput, frameCount);
+    if (player->m_flush_requested) {
+        player->m_ring.discard();
+        player->m_frames_read = player->m_frames_written;
+        // Songs that started in the dropped audio still set the preview state; the seek set the position
+        SongSwitcher::Marker marker;
+        if (player->m_switcher.drain_switches(marker)) {
+            player->m_is_preview = marker.is_preview;
+            player->m_preview_samples_elapsed = 0;
+        }
+        player->m_frames_played = 0;
+        player->m_flush_requested = false;
+        std::memset(pOutput, 0, frameCount * 2 * sizeof(float));
+        return;
+    }
 
-    // Apply Preview Fade-out if needed
-    if (player->m_is_preview) {
-        float* out = (float*)pOutput;
-        double fade_start = 4.0 * 44100.0;
-        double preview_end = 5.0 * 44100.0;
+    // Only copy here: synthesis happens on the render thread
+    auto start = std::chrono::steady_clock::now();
+    float* out = (float*)pOutput;
+    bool preview_ended = false;
+    for (size_t left = frameCount; left > 0; ) {
+        // A new song starts within this buffer: play up to its first frame, then switch over
+        SongSwitcher::Marker started;
+        size_t frames = player->m_switcher.take_switch(player->m_frames_read, left, started);
+        if (frames == 0) {
+            player->m_position_base_ms = started.start_ms;
+            player->m_frames_played = 0;
+            player->m_is_preview = started.is_preview;
+            player->m_preview_samples_elapsed = 0;
+            continue;
+        }
+
+        size_t got = player->m_ring.read(out, frames * 2) / 2;
+        player->m_frames_read += got;
+        player->m_frames_played += got;
+        if (got < frames) {
+            std::memset(out + got * 2, 0, (left - got) * 2 * sizeof(float));
+            // Only once the song has begun: until then the render thread is still filling the ring
+            if (!player->m_render_done && player->m_frames_played > got) player->m_underruns++;
+        }
 
-        for (unsigned int i = 0; i < frameCount; ++i) {
-            float gain = 1.0f;
-            if (player->m_preview_samples_elapsed >= preview_end) {
-                gain = 0.0f;
-                player->m_playing = false;
-            } else if (player->m_preview_samples_elapsed >= fade_start) {
-                gain = 1.0f - (float)((player->m_preview_samples_elapsed - fade_start) / (preview_end - fade_start));
+        // Apply Preview Fade-out if needed
+        if (player->m_is_preview) {
+            double fade_start = 4.0 * player->m_device_rate;
+            double preview_end = 5.0 * player->m_device_rate;
+
+            for (size_t i = 0; i < got; ++i) {
+                float gain = 1.0f;
+                if (player->m_preview_samples_elapsed >= preview_end) {
+                    gain = 0.0f;
+                    preview_ended = true;
+                } else if (player->m_preview_samples_elapsed >= fade_start) {
+                    gain = 1.0f - (float)((player->m_preview_samples_elapsed - fade_start) / (preview_end - fade_start));
+                }
+
+                out[i * 2] *= gain;
+                out[i * 2 + 1] *= gain;
+                player->m_preview_samples_elapsed++;
             }
-            
-            out[i * 2] *= gain;
-            out[i * 2 + 1] *= gain;
-            player->m_preview_samples_elapsed++;
         }
+        if (got < frames) break;
+        out += got * 2;
+        left -= got;
     }
 
-    // Update Visualization Buffer (Mono downmix of the block)
-    float* out = (float*)pOutput;
-    for (unsigned int i = 0; i < frameCount; ++i) {
-        float mono = (out[i * 2] + out[i * 2 + 1]) * 0.5f;
-        player->m_vis_buffer[player->m_vis_write_idx] = mono;
-        player->m_vis_write_idx = (player->m_vis_write_idx + 1) % VIS_BUFFER_SIZE;
-    }
+    // Scopes read the output from the master tap and the analyzer from its own, without locks
+    player->m_scopes.tap(ScopeBus::MASTER).write((const float*)pOutput, static_cast<int>(frameCount));
+    player->m_analysis_tap.write((const float*)pOutput, static_cast<int>(frameCount));
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    player->m_load_meter.add_callback(seconds, static_cast<int>(frameCount));
 
-    if (player->m_renderer.is_finished()) {
+    if (preview_ended || (!player->m_switcher.is_switch_pending() && player->m_render_done && player->m_ring.get_read_available() == 0)) {
         player->m_playing = false;
+        // play() may have queued the next song meanwhile; it requests the switch before setting m_playing
+        if (player->m_switcher.is_switch_pending()) player->m_playing = true;
     }
 }
\ No newline at end of file
@@ -2,22 +2,104 @@
 #define AUDIO_PLAYER_H
 
 #include <vector>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include "Song.h"
 #include "AudioRenderer.h"
+#include "SongSwitcher.h"
+#include "SpscRing.h"
+#include "SpectrumAnalyzer.h"
+#include "ScopeBus.h"
 
 // Forward declaration for miniaudio device
 struct ma_device;
 
+// Playback device setup. Zeros leave the choice to the device: small periods give low latency for
+// live auditioning, large ones headroom for heavy sessions.
+struct AudioDeviceConfig {
+    unsigned int sample_rate = 0;   // 0: the device's native rate, so the backend doesn't resample
+    unsigned int period_frames = 0; // 0: the backend's default period
+    unsigned int periods = 0;       // 0: the backend's default period count
+};
+
+// Where a live edit of the playing song takes over (see AudioPlayer::update_song)
+enum class SwapBoundary {
+    NEXT_BLOCK,
+    BEAT, // At the song's tempo
+    BAR   // Four beats
+};
+
 class AudioPlayer {
 public:
     AudioPlayer();
     ~AudioPlayer();
 
-    // Initialize the audio device
-    bool init();
+    // Initialize the audio device; calling it again reopens the device with the new setup
+    bool init(const AudioDeviceConfig& config = AudioDeviceConfig());
+    // Rate the song is synthesized at before conversion to the device rate (0 = the device rate)
+    void set_render_rate(float rate) { for (AudioRenderer& renderer : m_switcher.renderers()) renderer.set_internal_rate(rate); }
+    float get_device_rate() const { return m_device_rate; }
+    // The period size and count the backend granted, which may differ from what was asked for
+    unsigned int get_period_frames() const { return m_period_frames; }
+    unsigned int get_periods() const { return m_periods; }
+    // Time from the callback writing a frame until it is played: the device's whole buffer
+    double get_device_latency_ms() const { return m_period_frames * m_periods * 1000.0 / m_device_rate; }
+    // Time from a frame being rendered until it is played: the render-ahead ring on top of the
+    // device buffer. Edits, seeks and mutes are heard this much later.
+    double get_output_latency_ms() const { return get_render_ahead_frames() * 1000.0 / m_device_rate + get_device_latency_ms(); }
+
+    static constexpr float DEFAULT_RENDER_RATE = 44100.0f;
+
+    // How much audio a render thread keeps ready ahead of the device; takes effect the next time
+    // playback starts
+    void set_render_ahead_ms(double ms) { m_render_ahead_ms = ms; }
+    double get_render_ahead_ms() const { return m_render_ahead_ms; }
+    // The ring's target fill at the device rate: the setting, but at least two render blocks.
+    // Blocks are the device period, kept within 64 to 512 frames, so with small periods the
+    // render-ahead can shrink to a few milliseconds.
+    size_t get_render_ahead_frames() const;
+    static constexpr double DEFAULT_RENDER_AHEAD_MS = 100.0;
+
+    // Render-ahead buffer fill, and the callbacks since play() that found it short
+    size_t get_buffered_frames() const { return m_ring.get_read_available() / 2; }
+    double get_buffered_ms() const { return get_buffered_frames() * 1000.0 / m_device_rate; }
+    uint64_t get_underrun_count() const { return m_underruns.load(std::memory_order_relaxed); }
+
+    // DSP load of the render thread and the callback, updated every half second of playback.
+    // Call from one thread only (the UI).
+    DspStats get_dsp_stats();
+    // Also break the load down by instrument (see AudioRenderer::set_profiling)
+    void set_instrument_profiling(bool enabled) { for (AudioRenderer& renderer : m_switcher.renderers()) renderer.set_profiling(enabled); }
+    // Step synthesis quality down while the render thread falls behind (on by default)
+    void set_adaptive_quality(bool enabled) { for (AudioRenderer& renderer : m_switcher.renderers()) renderer.set_adaptive_quality(enabled); }
+    // Bounds the voices rendered at once, and so the worst-case DSP load (see AudioRenderer::set_max_polyphony)
+    void set_max_polyphony(size_t voices, VoiceStealing stealing = VoiceStealing::OLDEST) {
+        for (AudioRenderer& renderer : m_switcher.renderers()) renderer.set_max_polyphony(voices, stealing);
+    }
+    static constexpr size_t DEFAULT_MAX_POLYPHONY = 256;
 
-    // Start playing a song
-    void play(const Song& song, bool is_preview = false);
+    // Start playing a song, optionally from 'start_ms' into it. The song is loaded on a background
+    // thread, so this returns at once. A song already playing goes on until the new one is ready
+    // and the audio buffered ahead has played, then hands over at that frame without a gap,
+    // crossfading over the crossfade time.
+    void play(const Song& song, bool is_preview = false, double start_ms = 0.0);
+    // Crossfade when play() replaces a playing song (0: a hard cut)
+    void set_crossfade_ms(double ms) { m_crossfade_ms = ms; }
+    static constexpr double DEFAULT_CROSSFADE_MS = 20.0;
+    // Replace the playing song with an edited version of it without stopping. The new song is
+    // flattened on the loader thread and diffed against the playing one; voices that changed are
+    // swapped at the next 'boundary' of the song, while the playhead and every unchanged voice
+    // carry on (see AudioRenderer::swap_song). Bars and beats are those of Song::bpm counted from the
+    // start of the song, so a script that changes tempo may swap off its beat. A newer edit replaces
+    // one still on its way. Returns false when no song is playing or one is about to take over;
+    // play() the song then instead.
+    bool update_song(const Song& song, SwapBoundary boundary = SwapBoundary::BAR);
+    SongSwapStats get_swap_stats() const { return m_switcher.playing()->get_swap_stats(); }
+    // Jump to 'ms' in the current song
+    void seek(double ms);
 
     // Stop playback
     void stop();
@@ -29,25 +111,102 @@ public:
     size_t get_active_voice_count() const;
     size_t get_scheduled_voice_count() const;
 
-    // Visualization
-    static const int VIS_BUFFER_SIZE = 1024;
+    // Visualization: the newest 'count' frames of the output, downmixed to mono. Call from one thread only.
     void get_visualization_data(float* out_buffer, int count);
+    // Stereo taps on the output (ScopeBus::MASTER) and, once enabled, on each instrument's mix.
+    // Readers snapshot them from any thread without holding up playback. Their decimation only
+    // zooms the scopes: the spectrum analyzer reads every frame of the output from a tap of its own.
+    ScopeBus& get_scope_bus() { return m_scopes; }
+    void set_track_scopes(bool enabled);
+    // Peak, RMS and loudness of the mix and each instrument (on by default: a few operations per
+    // sample). Measured as the render thread synthesizes, so ahead of the device by the render-ahead
+    // buffer. Call get_levels() from one thread only.
+    void set_metering(bool enabled) { for (AudioRenderer& renderer : m_switcher.renderers()) renderer.set_metering(enabled); }
+    const LevelReport& get_levels() { return m_switcher.playing()->read_levels(); }
+    static constexpr int MASTER_SCOPE_FRAMES = 16384; // About a third of a second at 48 kHz
+    static constexpr int TRACK_SCOPE_FRAMES = 4096;
+    // Spectrum of the output, analyzed on the render thread. Magnitudes are peak amplitudes per FFT
+    // bin, from DC up; bands take the loudest bin of log-spaced frequency ranges. Call from one thread only.
     void get_spectrum_data(float* out_magnitudes, int count);
+    void get_spectrum_bands(float* out_bands, int count, float min_hz = 20.0f, float max_hz = 20000.0f);
+    // FFT size and frame overlap (see SpectrumAnalyzer::configure); applied by the render thread
+    void set_spectrum_analysis(int size, float overlap);
 
 private:
     // Miniaudio device handle (void* to avoid exposing miniaudio.h in header)
     void* m_device = nullptr;
-    
+    bool m_device_initialized = false;
+    unsigned int m_period_frames = 0;
+    unsigned int m_periods = 0;
+    int m_render_block_frames = 512; // Set by init() under m_render_mutex
+
     // Playback state
-    bool m_playing = false;
+    std::atomic<bool> m_playing{ false };
     bool m_is_preview = false;
     double m_preview_samples_elapsed = 0;
-    AudioRenderer m_renderer;
+    float m_device_rate = 44100.0f;
+
+    // The playing song and the next one (see SongSwitcher)
+    SongSwitcher m_switcher{ [this] { wake_loader(); } };
+    std::atomic<double> m_crossfade_ms{ DEFAULT_CROSSFADE_MS };
+    bool m_track_scopes = false; // Only the playing renderer writes the track taps
+
+    std::thread m_loader_thread;
+    std::mutex m_loader_mutex; // Guards m_request, m_update and m_loader_running
+    std::condition_variable m_loader_cv;
+    bool m_loader_running = false;
+    SongSwitcher::Request m_request;
+    struct UpdateRequest {
+        Song song;
+        double grid_ms = 0.0;
+        uint64_t generation = 0; // Counts update_song() calls; only the newest is swapped in
+    };
+    UpdateRequest m_update;
+    std::atomic<uint64_t> m_update_generation{ 0 };
+    std::atomic<uint64_t> m_frames_written{ 0 }; // Into the ring since playback started
+    uint64_t m_frames_read = 0;                  // Callback only
+
+    // Render-ahead pipeline: the render thread fills m_ring, the callback only copies out of it
+    std::thread m_render_thread;
+    std::atomic<bool> m_render_thread_running{ false };
+    std::mutex m_render_mutex;          // Held while the renderers are in use (render thread, play, seek)
+    SpscRing<float> m_ring;             // Interleaved stereo at the device rate
+    std::vector<float> m_render_block;
+    double m_render_ahead_ms = DEFAULT_RENDER_AHEAD_MS;
+    size_t m_render_ahead_frames = 0;
+    std::atomic<bool> m_render_done{ true };      // The renderer has produced the whole song
+    std::atomic<bool> m_flush_requested{ false }; // A seek: the callback drops what is buffered
+    std::atomic<uint64_t> m_underruns{ 0 };
+    std::atomic<double> m_position_base_ms{ 0.0 };  // Song time of the first frame after play/seek
+    std::atomic<uint64_t> m_frames_played{ 0 };     // Frames the device has taken since then
+    DspLoadMeter m_load_meter;
+
+    void render_thread_main();
+    // Renders until the ring holds the render-ahead distance; the caller holds m_render_mutex
+    void fill_ring();
+    // Render thread: swap in the standby renderer once it holds the newest song
+    void try_switch();
+    void wake_loader();
+    void loader_thread_main();
+    // Loader thread: prepare an edit of the playing song and hand it to its renderer
+    void prepare_update(const UpdateRequest& update);
+
+    // Output analysis: the callback writes the master scope tap and the undecimated analysis tap,
+    // the render thread analyzes the latter
+    ScopeBus m_scopes{ MASTER_SCOPE_FRAMES, TRACK_SCOPE_FRAMES };
+    ScopeTap m_analysis_tap{ MASTER_SCOPE_FRAMES };
+    std::mutex m_analysis_mutex; // Held while the analyzer is in use
+    SpectrumAnalyzer m_analyzer;
+    uint64_t m_analysis_position = 0; // Analysis tap frames analyzed so far
+    std::vector<float> m_analysis_stereo;
+    std::vector<float> m_analysis_block;
+    std::vector<float> m_vis_snapshot;
+    std::atomic<int> m_spectrum_size{ SpectrumAnalyzer::DEFAULT_SIZE };
+    std::atomic<float> m_spectrum_overlap{ SpectrumAnalyzer::DEFAULT_OVERLAP };
+    std::atomic<bool> m_spectrum_config_changed{ false };
+    void analyze_output();
+
 
-    // Visualization Ring Buffer
-    float m_vis_buffer[VIS_BUFFER_SIZE] = {0};
-    int m_vis_write_idx = 0;
-    
     // Static callback for miniaudio
     static void data_callback(struct ma_device* pDevice, void* pOutput, const void* pInput, unsigned int frameCount);
 };
@@ -5,12 +5,36 @@
 #define TSF_IMPLEMENTATION
 #include "AudioRenderer.h"
 #include "AudioUtils.h"
+#include "FilterBatch.h"
+#include "Convolver.h"
 #include <cmath>
 #include <iostream>
 #include <algorithm>
 #include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <unordered_map>
+#include <limits>
 #include "SongElement.h"
 
+namespace {
+    using ProfileClock = std::chrono::steady_clock;
+
+    double seconds_since(ProfileClock::time_point start) {
+        return std::chrono::duration<double>(ProfileClock::now() - start).count();
+    }
+
+    // Where the notes and release of an event end; effect tails may ring on past it
+    double notes_end_ms(const ScheduledEvent& ev) {
+        return ev.start_ms + ev.element->get_duration_ms() + ev.element->instrument.synth.envelope.release * 1000.0
+             + (ev.loop_count - 1) * ev.loop_period_ms;
+    }
+}
+
+SongSwap::~SongSwap() {
+    for (auto const& [path, font] : soundfonts) tsf_close(font);
+}
+
 AudioRenderer::AudioRenderer() {}
 
 AudioRenderer::~AudioRenderer() {
@@ -21,154 +45,688 @@ AudioRenderer::~AudioRenderer() {
 
 void AudioRenderer::load(const Song& song, float sample_rate) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_sample_rate = sample_rate;
+    m_sample_rate = (m_internal_rate > 0) ? m_internal_rate : sample_rate;
+    m_output_rate = sample_rate;
+    if (m_sample_rate != sample_rate) {
+        m_resampler = std::make_unique<Resampler>(m_sample_rate, sample_rate);
+    } else {
+        m_resampler.reset();
+    }
+    m_resampled.clear();
+    m_resampled_pos = 0;
     m_current_sample = 0;
     m_scheduled_voices.clear();
     m_active_voices.clear();
+    m_voice_pool.get_delay_lines().trim(); // Lines the audio thread released stay pooled until here
+    m_render_cache.clear();
+    m_costs.clear();
+    m_patches.clear();
+    m_stolen_voices = 0;
+    m_governor.reset();
+    m_quality = QualityLevel::FULL;
+    m_quality_level.store(m_quality, std::memory_order_relaxed);
+    if (m_scopes) m_scopes->release_tracks();
+    m_tracks.clear();
+    m_master_meter.reset(m_sample_rate);
+    publish_levels();
+    m_pending_swap.reset();
+    m_swap_stats = SongSwapStats();
+    m_root = song.root;
+    m_scheduler.reset(song.root);
 
     if (!song.root) return;
 
-    std::vector<Effect> empty_effects;
-    flatten_song(song.root, 0.0, empty_effects);
-    
-    // Calculate actual total samples from scheduled voices
-    double max_end_ms = 0;
-    for (const auto& v : m_scheduled_voices) {
-        double end_ms = (double)v->start_time_samples / m_sample_rate * 1000.0 + (double)v->total_duration_samples / m_sample_rate * 1000.0;
-        if (end_ms > max_end_ms) max_end_ms = end_ms;
-    }
-    
+    // Total length (including release tails) is derived from the tree, so no voices are needed yet
+    double max_end_ms = SongScheduler::compute_end_ms(song.root);
     m_total_samples = static_cast<long>((max_end_ms / 1000.0f) * m_sample_rate);
 
-    // 2. Preload Soundfonts
+    // 2. Preload Soundfonts and impulse responses
+    m_samples.clear();
+    m_impulse_responses.clear();
+    preload_assets(song.root, m_sample_rate, m_soundfonts, m_soundfonts, m_samples, m_impulse_responses);
+
+    // 3. Read the song's disk cache entries here, so rendering never waits for the disk
+    if (m_render_cache_enabled && m_render_cache.has_disk()) {
+        SongScheduler all;
+        all.reset(song.root);
+        std::vector<ScheduledEvent> events;
+        all.advance(max_end_ms + 1.0, events);
+        std::vector<std::string> keys;
+        keys.reserve(events.size());
+        for (const auto& ev : events) {
+            double loop_period_samples = (ev.loop_period_ms / 1000.0) * m_sample_rate;
+            keys.push_back(m_render_cache.make_key(ev.element->instrument, *ev.parent_effects, loop_period_samples, ev.loop_count, m_sample_rate));
+        }
+        m_render_cache.preload(keys);
+    }
+
+    // Build the first window here so the audio callback doesn't pay for it
+    materialize_window();
+}
+
+void AudioRenderer::preload_assets(const std::shared_ptr<SongElement>& root, float sample_rate,
+                                   const std::map<std::string, tsf*>& known, std::map<std::string, tsf*>& loaded,
+                                   std::map<std::string, std::shared_ptr<const RenderedSample>>& samples,
+                                   ImpulseResponseMap& impulse_responses) {
+    auto preload_effects = [&](const std::vector<Effect>& effects) {
+        for (const auto& fx : effects) {
+            if (fx.type == EffectType::CONVOLVE && !impulse_responses.count(fx.path)) {
+                impulse_responses[fx.path] = ImpulseResponse::load(fx.path, sample_rate);
+            }
+        }
+    };
     auto preloader = [&](auto self, std::shared_ptr<SongElement> element) -> void {
         if (!element) return;
         if (auto inst_elem = std::dynamic_pointer_cast<InstrumentElement>(element)) {
             const auto& instrument = inst_elem->instrument;
-            if (instrument.type == InstrumentType::SOUNDFONT && !instrument.soundfont_path.empty()) {
-                if (m_soundfonts.find(instrument.soundfont_path) == m_soundfonts.end()) {
-                    tsf* f = tsf_load_filename(instrument.soundfont_path.c_str());
+            preload_effects(instrument.effects);
+            const std::string& path = instrument.soundfont_path;
+            if (instrument.type == InstrumentType::SOUNDFONT && !path.empty()) {
+                if (known.find(path) == known.end() && loaded.find(path) == loaded.end()) {
+                    tsf* f = tsf_load_filename(path.c_str());
                     if (f) {
-                        tsf_set_output(f, TSF_STEREO_INTERLEAVED, m_sample_rate, 0);
-                        m_soundfonts[instrument.soundfont_path] = f;
+                        tsf_set_output(f, TSF_STEREO_INTERLEAVED, sample_rate, 0);
+                        loaded[path] = f;
                     }
                 }
             }
+            if (instrument.sampler && !samples.count(instrument.sampler->get_path())) {
+                samples[instrument.sampler->get_path()] = instrument.sampler->render_at(sample_rate);
+            }
         } else if (auto comp_elem = std::dynamic_pointer_cast<CompositeElement>(element)) {
+            preload_effects(comp_elem->effects);
             for (auto child : comp_elem->children) self(self, child);
         }
     };
-    preloader(preloader, song.root);
+    preloader(preloader, root);
 }
 
-void AudioRenderer::flatten_song(std::shared_ptr<SongElement> element, double current_time_ms, const std::vector<Effect>& parent_effects) {
-    if (!element) return;
-    double start_time = current_time_ms + element->start_offset_ms;
+std::unique_ptr<SongSwap> AudioRenderer::prepare_swap(const Song& song) {
+    auto swap = std::make_unique<SongSwap>();
+    RenderCache keys; // Describes content like m_render_cache, without touching it
+    std::map<std::string, tsf*> known;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        swap->sample_rate = m_sample_rate;
+        swap->horizon_ms = (double)m_current_sample / m_sample_rate * 1000.0 + m_lookahead_ms;
+        keys.set_disk_dir(m_render_cache.get_disk_dir());
+        known = m_soundfonts; // Only looked up: the renderer keeps them open while it lives
+        swap->samples = m_samples;
+        swap->impulse_responses = m_impulse_responses;
+    }
+    swap->root = song.root;
+    swap->scheduler.reset(song.root);
+    if (!song.root) return swap;
 
-    // Combine parent effects with local effects
-    std::vector<Effect> combined_effects = parent_effects;
-    
-    if (auto inst_elem = std::dynamic_pointer_cast<InstrumentElement>(element)) {
-        double start_samples = (start_time / 1000.0) * m_sample_rate;
-        Instrument inst = inst_elem->instrument;
-        // Prepend parent effects? Or append? usually parent effects (outer blocks) apply AFTER local.
-        // So append them.
-        inst.effects.insert(inst.effects.end(), combined_effects.begin(), combined_effects.end());
-        m_scheduled_voices.push_back(std::make_unique<Voice>(inst, start_samples, m_sample_rate));
-    } 
-    else if (auto comp_elem = std::dynamic_pointer_cast<CompositeElement>(element)) {
-        // Add local effects of this composite block
-        combined_effects.insert(combined_effects.end(), comp_elem->effects.begin(), comp_elem->effects.end());
-
-        if (comp_elem->type == CompositeType::SEQUENTIAL) {
-            double local_time = start_time;
-            for (auto child : comp_elem->children) {
-                flatten_song(child, local_time, combined_effects);
-                local_time += (child ? (child->start_offset_ms + child->get_duration_ms()) : 0);
-            }
-        } else if (comp_elem->type == CompositeType::PARALLEL) {
-            for (auto child : comp_elem->children) {
-                flatten_song(child, start_time, combined_effects);
-            }
-        } else if (comp_elem->type == CompositeType::AUTO_LOOP) {
-            if (!comp_elem->children.empty()) {
-                auto leader = comp_elem->children[0];
-                if (!leader) return;
-                double leader_dur = leader->get_duration_ms();
-                flatten_song(leader, start_time, combined_effects);
-                
-                for (size_t i = 1; i < comp_elem->children.size(); ++i) {
-                    auto follower = comp_elem->children[i];
-                    if (!follower) continue;
-                    double follower_dur = follower->get_duration_ms();
-                    if (follower_dur <= 0) continue;
-                    
-                    double loop_time = 0;
-                    while (loop_time < leader_dur) {
-                        flatten_song(follower, start_time + loop_time, combined_effects);
-                        loop_time += follower_dur;
-                    }
-                }
+    swap->total_samples = static_cast<long>((SongScheduler::compute_end_ms(song.root) / 1000.0f) * swap->sample_rate);
+    preload_assets(song.root, swap->sample_rate, known, swap->soundfonts, swap->samples, swap->impulse_responses);
+    swap->scheduler.advance(swap->horizon_ms, swap->events);
+    swap->keys.reserve(swap->events.size());
+    for (const auto& ev : swap->events) {
+        double loop_period_samples = (ev.loop_period_ms / 1000.0) * swap->sample_rate;
+        swap->keys.push_back(keys.make_key(ev.element->instrument, *ev.parent_effects, loop_period_samples, ev.loop_count, swap->sample_rate));
+    }
+    return swap;
+}
+
+void AudioRenderer::swap_song(std::unique_ptr<SongSwap> swap, double grid_ms) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Prepared before the renderer was loaded at another rate
+    if (!swap || swap->sample_rate != m_sample_rate) return;
+    double now_ms = (double)m_current_sample / m_sample_rate * 1000.0;
+    double at_ms = (grid_ms > 0) ? std::ceil(now_ms / grid_ms) * grid_ms : now_ms;
+    m_swap_sample = static_cast<long>((at_ms / 1000.0) * m_sample_rate);
+    m_pending_swap = std::move(swap);
+}
+
+void AudioRenderer::adopt_song(SongSwap& swap) {
+    for (auto& [path, font] : swap.soundfonts) {
+        if (!m_soundfonts.emplace(path, font).second) tsf_close(font);
+    }
+    swap.soundfonts.clear();
+    m_samples.swap(swap.samples);
+    m_impulse_responses.swap(swap.impulse_responses);
+    m_root = swap.root;
+    m_total_samples = swap.total_samples;
+}
+
+void AudioRenderer::apply_swap() {
+    std::unique_ptr<SongSwap> swap = std::move(m_pending_swap);
+    adopt_song(*swap);
+    double now_ms = (double)m_current_sample / m_sample_rate * 1000.0;
+    // The old schedule may have materialized further than the swap was prepared to
+    double horizon_ms = now_ms + m_lookahead_ms;
+    if (horizon_ms > swap->horizon_ms) {
+        size_t first = swap->events.size();
+        swap->scheduler.advance(horizon_ms, swap->events);
+        for (size_t i = first; i < swap->events.size(); ++i) {
+            const ScheduledEvent& ev = swap->events[i];
+            double loop_period_samples = (ev.loop_period_ms / 1000.0) * m_sample_rate;
+            swap->keys.push_back(m_render_cache.make_key(ev.element->instrument, *ev.parent_effects, loop_period_samples, ev.loop_count, m_sample_rate));
+        }
+    }
+    const std::vector<ScheduledEvent>& events = swap->events;
+
+    // The events from the start of the song on: only those that may match a voice or still sound matter
+    double earliest_voice = m_current_sample;
+    for (const auto& voice : m_active_voices) earliest_voice = (std::min)(earliest_voice, voice->start_time_samples);
+    std::vector<size_t> relevant;
+    for (size_t i = 0; i < events.size(); ++i) {
+        if ((events[i].start_ms / 1000.0) * m_sample_rate >= earliest_voice || notes_end_ms(events[i]) > now_ms) relevant.push_back(i);
+    }
+
+    // A voice carries on if the new song has an event with the same content at the same time
+    std::unordered_multimap<std::string, size_t> by_key;
+    for (size_t i : relevant) {
+        if (!swap->keys[i].empty()) by_key.emplace(swap->keys[i], i);
+    }
+    std::vector<bool> matched(events.size(), false);
+    auto keep = [&](const Voice& voice) {
+        if (voice.content_key.empty()) return false;
+        auto range = by_key.equal_range(voice.content_key);
+        for (auto it = range.first; it != range.second; ++it) {
+            size_t i = it->second;
+            if (!matched[i] && (events[i].start_ms / 1000.0) * m_sample_rate == voice.start_time_samples) {
+                matched[i] = true;
+                return true;
             }
         }
+        return false;
+    };
+
+    int fade_frames = static_cast<int>(SWAP_FADE_SECONDS * m_sample_rate);
+    for (auto& voice : m_active_voices) {
+        if (keep(*voice)) {
+            m_swap_stats.kept_voices++;
+        } else if (!voice->is_fading()) {
+            voice->fade_out(fade_frames);
+            m_swap_stats.replaced_voices++;
+        }
+    }
+    for (auto it = m_scheduled_voices.begin(); it != m_scheduled_voices.end(); ) {
+        if (keep(**it)) {
+            m_swap_stats.kept_voices++;
+            ++it;
+        } else {
+            // A recording voice abandons its entry, so the voices created below don't replay it
+            it = m_scheduled_voices.erase(it);
+            m_swap_stats.replaced_voices++;
+        }
+    }
+
+    // Changed voices that should already be sounding join mid-way, as after a seek. Pre-rolling
+    // their effects could take longer than a block, so the effects start out empty.
+    for (size_t i : relevant) {
+        if (matched[i]) continue;
+        const ScheduledEvent& ev = events[i];
+        std::unique_ptr<Voice> voice;
+        if (ev.start_ms < now_ms) {
+            if (notes_end_ms(ev) <= now_ms) continue;
+            voice = create_voice(ev, false);
+            voice->seek(m_current_sample - voice->start_time_samples, m_sample_rate, m_soundfonts, 0.0);
+            if (voice->is_finished) continue;
+        } else {
+            voice = create_voice(ev, true);
+        }
+        m_scheduled_voices.push_back(std::move(voice));
+        m_swap_stats.new_voices++;
+    }
+    m_scheduler = std::move(swap->scheduler);
+    m_swap_stats.swaps++;
+}
+
+void AudioRenderer::materialize_window() {
+    double horizon_ms = (double)m_current_sample / m_sample_rate * 1000.0 + m_lookahead_ms;
+    m_event_scratch.clear();
+    m_scheduler.advance(horizon_ms, m_event_scratch);
+
+    for (const auto& ev : m_event_scratch) {
+        m_scheduled_voices.push_back(create_voice(ev, true));
     }
 }
 
+std::unique_ptr<Voice> AudioRenderer::create_voice(const ScheduledEvent& ev, bool allow_record) {
+    double start_samples = (ev.start_ms / 1000.0) * m_sample_rate;
+    double loop_period_samples = (ev.loop_period_ms / 1000.0) * m_sample_rate;
+
+    // Also identifies the voice to live song swaps
+    std::string key = m_render_cache.make_key(ev.element->instrument, *ev.parent_effects, loop_period_samples, ev.loop_count, m_sample_rate);
+    if (m_render_cache_enabled && !key.empty()) {
+        auto cached = m_render_cache.find(key);
+        // After a live swap a recording can start later than voices created afterwards
+        if (cached && (cached->complete || cached->recorder_start <= start_samples)) {
+            auto voice = std::make_unique<Voice>(cached, start_samples);
+            voice->source = ev.element; // Polyphony limits still count it as its instrument
+            voice->replayed_event = ev;
+            voice->content_key = std::move(key);
+            return voice;
+        }
+    }
+
+    // Parent effects (outer blocks) apply AFTER local ones; the patch appends them once for all its voices
+    auto patch = m_patches.get(ev.element->instrument, *ev.parent_effects);
+    auto voice = std::make_unique<Voice>(patch, ev.element, m_voice_pool, m_impulse_responses, start_samples, m_sample_rate, loop_period_samples, ev.loop_count);
+    if (const Sampler* sampler = ev.element->instrument.sampler) {
+        auto it = m_samples.find(sampler->get_path());
+        if (it != m_samples.end()) voice->sample = it->second;
+    }
+    if (m_render_cache_enabled && allow_record && !key.empty() && !voice->is_finished) {
+        // Allow for the partial block a voice renders after its nominal end
+        voice->cache_record = m_render_cache.begin_record(key, voice->total_duration_samples + 4096);
+        if (voice->cache_record) voice->cache_record->recorder_start = start_samples;
+    }
+    voice->content_key = std::move(key);
+    return voice;
+}
+
+std::unique_ptr<Voice> AudioRenderer::resynthesize(const Voice& replay) {
+    // find() no longer hands out the abandoned entry, so this synthesizes (or replays a disk copy)
+    auto voice = create_voice(replay.replayed_event, false);
+    // On the audio thread: the pre-roll is bounded like a seek's
+    voice->seek(static_cast<double>(replay.cache_playback_pos / 2), m_sample_rate, m_soundfonts, SEEK_PREROLL_SECONDS * m_sample_rate);
+    voice->is_active = true;
+    voice->fade_frames_left = replay.fade_frames_left;
+    voice->fade_frames_total = replay.fade_frames_total;
+    return voice;
+}
+
+void AudioRenderer::seek(double ms) {
+    seek_to(ms, SEEK_PREROLL_SECONDS);
+}
+
+void AudioRenderer::seek_to(double ms, double preroll_budget_seconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // An edit waiting for its boundary applies at once: everything restarts here anyway
+    if (m_pending_swap) {
+        adopt_song(*m_pending_swap);
+        m_pending_swap.reset();
+    }
+    if (!m_root) return;
+
+    m_current_sample = static_cast<long>(((std::max)(0.0, ms) / 1000.0) * m_sample_rate);
+    if (m_resampler) m_resampler->reset();
+    m_resampled.clear();
+    m_resampled_pos = 0;
+    m_scheduled_voices.clear();
+    m_active_voices.clear();
+    // Recordings cut off by the seek would never complete
+    m_render_cache.drop_incomplete();
+    m_scheduler.reset(m_root);
+
+    // Voices that started earlier and are still sounding join mid-way; they don't record,
+    // since their output doesn't start at the beginning
+    double target_ms = (double)m_current_sample / m_sample_rate * 1000.0;
+    m_event_scratch.clear();
+    m_scheduler.advance(target_ms, m_event_scratch);
+    std::vector<std::unique_ptr<Voice>> joining;
+    for (const auto& ev : m_event_scratch) {
+        if (notes_end_ms(ev) > target_ms) joining.push_back(create_voice(ev, false));
+    }
+    // Shortest pre-rolls first, so the budget rebuilds as many voices as it can
+    std::vector<std::pair<double, Voice*>> by_preroll;
+    for (auto& voice : joining) {
+        by_preroll.emplace_back(voice->get_seek_preroll(m_current_sample - voice->start_time_samples, m_sample_rate), voice.get());
+    }
+    std::stable_sort(by_preroll.begin(), by_preroll.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    double preroll_budget_samples = preroll_budget_seconds * m_sample_rate;
+    for (auto& [preroll, voice] : by_preroll) {
+        preroll_budget_samples -= voice->seek(m_current_sample - voice->start_time_samples, m_sample_rate, m_soundfonts, preroll_budget_samples);
+    }
+    for (auto& voice : joining) {
+        if (!voice->is_finished) m_scheduled_voices.push_back(std::move(voice));
+    }
+
+    materialize_window();
+}
+
 void AudioRenderer::render_block(float* output, int frame_count) {
     std::lock_guard<std::mutex> lock(m_mutex);
+    ProfileClock::time_point start;
+    if (m_adaptive_quality) start = ProfileClock::now();
+
+    if (m_resampler) {
+        render_resampled(output, frame_count);
+    } else {
+        render_voices(output, frame_count);
+    }
+
+    if (m_adaptive_quality) {
+        double block_seconds = frame_count / static_cast<double>(m_output_rate);
+        m_quality = m_governor.update(seconds_since(start) / block_seconds, block_seconds, m_buffer_fill);
+        m_quality_level.store(m_quality, std::memory_order_relaxed);
+    }
+}
+
+void AudioRenderer::render_resampled(float* output, int frame_count) {
+    // Synthesize in fixed blocks until the converter has enough output frames, then hand them out
+    const int SYNTH_BLOCK = 512;
+    float synth[SYNTH_BLOCK * 2];
+    size_t needed = static_cast<size_t>(frame_count) * 2;
+    while (m_resampled.size() - m_resampled_pos < needed && !voices_finished()) {
+        if (m_resampled_pos > 0) {
+            m_resampled.erase(m_resampled.begin(), m_resampled.begin() + m_resampled_pos);
+            m_resampled_pos = 0;
+        }
+        render_voices(synth, SYNTH_BLOCK);
+        m_resampler->process(synth, SYNTH_BLOCK, m_resampled);
+        if (voices_finished()) m_resampler->flush(m_resampled);
+    }
+    size_t available = (std::min)(needed, m_resampled.size() - m_resampled_pos);
+    std::memcpy(output, m_resampled.data() + m_resampled_pos, available * sizeof(float));
+    std::memset(output + available, 0, (needed - available) * sizeof(float));
+    m_resampled_pos += available;
+}
+
+void AudioRenderer::render_voices(float* output, int frame_count) {
     std::memset(output, 0, frame_count * 2 * sizeof(float));
 
-    // 1. Activate new voices
-    for (auto& v : m_scheduled_voices) {
-        if (!v->is_active && !v->is_finished && m_current_sample >= v->start_time_samples) {
+    // 1. Pull upcoming voices into the look-ahead window and activate the ones that are due
+    if (m_pending_swap && m_current_sample + frame_count > m_swap_sample) apply_swap();
+    materialize_window();
+    size_t first_new = m_active_voices.size();
+    for (auto it = m_scheduled_voices.begin(); it != m_scheduled_voices.end(); ) {
+        Voice* v = it->get();
+        if (v->is_finished) {
+            it = m_scheduled_voices.erase(it);
+        } else if (m_current_sample >= v->start_time_samples) {
             v->is_active = true;
-            m_active_voices.push_back(v.get());
+            make_room_for(*v, first_new);
+            m_active_voices.push_back(std::move(*it));
+            it = m_scheduled_voices.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (m_quality >= QualityLevel::SHORT_TAILS) shed_voices();
+
+    // Replays about to run past the end of an abandoned recording carry on synthesized
+    for (auto& voice : m_active_voices) {
+        const CachedRender* cached = voice->cache_playback.get();
+        if (cached && cached->abandoned && voice->cache_playback_pos + frame_count * 2 > cached->pcm.size()) {
+            voice = resynthesize(*voice);
         }
     }
 
-    // 2. Render active voices
-    for (auto it = m_active_voices.begin(); it != m_active_voices.end(); ) {
-        Voice* v = *it;
-        v->render(output, frame_count, m_sample_rate, m_soundfonts);
-        
+    // 2. Synthesize active voices, then run all deferred filters together across voices
+    if (m_voice_blocks.size() < m_active_voices.size()) m_voice_blocks.resize(m_active_voices.size());
+    m_filter_lanes.clear();
+    bool fast_math = m_quality >= QualityLevel::FAST_MATH;
+    MathPrecision precision = fast_math ? MathPrecision::FAST : FastMath::get_precision();
+    MathPrecision oscillator_precision = fast_math ? MathPrecision::FAST : MathPrecision::EXACT;
+    int filter_update_interval = (m_quality >= QualityLevel::CONTROL_RATE_FILTERS) ? QualityGovernor::FILTER_CONTROL_INTERVAL : 1;
+    ProfileClock::time_point start;
+    for (size_t i = 0; i < m_active_voices.size(); ++i) {
+        Voice* v = m_active_voices[i].get();
+        VoiceBlock& block = m_voice_blocks[i];
+        block.precision = precision;
+        block.oscillator_precision = oscillator_precision;
+        block.filter_update_interval = filter_update_interval;
+        // Other voices with the same content must not replay a degraded render
+        if (m_quality != QualityLevel::FULL && v->cache_record) v->cache_record->degraded = true;
+        if (m_profiling) start = ProfileClock::now();
+        v->begin_render(block, frame_count, m_sample_rate, m_soundfonts);
+        if (m_profiling) cost_of(*v).seconds += seconds_since(start);
+        if (block.filter_pending) m_filter_lanes.push_back({ v->slot, block.mono.data(), block.gate.data() });
+    }
+    FilterBatch::process(m_voice_pool, m_filter_lanes.data(), m_filter_lanes.size(), frame_count);
+
+    // 3. Effects and mixing; finished voices are released immediately
+    bool track_mixes = m_scopes || m_metering;
+    if (track_mixes) {
+        for (TrackMix& track : m_tracks) track.mix.assign(frame_count * 2, 0.0f);
+    }
+    bool voice_finished = false;
+    size_t block_idx = 0;
+    for (auto it = m_active_voices.begin(); it != m_active_voices.end(); ++block_idx) {
+        Voice* v = it->get();
+        VoiceBlock& block = m_voice_blocks[block_idx];
+        if (m_profiling) start = ProfileClock::now();
+        v->finish_render(block, output, frame_count);
+        if (m_profiling) {
+            InstrumentCost& cost = cost_of(*v);
+            cost.seconds += seconds_since(start);
+            cost.voice_blocks++;
+        }
+        if (track_mixes && v->source && !block.stereo.empty()) {
+            std::vector<float>& mix = track_of(*v, frame_count).mix;
+            for (int i = 0; i < frame_count * 2; ++i) mix[i] += block.stereo[i];
+        }
+
         if (v->is_finished) {
             it = m_active_voices.erase(it);
+            voice_finished = true;
         } else {
             ++it;
         }
     }
+    if (voice_finished) m_render_cache.flush();
+
+    // Tracks without a sounding voice get silence, so all track taps and meters stay in step
+    if (track_mixes) {
+        bool period_done = m_metering && m_master_meter.process(output, frame_count);
+        for (TrackMix& track : m_tracks) {
+            if (m_scopes) {
+                if (track.scope_tap == 0) track.scope_tap = m_scopes->find_or_assign_track(track.name);
+                if (track.scope_tap > 0) m_scopes->tap(track.scope_tap).write(track.mix.data(), frame_count);
+            }
+            if (m_metering) track.meter.process(track.mix.data(), frame_count);
+        }
+        if (period_done) publish_levels();
+    }
 
     m_current_sample += frame_count;
 }
 
+void AudioRenderer::set_scope_bus(ScopeBus* scopes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_scopes = scopes;
+    for (TrackMix& track : m_tracks) track.scope_tap = 0;
+}
+
+void AudioRenderer::set_metering(bool enabled) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_metering = enabled;
+}
+
+AudioRenderer::TrackMix& AudioRenderer::track_of(const Voice& voice, int frame_count) {
+    const std::string& name = voice.source->instrument.name;
+    for (TrackMix& track : m_tracks) {
+        if (track.name == name) return track;
+    }
+    m_tracks.emplace_back();
+    TrackMix& track = m_tracks.back();
+    track.name = name;
+    track.mix.assign(frame_count * 2, 0.0f);
+    track.meter.reset(m_sample_rate);
+    return track;
+}
+
+void AudioRenderer::publish_levels(float gain) {
+    m_level_report.master = m_master_meter.get_levels().scaled(gain);
+    m_level_report.track_count = (std::min)(static_cast<int>(m_tracks.size()), LevelReport::MAX_TRACKS);
+    for (int i = 0; i < m_level_report.track_count; ++i) {
+        LevelReport::Track& track = m_level_report.tracks[i];
+        std::snprintf(track.name, sizeof(track.name), "%s", m_tracks[i].name.c_str());
+        track.levels = m_tracks[i].meter.get_levels().scaled(gain);
+    }
+    m_level_report.updates++;
+    m_published_levels.publish(m_level_report);
+}
+
+void AudioRenderer::shed_voices() {
+    // Replaying from the render cache costs next to nothing, so only synthesized voices are shed
+    int fade_frames = static_cast<int>(QualityGovernor::TAIL_FADE_SECONDS * m_sample_rate);
+    for (auto& voice : m_active_voices) {
+        Voice& v = *voice;
+        if (!v.patch || v.is_fading()) continue;
+        double position = m_current_sample - v.start_time_samples;
+        if (v.total_duration_samples - position <= fade_frames) continue;
+
+        // Past the last note of the last pass, only the release and effect tails are left
+        double release_samples = v.instrument().synth.envelope.release * m_sample_rate;
+        double notes_end = (v.loop_count - 1) * v.loop_period_samples + v.pass_duration_samples - release_samples;
+        bool in_tail = position >= notes_end;
+        // A silent voice is resting between notes, not quiet
+        bool quiet = m_quality >= QualityLevel::DROP_QUIET && v.last_peak > 0.0f && v.last_peak < QualityGovernor::QUIET_VOICE_PEAK;
+        if (in_tail || quiet) v.fade_out(fade_frames);
+    }
+}
+
+namespace {
+    bool same_instrument(const Voice& a, const Voice& b) {
+        return a.source && b.source && a.source->instrument.name == b.source->instrument.name;
+    }
+}
+
+void AudioRenderer::make_room_for(const Voice& incoming, size_t first_new) {
+    int fade_frames = static_cast<int>(STEAL_FADE_SECONDS * m_sample_rate);
+    auto steal = [&](Voice* victim) {
+        if (!victim) return;
+        victim->fade_out(fade_frames);
+        m_stolen_voices++;
+    };
+
+    // Voices already fading out are on their way out and don't count
+    if (incoming.source && incoming.source->instrument.polyphony > 0) {
+        const Instrument& instrument = incoming.source->instrument;
+        size_t sounding = std::count_if(m_active_voices.begin(), m_active_voices.end(), [&](const std::unique_ptr<Voice>& v) {
+            return !v->is_fading() && same_instrument(*v, incoming);
+        });
+        if (sounding >= static_cast<size_t>(instrument.polyphony)) steal(pick_victim(incoming, instrument.stealing, true, first_new));
+    }
+    if (m_max_polyphony > 0) {
+        size_t sounding = std::count_if(m_active_voices.begin(), m_active_voices.end(), [](const std::unique_ptr<Voice>& v) {
+            return !v->is_fading();
+        });
+        if (sounding >= m_max_polyphony) steal(pick_victim(incoming, m_stealing, false, first_new));
+    }
+}
+
+Voice* AudioRenderer::pick_victim(const Voice& incoming, VoiceStealing stealing, bool same_instrument_only, size_t first_new) {
+    Voice* victim = nullptr;
+    bool victim_same = false, victim_heard = false;
+    for (size_t i = 0; i < m_active_voices.size(); ++i) {
+        Voice* v = m_active_voices[i].get();
+        if (v->is_fading()) continue;
+        bool same = same_instrument(*v, incoming);
+        if (same_instrument_only && !same) continue;
+        bool heard = i < first_new;
+
+        bool better = !victim;
+        if (victim) {
+            bool older = v->start_time_samples < victim->start_time_samples;
+            switch (stealing) {
+                case VoiceStealing::QUIETEST:
+                    // Voices that haven't played a block yet have no level to compare
+                    better = (heard && !victim_heard) || (heard == victim_heard && (heard ? v->last_peak < victim->last_peak : older));
+                    break;
+                case VoiceStealing::SAME_INSTRUMENT:
+                    better = (same && !victim_same) || (same == victim_same && older);
+                    break;
+                default:
+                    better = older;
+                    break;
+            }
+        }
+        if (better) {
+            victim = v;
+            victim_same = same;
+            victim_heard = heard;
+        }
+    }
+    return victim;
+}
+
+InstrumentCost& AudioRenderer::cost_of(const Voice& voice) {
+    const Patch* patch = voice.patch.get();
+    for (auto& entry : m_costs) {
+        if (entry.first == patch) return entry.second;
+    }
+    m_costs.emplace_back(patch, InstrumentCost());
+    m_costs.back().second.name = patch ? patch->instrument.name : "(cached)";
+    return m_costs.back().second;
+}
+
+std::vector<InstrumentCost> AudioRenderer::take_instrument_costs() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<InstrumentCost> costs;
+    for (auto& entry : m_costs) {
+        if (entry.second.voice_blocks == 0) continue;
+        costs.push_back(entry.second);
+        entry.second.seconds = 0;
+        entry.second.voice_blocks = 0;
+    }
+    return costs;
+}
+
+void AudioRenderer::set_max_polyphony(size_t voices, VoiceStealing stealing) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_polyphony = voices;
+    m_stealing = stealing;
+}
+
+void AudioRenderer::set_adaptive_quality(bool enabled) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_adaptive_quality = enabled;
+    m_governor.reset();
+    m_quality = QualityLevel::FULL;
+    m_quality_level.store(m_quality, std::memory_order_relaxed);
+}
+
 bool AudioRenderer::is_finished() const {
     std::lock_guard<std::mutex> lock(m_mutex);
-    return m_current_sample >= m_total_samples && m_active_voices.empty();
+    return voices_finished() && m_resampled_pos >= m_resampled.size();
 }
 
-std::vector<float> AudioRenderer::render(const Song& song, float sample_rate) {
+std::vector<float> AudioRenderer::render(const Song& song, float sample_rate, bool normalize) {
+    // Offline renders take as long as they need, so they never give up quality
+    bool adaptive_quality = m_adaptive_quality;
+    set_adaptive_quality(false);
     load(song, sample_rate);
+    // The whole song is synthesized first and converted in one pass at the end
+    std::unique_ptr<Resampler> resampler = std::move(m_resampler);
+    if (m_range_start_ms > 0) seek_to(m_range_start_ms, std::numeric_limits<double>::infinity());
+
+    long start_sample = m_current_sample;
+    long end_sample = m_total_samples;
+    bool has_end = m_range_end_ms >= 0;
+    if (has_end) end_sample = (std::min)(end_sample, static_cast<long>((m_range_end_ms / 1000.0) * m_sample_rate));
     
     std::vector<float> full_buffer;
-    full_buffer.reserve(m_total_samples * 2);
+    full_buffer.reserve((std::max)(0L, end_sample - start_sample) * 2);
 
     const int CHUNK_SIZE = 512;
     float chunk[CHUNK_SIZE * 2];
 
-    while (!is_finished()) {
+    while (!is_finished() && (!has_end || m_current_sample < end_sample)) {
         render_block(chunk, CHUNK_SIZE);
         full_buffer.insert(full_buffer.end(), chunk, chunk + (CHUNK_SIZE * 2));
     }
+    if (has_end) full_buffer.resize((std::max)(0L, end_sample - start_sample) * 2);
+    if (resampler) full_buffer = Resampler::convert(full_buffer, m_sample_rate, sample_rate);
+    set_adaptive_quality(adaptive_quality);
+    // The next run should find everything this one rendered
+    m_render_cache.wait_for_writes();
+
+    // Levels are reported as normalized either way
+    float gain = normalize ? AudioRenderer::normalize(full_buffer) : normalization_gain(full_buffer);
+    if (m_metering) publish_levels(gain);
+    return full_buffer;
+}
 
-    // Normalization
+float AudioRenderer::normalization_gain(const std::vector<float>& pcm) {
     float max_val = 0.0f;
-    for (float s : full_buffer) if (std::abs(s) > max_val) max_val = std::abs(s);
-    if (max_val > 0.0f) {
-        float gain = 0.9f / max_val;
-        for (float& s : full_buffer) s *= gain;
-    }
+    for (float s : pcm) if (std::abs(s) > max_val) max_val = std::abs(s);
+    return (max_val > 0.0f) ? 0.9f / max_val : 1.0f;
+}
 
-    return full_buffer;
+float AudioRenderer::normalize(std::vector<float>& pcm) {
+    float gain = normalization_gain(pcm);
+    if (gain != 1.0f) {
+        for (float& s : pcm) s *= gain;
+    }
+    return gain;
 }
 
 void AudioRenderer::print_soundfont_presets(const std::string& path) {
@@ -3,43 +3,234 @@
 
 #include "Song.h"
 #include "Voice.h"
+#include "SongScheduler.h"
+#include "RenderCache.h"
+#include "Patch.h"
+#include "VoicePool.h"
+#include "FilterBatch.h"
+#include "Resampler.h"
+#include "DspLoadMeter.h"
+#include "QualityGovernor.h"
+#include "ScopeBus.h"
+#include "LevelMeter.h"
+#include "TripleBuffer.h"
+#include <atomic>
 #include <vector>
+#include <deque>
 #include <map>
 #include <string>
 #include <memory>
 #include <mutex>
 
+// A song flattened ahead of the playhead by AudioRenderer::prepare_swap(), ready to replace the
+// loaded song while it plays
+struct SongSwap {
+    std::shared_ptr<SongElement> root;
+    SongScheduler scheduler;            // Advanced to horizon_ms
+    std::vector<ScheduledEvent> events; // Everything starting before horizon_ms, in start order
+    std::vector<std::string> keys;      // Content of each event (see RenderCache::make_key)
+    double horizon_ms = 0;
+    long total_samples = 0;
+    float sample_rate = 0;                  // Synthesis rate it was prepared for
+    std::map<std::string, tsf*> soundfonts; // Loaded for it and not yet handed to the renderer
+    std::map<std::string, std::shared_ptr<const RenderedSample>> samples; // All it uses, by path
+    ImpulseResponseMap impulse_responses;                                 // Likewise
+
+    ~SongSwap();
+};
+
+// What live song swaps did since the song was loaded
+struct SongSwapStats {
+    uint64_t swaps = 0;
+    size_t kept_voices = 0;     // Played on untouched
+    size_t replaced_voices = 0; // Were sounding or waiting, and changed or went away
+    size_t new_voices = 0;      // Started by the swaps, mid-way or ahead
+};
+
 class AudioRenderer {
 public:
     AudioRenderer();
     ~AudioRenderer();
     
     // --- Legacy Interface ---
-    std::vector<float> render(const Song& song, float sample_rate = 44100.0f);
+    // Without 'normalize' the mix keeps its level; normalize() scales it like render() would
+    std::vector<float> render(const Song& song, float sample_rate = 44100.0f, bool normalize = true);
+    // Scales 'pcm' to peak at 0.9 and returns the gain applied
+    static float normalize(std::vector<float>& pcm);
+    static float normalization_gain(const std::vector<float>& pcm);
+    // Limit render() to [start_ms, end_ms) of the song (end_ms < 0 renders to the end)
+    void set_render_range(double start_ms, double end_ms = -1.0) { m_range_start_ms = start_ms; m_range_end_ms = end_ms; }
+
+    // Synthesize at this rate and convert to the rate passed to load()/render() (0 = synthesize at that rate).
+    // One internal rate serves every output rate, and the song renders the same at all of them.
+    void set_internal_rate(float rate) { std::lock_guard<std::mutex> lock(m_mutex); m_internal_rate = rate; }
+    // Rate the voices run at for the loaded song
+    float get_render_rate() const { return m_sample_rate; }
 
     // --- Streaming Interface ---
     void load(const Song& song, float sample_rate = 44100.0f);
     void render_block(float* output, int frame_count);
     bool is_finished() const;
+    // Continue from 'ms' into the loaded song without rendering what comes before it. Voices
+    // already sounding there rebuild their effect tails from a pre-roll of at most
+    // SEEK_PREROLL_SECONDS over all of them, shortest first, so a seek from the UI holds the audio
+    // thread up only briefly; the voices beyond the budget get what is left of it.
+    void seek(double ms);
+    static constexpr double SEEK_PREROLL_SECONDS = 0.5;
     double get_current_time_ms() const { return (double)m_current_sample / m_sample_rate * 1000.0; }
-    double get_total_duration_ms() const { return (double)m_total_samples / m_sample_rate * 1000.0; }
+    double get_total_duration_ms() const { std::lock_guard<std::mutex> lock(m_mutex); return (double)m_total_samples / m_sample_rate * 1000.0; }
     size_t get_active_voice_count() const { std::lock_guard<std::mutex> lock(m_mutex); return m_active_voices.size(); }
-    size_t get_scheduled_voice_count() const { std::lock_guard<std::mutex> lock(m_mutex); return m_scheduled_voices.size(); }
+    // Voices currently materialized (waiting in the look-ahead window or playing)
+    size_t get_scheduled_voice_count() const { std::lock_guard<std::mutex> lock(m_mutex); return m_scheduled_voices.size() + m_active_voices.size(); }
+
+    // --- Live Updates ---
+    // Replace the loaded song with an edited version while it plays, keeping the playhead. Voices
+    // whose content and start time are unchanged play on untouched, with their effect tails and
+    // oscillator phases. Sounding voices that changed or went away fade out over
+    // SWAP_FADE_SECONDS; their new versions join mid-way with empty effects.
+    //
+    // prepare_swap() does the expensive part (flattening the song ahead of the playhead, loading
+    // its soundfonts and impulse responses) and may run on any thread while blocks render.
+    std::unique_ptr<SongSwap> prepare_swap(const Song& song);
+    // The swap takes over at the first multiple of 'grid_ms' of song time from the render position on
+    // (0: the next block), at the start of the block holding it, the granularity voices start at.
+    // Replaces a swap still waiting. load() drops a waiting swap, seek() takes it over at once.
+    void swap_song(std::unique_ptr<SongSwap> swap, double grid_ms = 0.0);
+    bool is_swap_pending() const { std::lock_guard<std::mutex> lock(m_mutex); return m_pending_swap != nullptr; }
+    SongSwapStats get_swap_stats() const { std::lock_guard<std::mutex> lock(m_mutex); return m_swap_stats; }
+    static constexpr double SWAP_FADE_SECONDS = 0.01;
+
+    // How far ahead of the playhead voices are constructed
+    void set_lookahead_ms(double ms) { std::lock_guard<std::mutex> lock(m_mutex); m_lookahead_ms = ms; }
+
+    // Replay identical voices (repeats, function calls, loops) from PCM instead of re-synthesizing
+    void set_render_cache_enabled(bool enabled) { std::lock_guard<std::mutex> lock(m_mutex); m_render_cache_enabled = enabled; }
+    size_t get_render_cache_hits() const { std::lock_guard<std::mutex> lock(m_mutex); return m_render_cache.get_hit_count(); }
+    // Also keep voice renders on disk so later runs only synthesize what changed (empty = off)
+    void set_cache_dir(const std::string& dir) { std::lock_guard<std::mutex> lock(m_mutex); m_render_cache.set_disk_dir(dir); }
+
+    // Distinct instrument patches and pooled voice slots, for memory diagnostics
+    size_t get_patch_count() const { std::lock_guard<std::mutex> lock(m_mutex); return m_patches.size(); }
+    size_t get_voice_pool_capacity() const { std::lock_guard<std::mutex> lock(m_mutex); return m_voice_pool.get_capacity(); }
+
+    // Time each voice's synthesis and charge it to its instrument (two clock reads per voice and block)
+    void set_profiling(bool enabled) { std::lock_guard<std::mutex> lock(m_mutex); m_profiling = enabled; }
+    // The costs accumulated since the last call; voices replayed from the render cache count as "(cached)"
+    std::vector<InstrumentCost> take_instrument_costs();
+
+    // Let render_block() trade synthesis quality for speed when blocks take too long to render, and
+    // restore it once the load has dropped (see QualityGovernor). render() always renders at full quality.
+    void set_adaptive_quality(bool enabled);
+    // How full the render-ahead buffer render_block() writes into is (0..1), so the governor doesn't
+    // step down while the buffer absorbs slow blocks. Negative (the default): no buffer.
+    void set_buffer_fill(double fraction) { std::lock_guard<std::mutex> lock(m_mutex); m_buffer_fill = fraction; }
+    QualityLevel get_quality_level() const { return m_quality_level.load(std::memory_order_relaxed); }
+
+    // Most voices that sound at once (0 = unlimited). A voice starting beyond the limit takes over from
+    // one picked by 'stealing', which fades out over STEAL_FADE_SECONDS. Instruments can set their own
+    // limit on top (Instrument::polyphony).
+    void set_max_polyphony(size_t voices, VoiceStealing stealing = VoiceStealing::OLDEST);
+    size_t get_stolen_voice_count() const { std::lock_guard<std::mutex> lock(m_mutex); return m_stolen_voices; }
+    static constexpr double STEAL_FADE_SECONDS = 0.01;
+
+    // Write each instrument's mix to its own track tap of 'scopes' (nullptr: none). Track taps run at
+    // the synthesis rate, and as far ahead of the output as the caller renders ahead.
+    void set_scope_bus(ScopeBus* scopes);
+
+    // Meter the mix and each instrument (see LevelMeter), publishing a LevelReport every control
+    // period. Levels are of the synthesized mix; render() reports them after its normalization.
+    void set_metering(bool enabled);
+    // The newest published levels. Call from one reader thread.
+    const LevelReport& read_levels() { return m_published_levels.read(); }
 
     // Helper to query soundfont
     static void print_soundfont_presets(const std::string& path);
 
 private:
-    float m_sample_rate = 44100.0f;
+    float m_sample_rate = 44100.0f; // Synthesis rate
+    float m_internal_rate = 0.0f;
+    float m_output_rate = 44100.0f;
+    std::unique_ptr<Resampler> m_resampler; // Synthesis to output rate, when they differ
+    std::vector<float> m_resampled;         // Converted frames not yet handed out
+    size_t m_resampled_pos = 0;
     long m_current_sample = 0;
     long m_total_samples = 0;
+    double m_range_start_ms = 0.0;
+    double m_range_end_ms = -1.0;
+    
+    double m_lookahead_ms = 2000.0;
     
     std::map<std::string, tsf*> m_soundfonts;
-    std::vector<std::unique_ptr<Voice>> m_scheduled_voices;
-    std::vector<Voice*> m_active_voices;
+    std::map<std::string, std::shared_ptr<const RenderedSample>> m_samples; // By path, at m_sample_rate
+    ImpulseResponseMap m_impulse_responses; // Likewise; nullptr for files that couldn't be read
+    std::shared_ptr<SongElement> m_root;
+    SongScheduler m_scheduler;
+    RenderCache m_render_cache;
+    bool m_render_cache_enabled = true;
+    std::vector<ScheduledEvent> m_event_scratch;
+    PatchTable m_patches;
+    VoicePool m_voice_pool; // Declared before the voices, which release their slots on destruction
+    std::deque<std::unique_ptr<Voice>> m_scheduled_voices;
+    std::vector<std::unique_ptr<Voice>> m_active_voices;
+    std::vector<VoiceBlock> m_voice_blocks; // Scratch per active voice, reused every block
+    std::vector<FilterLane> m_filter_lanes;
+    bool m_profiling = false;
+    std::vector<std::pair<const Patch*, InstrumentCost>> m_costs; // Few instruments: searched linearly
+    size_t m_max_polyphony = 0;
+    VoiceStealing m_stealing = VoiceStealing::OLDEST;
+    size_t m_stolen_voices = 0;
+    bool m_adaptive_quality = false;
+    QualityGovernor m_governor;
+    double m_buffer_fill = -1.0;
+    QualityLevel m_quality = QualityLevel::FULL; // Level of the next block
+    std::atomic<QualityLevel> m_quality_level{ QualityLevel::FULL };
+    ScopeBus* m_scopes = nullptr;
+    // One instrument's voices mixed, for its scope tap and level meter
+    struct TrackMix {
+        std::string name;
+        std::vector<float> mix; // Reused every block
+        int scope_tap = 0;      // 0: not assigned yet
+        LevelMeter meter;
+    };
+    std::vector<TrackMix> m_tracks; // Few instruments: searched linearly
+    bool m_metering = false;
+    LevelMeter m_master_meter;
+    LevelReport m_level_report;
+    TripleBuffer<LevelReport> m_published_levels;
+    std::unique_ptr<SongSwap> m_pending_swap;
+    long m_swap_sample = 0;
+    SongSwapStats m_swap_stats;
     mutable std::mutex m_mutex;
 
-    void flatten_song(std::shared_ptr<SongElement> element, double current_time_ms, const std::vector<Effect>& parent_effects);
+    // Load the soundfonts 'root' uses that neither 'known' nor 'loaded' hold into 'loaded', the
+    // samples and impulse responses missing from 'samples' and 'impulse_responses' into those, all at 'sample_rate'
+    static void preload_assets(const std::shared_ptr<SongElement>& root, float sample_rate,
+                               const std::map<std::string, tsf*>& known, std::map<std::string, tsf*>& loaded,
+                               std::map<std::string, std::shared_ptr<const RenderedSample>>& samples,
+                               ImpulseResponseMap& impulse_responses);
+    // Take over the song of 'swap' with its soundfonts, samples and impulse responses
+    void adopt_song(SongSwap& swap);
+    // Diff the pending swap against the voices and switch over, at the start of a block
+    void apply_swap();
+    void materialize_window();
+    void render_voices(float* output, int frame_count);
+    void render_resampled(float* output, int frame_count);
+    // Fade out voices the current quality level gives up
+    void shed_voices();
+    // Steal voices so 'incoming' fits the polyphony limits. Voices from index 'first_new' on started
+    // in this block and haven't been heard yet.
+    void make_room_for(const Voice& incoming, size_t first_new);
+    Voice* pick_victim(const Voice& incoming, VoiceStealing stealing, bool same_instrument_only, size_t first_new);
+    bool voices_finished() const { return m_current_sample >= m_total_samples && m_active_voices.empty(); }
+    std::unique_ptr<Voice> create_voice(const ScheduledEvent& ev, bool allow_record);
+    // seek() with a total pre-roll budget; offline renders pass no limit, so range exports match the full song
+    void seek_to(double ms, double preroll_budget_seconds);
+    // Synthesizing stand-in for a voice whose replayed recording was abandoned, at the same position
+    std::unique_ptr<Voice> resynthesize(const Voice& replay);
+    InstrumentCost& cost_of(const Voice& voice);
+    TrackMix& track_of(const Voice& voice, int frame_count);
+    // 'gain' scales the levels, e.g. by the normalization render() applied
+    void publish_levels(float gain = 1.0f);
 };
 
 #endif // AUDIO_RENDERER_H
\ No newline at end of file
@@ -3,6 +3,7 @@
 #endif
 #define _USE_MATH_DEFINES
 #include "AudioUtils.h"
+#include "FastMath.h"
 #include <cmath>
 #include <algorithm>
 #include <cstring>
@@ -28,49 +29,30 @@ void mix_buffers_stereo(float* target, const float* source, int target_frames, i
 }
 
 void get_pan_gains(float pan, float& left, float& right) {
-    float p = (pan + 1.0f) / 2.0f;
-    left = cos(p * M_PI / 2.0f);
-    right = sin(p * M_PI / 2.0f);
+    FastMath::pan_gains(pan, left, right, FastMath::get_precision());
 }
 
-void apply_effects(std::vector<float>& buffer, const std::vector<Effect>& effects, float sample_rate) {
-    apply_effects(buffer.data(), buffer.size() / 2, effects, sample_rate);
-}
-
-void apply_effects(float* buffer, int frame_count, const std::vector<Effect>& effects, float sample_rate) {
-    for (const auto& fx : effects) {
-        if (fx.type == EffectType::DELAY) {
-            // Note: Streaming delay is tricky without a persistent state buffer.
-            // For now, we'll implement simple delay if frame count allows.
-            // In a real refactor, Delay should be an object with state.
-        } 
-        else if (fx.type == EffectType::DISTORTION) {
-            float drive = fx.param1;
-            if (drive < 1.0f) drive = 1.0f;
-            for (int i = 0; i < frame_count * 2; ++i) {
-                buffer[i] = std::tanh(buffer[i] * drive);
-            }
+float generate_sample_with_phase(Waveform waveform, float freq, float sample_rate, float& phase, MathPrecision precision) {
+    float sample = 0;
+    if (precision == MathPrecision::EXACT) {
+        switch (waveform) {
+            case Waveform::SINE: sample = sin(phase); break;
+            case Waveform::SQUARE: sample = sin(phase) > 0 ? 1.0 : -1.0; break;
+            case Waveform::TRIANGLE: sample = asin(sin(phase)) * (2.0 / M_PI); break;
+            case Waveform::SAWTOOTH: sample = (2.0 / M_PI) * (fmod(phase, 2.0 * M_PI) - M_PI); break;
         }
-        else if (fx.type == EffectType::BITCRUSH) {
-            float depth = fx.param1;
-            if (depth < 1.0f) depth = 1.0f;
-            float steps = std::pow(2.0f, depth);
-            for (int i = 0; i < frame_count * 2; ++i) {
-                buffer[i] = std::round(buffer[i] * steps) / steps;
-            }
+    } else {
+        float turns = phase * static_cast<float>(0.5 / M_PI);
+        switch (waveform) {
+            case Waveform::SINE: sample = FastMath::sin(phase, precision); break;
+            case Waveform::SQUARE: sample = FastMath::sin(phase, precision) > 0 ? 1.0f : -1.0f; break;
+            // The same wave as asin(sin(phase)), folded straight from the phase
+            case Waveform::TRIANGLE: sample = 4.0f * std::fabs(turns - std::floor(turns + 0.75f) + 0.25f) - 1.0f; break;
+            case Waveform::SAWTOOTH: sample = 4.0f * (turns - std::floor(turns)) - 2.0f; break;
         }
-        // ... other effects ...
-    }
-}
-
-float generate_sample_with_phase(Waveform waveform, float freq, float sample_rate, float& phase) {
-    float sample = 0;
-    switch (waveform) {
-        case Waveform::SINE: sample = sin(phase); break;
-        case Waveform::SQUARE: sample = sin(phase) > 0 ? 1.0 : -1.0; break;
-        case Waveform::TRIANGLE: sample = asin(sin(phase)) * (2.0 / M_PI); break;
-        case Waveform::SAWTOOTH: sample = (2.0 / M_PI) * (fmod(phase, 2.0 * M_PI) - M_PI); break;
     }
     phase += 2.0 * M_PI * freq / sample_rate;
+    // Keep the phase small so float rounding doesn't detune long notes (and seeking can reproduce it)
+    if (phase >= 2.0 * M_PI) phase = std::fmod(phase, 2.0f * static_cast<float>(M_PI));
     return sample;
 }
@@ -0,0 +1,183 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#include "Convolver.h"
+#include "sndfile.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+namespace {
+    // Linear interpolation is enough here: an IR is a decaying noise-like tail
+    std::vector<float> resample(const std::vector<float>& in, double ratio) {
+        if (in.empty() || ratio == 1.0) return in;
+        size_t out_len = static_cast<size_t>(in.size() * ratio);
+        std::vector<float> out(out_len);
+        for (size_t i = 0; i < out_len; ++i) {
+            double pos = i / ratio;
+            size_t idx = static_cast<size_t>(pos);
+            float frac = static_cast<float>(pos - idx);
+            float a = in[(std::min)(idx, in.size() - 1)];
+            float b = in[(std::min)(idx + 1, in.size() - 1)];
+            out[i] = a + (b - a) * frac;
+        }
+        return out;
+    }
+}
+
+std::shared_ptr<const ImpulseResponse> ImpulseResponse::load(const std::string& path, float sample_rate) {
+    static std::mutex cache_mutex;
+    static std::map<std::string, std::shared_ptr<const ImpulseResponse>> cache;
+
+    // Edited files get a new key, so they are read again
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    std::string key = path + '|' + std::to_string(sample_rate) + '|' + std::to_string(ec ? 0 : mtime.time_since_epoch().count());
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+
+    SF_INFO info = {};
+    SNDFILE* file = sf_open(path.c_str(), SFM_READ, &info);
+    if (!file) {
+        std::cerr << "Error: Could not open impulse response " << path << std::endl;
+        cache[key] = nullptr; // Don't retry on every block
+        return nullptr;
+    }
+    std::vector<float> frames(static_cast<size_t>(info.frames) * info.channels);
+    sf_readf_float(file, frames.data(), info.frames);
+    sf_close(file);
+
+    std::vector<float> left(info.frames), right(info.frames);
+    for (sf_count_t i = 0; i < info.frames; ++i) {
+        left[i] = frames[i * info.channels];
+        right[i] = frames[i * info.channels + (info.channels > 1 ? 1 : 0)];
+    }
+    double ratio = sample_rate / info.samplerate;
+    auto ir = std::make_shared<const ImpulseResponse>(resample(left, ratio), resample(right, ratio));
+    cache[key] = ir;
+    return ir;
+}
+
+ImpulseResponse::ImpulseResponse(const std::vector<float>& left, const std::vector<float>& right)
+    : m_length((std::max)(left.size(), right.size())), m_head_left(HEAD_SIZE, 0.0f), m_head_right(HEAD_SIZE, 0.0f) {
+    double energy = 0;
+    for (float s : left) energy += s * s;
+    for (float s : right) energy += s * s;
+    float scale = energy > 0 ? static_cast<float>(1.0 / std::sqrt(energy / 2.0)) : 0.0f;
+    auto tap = [&](const std::vector<float>& h, size_t i) { return i < h.size() ? h[i] * scale : 0.0f; };
+
+    for (size_t i = 0; i < (std::min)(m_length, static_cast<size_t>(HEAD_SIZE)); ++i) {
+        m_head_left[HEAD_SIZE - 1 - i] = tap(left, i);
+        m_head_right[HEAD_SIZE - 1 - i] = tap(right, i);
+    }
+
+    for (size_t block = HEAD_SIZE; block < m_length; block *= STAGE_GROWTH) {
+        bool last = block >= static_cast<size_t>(MAX_PARTITION);
+        size_t end = last ? m_length : (std::min)(m_length, block * STAGE_GROWTH);
+        int size = static_cast<int>(block) * 2;
+        Stage stage{ static_cast<int>(block), FftPlan(size), {} };
+
+        for (size_t start = block; start < end; start += block) {
+            std::vector<std::complex<float>> spectrum(size);
+            for (size_t i = 0; i < block && start + i < end; ++i) {
+                spectrum[i] = std::complex<float>(tap(left, start + i), tap(right, start + i));
+            }
+            stage.plan.forward(spectrum.data());
+            for (auto& bin : spectrum) bin /= static_cast<float>(size);
+            stage.partitions.push_back(std::move(spectrum));
+        }
+        m_stages.push_back(std::move(stage));
+        if (last) break;
+    }
+}
+
+Convolver::Convolver(std::shared_ptr<const ImpulseResponse> ir)
+    : m_ir(std::move(ir)), m_history(ImpulseResponse::HEAD_SIZE * 2, 0.0f) {
+    for (const auto& stage : m_ir->get_stages()) {
+        StageState state;
+        size_t size = static_cast<size_t>(stage.block_size) * 2;
+        state.input.assign(size, 0.0f);
+        state.spectra.assign(size * stage.partitions.size(), std::complex<float>());
+        state.work.resize(size);
+        state.output.assign(stage.block_size, std::complex<float>());
+        m_stages.push_back(std::move(state));
+    }
+}
+
+void Convolver::reset() {
+    std::fill(m_history.begin(), m_history.end(), 0.0f);
+    m_history_pos = 0;
+    for (auto& state : m_stages) {
+        std::fill(state.input.begin(), state.input.end(), 0.0f);
+        std::fill(state.spectra.begin(), state.spectra.end(), std::complex<float>());
+        std::fill(state.output.begin(), state.output.end(), std::complex<float>());
+        state.newest = 0;
+        state.fill = 0;
+    }
+}
+
+void Convolver::process(float* buffer, int frames) {
+    const int head = ImpulseResponse::HEAD_SIZE;
+    const float* head_left = m_ir->get_head_left().data();
+    const float* head_right = m_ir->get_head_right().data();
+    const auto& stages = m_ir->get_stages();
+
+    for (int f = 0; f < frames; ++f) {
+        float x = (buffer[f * 2] + buffer[f * 2 + 1]) * 0.5f;
+
+        // Head: direct convolution over the newest HEAD_SIZE inputs, oldest first
+        m_history[m_history_pos] = x;
+        m_history[m_history_pos + head] = x;
+        const float* window = m_history.data() + m_history_pos + 1;
+        float left = 0.0f, right = 0.0f;
+        for (int i = 0; i < head; ++i) {
+            left += head_left[i] * window[i];
+            right += head_right[i] * window[i];
+        }
+        m_history_pos = (m_history_pos + 1) & (head - 1);
+
+        // Tail: every stage plays the block it computed when its previous input block completed
+        for (size_t s = 0; s < stages.size(); ++s) {
+            StageState& state = m_stages[s];
+            left += state.output[state.fill].real();
+            right += state.output[state.fill].imag();
+            state.input[stages[s].block_size + state.fill] = x;
+            if (++state.fill == stages[s].block_size) {
+                run_stage(stages[s], state);
+                state.fill = 0;
+            }
+        }
+
+        buffer[f * 2] += left * m_wet;
+        buffer[f * 2 + 1] += right * m_wet;
+    }
+}
+
+void Convolver::run_stage(const ImpulseResponse::Stage& stage, StageState& state) {
+    const size_t block = stage.block_size;
+    const size_t size = block * 2;
+    const size_t count = stage.partitions.size();
+
+    // Overlap-save: transform the previous and the new block together
+    for (size_t i = 0; i < size; ++i) state.work[i] = std::complex<float>(state.input[i], 0.0f);
+    stage.plan.forward(state.work.data());
+    state.newest = (state.newest + 1) % count;
+    std::copy(state.work.begin(), state.work.end(), state.spectra.begin() + state.newest * size);
+
+    // Partition p applies to the input p blocks ago
+    std::fill(state.work.begin(), state.work.end(), std::complex<float>());
+    for (size_t p = 0; p < count; ++p) {
+        const std::complex<float>* x = state.spectra.data() + ((state.newest + count - p) % count) * size;
+        const std::complex<float>* h = stage.partitions[p].data();
+        for (size_t i = 0; i < size; ++i) state.work[i] += complex_multiply(x[i], h[i]);
+    }
+    stage.plan.inverse(state.work.data());
+    std::copy(state.work.begin() + block, state.work.end(), state.output.begin());
+
+    std::copy(state.input.begin() + block, state.input.end(), state.input.begin());
+}
@@ -0,0 +1,84 @@
+#ifndef CONVOLVER_H
+#define CONVOLVER_H
+
+#include "Fft.h"
+#include <complex>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Impulse response read from a sound file, cut into partitions whose spectra are computed once.
+// The first taps are applied directly; the rest are split into stages of growing partition size,
+// where a stage with partitions of B samples covers the taps from B on. Each stage's output is
+// only needed B samples after its input block completes, so the whole convolution has no latency.
+class ImpulseResponse {
+public:
+    static constexpr int HEAD_SIZE = 64;        // Taps convolved in the time domain
+    static constexpr int STAGE_GROWTH = 8;      // Each stage's partitions are this much longer than the last's
+    static constexpr int MAX_PARTITION = 4096;  // The last stage keeps this size up to the end of the IR
+
+    struct Stage {
+        int block_size;
+        FftPlan plan; // Size 2 * block_size (overlap-save)
+        // Spectrum of each partition of left + i * right taps, scaled for the unscaled inverse FFT
+        std::vector<std::vector<std::complex<float>>> partitions;
+    };
+
+    // Shared by every convolver using the same file at the same rate, and kept for the rest of the
+    // process; nullptr if the file can't be read. Mono files feed both channels; the IR is
+    // normalized to unit energy.
+    static std::shared_ptr<const ImpulseResponse> load(const std::string& path, float sample_rate);
+
+    ImpulseResponse(const std::vector<float>& left, const std::vector<float>& right);
+
+    size_t get_length() const { return m_length; }
+    const std::vector<float>& get_head_left() const { return m_head_left; }
+    const std::vector<float>& get_head_right() const { return m_head_right; }
+    const std::vector<Stage>& get_stages() const { return m_stages; }
+
+private:
+    size_t m_length = 0;
+    std::vector<float> m_head_left, m_head_right; // Reversed, so the head is a dot product with the input history
+    std::vector<Stage> m_stages;
+};
+
+// Impulse responses resolved when a song is loaded, by file path
+using ImpulseResponseMap = std::map<std::string, std::shared_ptr<const ImpulseResponse>>;
+
+// Streaming convolution of one voice with a shared impulse response: the mono sum of the input
+// is convolved with the stereo IR and added on top of the dry signal.
+class Convolver {
+public:
+    explicit Convolver(std::shared_ptr<const ImpulseResponse> ir);
+
+    void set_wet(float wet) { m_wet = wet; }
+    // Adds the convolved signal to an interleaved stereo block in place
+    void process(float* buffer, int frames);
+    // Silences the history and the pending tail without reallocating
+    void reset();
+
+    static constexpr float DEFAULT_WET = 0.5f;
+
+private:
+    // Per-stage streaming state: input blocks, their spectra (frequency-domain delay line) and the
+    // output block currently being played
+    struct StageState {
+        std::vector<float> input;                      // Previous block, then the block being filled
+        std::vector<std::complex<float>> spectra;      // One spectrum per partition, as a ring
+        std::vector<std::complex<float>> work;
+        std::vector<std::complex<float>> output;       // Left in the real part, right in the imaginary part
+        size_t newest = 0;
+        int fill = 0;
+    };
+
+    std::shared_ptr<const ImpulseResponse> m_ir;
+    std::vector<float> m_history; // Last HEAD_SIZE inputs, stored twice so any window is contiguous
+    int m_history_pos = 0;
+    std::vector<StageState> m_stages;
+    float m_wet = DEFAULT_WET;
+
+    void run_stage(const ImpulseResponse::Stage& stage, StageState& state);
+};
+
+#endif // CONVOLVER_H
@@ -0,0 +1,47 @@
+#include "DelayLine.h"
+#include <algorithm>
+
+DelayLine DelayLinePool::acquire(int max_delay_frames) {
+    int bits = 0;
+    while ((1 << bits) < max_delay_frames) bits++;
+
+    DelayLine line;
+    line.mask = (1 << bits) - 1;
+    if (static_cast<size_t>(bits) < m_free.size() && !m_free[bits].empty()) {
+        line.buffer = std::move(m_free[bits].back());
+        m_free[bits].pop_back();
+        m_pooled_bytes -= line.buffer.size() * sizeof(float);
+        std::fill(line.buffer.begin(), line.buffer.end(), 0.0f);
+    } else {
+        line.buffer.assign(static_cast<size_t>(2) << bits, 0.0f);
+        // Room for every line of this size to come back without release() allocating
+        if (m_free.size() <= static_cast<size_t>(bits)) {
+            m_free.resize(bits + 1);
+            m_allocated.resize(bits + 1, 0);
+        }
+        m_free[bits].reserve(++m_allocated[bits]);
+    }
+    return line;
+}
+
+void DelayLinePool::release(DelayLine& line) {
+    if (line.empty()) return;
+    int bits = 0;
+    while ((1 << bits) < line.get_capacity()) bits++;
+    m_pooled_bytes += line.buffer.size() * sizeof(float);
+    m_free[bits].push_back(std::move(line.buffer));
+    line.buffer = std::vector<float>();
+    line.mask = 0;
+    line.pos = 0;
+}
+
+void DelayLinePool::trim() {
+    // Largest lines first: they free the most memory per line
+    for (size_t bits = m_free.size(); bits-- > 0 && m_pooled_bytes > m_budget_bytes; ) {
+        while (!m_free[bits].empty() && m_pooled_bytes > m_budget_bytes) {
+            m_pooled_bytes -= m_free[bits].back().size() * sizeof(float);
+            m_free[bits].pop_back();
+            m_allocated[bits]--;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef DELAY_LINE_H
+#define DELAY_LINE_H
+
+#include <vector>
+#include <cstddef>
+
+// Stereo ring buffer with a power-of-two length, so reads and writes wrap with a mask
+struct DelayLine {
+    std::vector<float> buffer; // Interleaved stereo
+    int mask = 0;              // Frames - 1
+    int pos = 0;               // Frame written next
+
+    bool empty() const { return buffer.empty(); }
+    int get_capacity() const { return mask + 1; }
+
+    // 'delay' frames back, 1 <= delay <= capacity
+    float read(int channel, int delay) const { return buffer[((pos - delay) & mask) * 2 + channel]; }
+
+    // Linearly interpolated, for modulated delays; 1 <= delay < capacity
+    float read_fractional(int channel, float delay) const {
+        int whole = static_cast<int>(delay);
+        float frac = delay - whole;
+        float a = read(channel, whole);
+        float b = read(channel, whole + 1);
+        return a + (b - a) * frac;
+    }
+
+    void write(float left, float right) {
+        buffer[pos * 2] = left;
+        buffer[pos * 2 + 1] = right;
+        pos = (pos + 1) & mask;
+    }
+};
+
+// Recycles delay line memory between voices. Lines are grouped by their power-of-two length,
+// so a released line can serve any later voice needing that size. release() never frees or
+// allocates, so voices can end on the audio thread; trim() gives memory back outside of it.
+class DelayLinePool {
+public:
+    // A zeroed line holding at least 'max_delay_frames' frames of history
+    DelayLine acquire(int max_delay_frames);
+    void release(DelayLine& line);
+    // Frees pooled lines beyond the budget
+    void trim();
+
+    void set_budget_bytes(size_t bytes) { m_budget_bytes = bytes; }
+    size_t get_pooled_bytes() const { return m_pooled_bytes; }
+
+private:
+    std::vector<std::vector<std::vector<float>>> m_free; // Indexed by log2 of the frame count
+    std::vector<size_t> m_allocated;                      // Lines of each size in existence, pooled or not
+    size_t m_pooled_bytes = 0;
+    size_t m_budget_bytes = 64 * 1024 * 1024; // trim() frees pooled lines beyond this
+};
+
+#endif // DELAY_LINE_H
@@ -0,0 +1,77 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#include "DspLoadMeter.h"
+#include <algorithm>
+#include <cstring>
+
+void DspLoadMeter::reset(float sample_rate, double window_seconds) {
+    m_sample_rate = sample_rate;
+    m_window_seconds = window_seconds;
+    m_audio_seconds = m_render_seconds = m_voice_seconds = 0;
+    m_min = m_max = 0;
+    m_window_blocks = 0;
+    m_instruments.clear();
+    m_callback_max = 0.0f;
+    m_stats = DspStats();
+    m_published.publish(m_stats);
+}
+
+bool DspLoadMeter::add_block(double seconds, int frames, size_t active_voices) {
+    double audio = frames / static_cast<double>(m_sample_rate);
+    float load = static_cast<float>(seconds / audio);
+    m_min = m_window_blocks == 0 ? load : (std::min)(m_min, load);
+    m_max = m_window_blocks == 0 ? load : (std::max)(m_max, load);
+    m_audio_seconds += audio;
+    m_render_seconds += seconds;
+    m_voice_seconds += active_voices * audio;
+    m_window_blocks++;
+    m_stats.blocks++;
+    if (load > 1.0f) m_stats.deadline_misses++;
+    return m_audio_seconds >= m_window_seconds;
+}
+
+void DspLoadMeter::add_callback(double seconds, int frames) {
+    float load = static_cast<float>(seconds * m_sample_rate / frames);
+    float previous = m_callback_max.load(std::memory_order_relaxed);
+    while (load > previous && !m_callback_max.compare_exchange_weak(previous, load, std::memory_order_relaxed)) {}
+}
+
+void DspLoadMeter::add_instruments(const std::vector<InstrumentCost>& costs) {
+    for (const auto& cost : costs) {
+        auto it = std::find_if(m_instruments.begin(), m_instruments.end(), [&](const InstrumentCost& c) { return c.name == cost.name; });
+        if (it == m_instruments.end()) {
+            m_instruments.push_back(cost);
+        } else {
+            it->seconds += cost.seconds;
+            it->voice_blocks += cost.voice_blocks;
+        }
+    }
+}
+
+void DspLoadMeter::publish() {
+    if (m_audio_seconds <= 0) return;
+    m_stats.load_min = m_min;
+    m_stats.load_max = m_max;
+    m_stats.load_avg = static_cast<float>(m_render_seconds / m_audio_seconds);
+    m_stats.callback_load_max = m_callback_max.exchange(0.0f, std::memory_order_relaxed);
+    m_stats.active_voices = static_cast<float>(m_voice_seconds / m_audio_seconds);
+
+    std::sort(m_instruments.begin(), m_instruments.end(), [](const InstrumentCost& a, const InstrumentCost& b) { return a.seconds > b.seconds; });
+    double instrument_seconds = 0;
+    m_stats.instrument_count = 0;
+    for (const auto& cost : m_instruments) {
+        instrument_seconds += cost.seconds;
+        if (m_stats.instrument_count == DspStats::MAX_INSTRUMENTS) continue;
+        DspStats::Instrument& out = m_stats.instruments[m_stats.instrument_count++];
+        std::strncpy(out.name, cost.name.c_str(), sizeof(out.name) - 1);
+        out.name[sizeof(out.name) - 1] = '\0';
+        out.load = static_cast<float>(cost.seconds / m_audio_seconds);
+    }
+    m_stats.load_per_voice = m_voice_seconds > 0 ? static_cast<float>(instrument_seconds / m_voice_seconds) : 0.0f;
+
+    m_published.publish(m_stats);
+    m_audio_seconds = m_render_seconds = m_voice_seconds = 0;
+    m_window_blocks = 0;
+    m_instruments.clear();
+}
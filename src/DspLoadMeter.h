@@ -0,0 +1,75 @@
+#ifndef DSP_LOAD_METER_H
+#define DSP_LOAD_METER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TripleBuffer.h"
+#include "QualityGovernor.h"
+
+// Synthesis time spent on one instrument's voices
+struct InstrumentCost {
+    std::string name;
+    double seconds = 0;
+    size_t voice_blocks = 0; // Voice renders that took it
+};
+
+// DSP load as a fraction of real time: 1.0 means synthesis only just keeps up with playback
+struct DspStats {
+    static constexpr int MAX_INSTRUMENTS = 8;
+    struct Instrument {
+        char name[32];
+        float load;
+    };
+
+    // Per rendered block, over the last window
+    float load_min = 0, load_avg = 0, load_max = 0;
+    // The audio callback's share of its period, at its worst in the last window
+    float callback_load_max = 0;
+    // Average active voices, and the load one of them costs (with instrument profiling on)
+    float active_voices = 0;
+    float load_per_voice = 0;
+    uint64_t blocks = 0;
+    // Blocks that took longer to render than the audio they hold; enough of them in a row underrun
+    uint64_t deadline_misses = 0;
+    uint64_t underruns = 0;
+    // Voices cut short by a polyphony limit since playback started
+    uint64_t stolen_voices = 0;
+    // Where adaptive quality currently stands (playback only)
+    QualityLevel quality = QualityLevel::FULL;
+    // Costliest instruments first (with instrument profiling on)
+    Instrument instruments[MAX_INSTRUMENTS] = {};
+    int instrument_count = 0;
+};
+
+// Collects render and callback timings and publishes a DspStats snapshot once per window of audio.
+// The renderer's thread feeds it; add_callback() may be called from the audio callback at the same
+// time, and read() from one more thread.
+class DspLoadMeter {
+public:
+    void reset(float sample_rate, double window_seconds = 0.5);
+
+    // One rendered block: the wall time it took. Returns true when the window is complete, so the
+    // caller can add_instruments() before publish().
+    bool add_block(double seconds, int frames, size_t active_voices);
+    void add_callback(double seconds, int frames);
+    void add_instruments(const std::vector<InstrumentCost>& costs);
+    void publish();
+
+    const DspStats& read() { return m_published.read(); }
+
+private:
+    float m_sample_rate = 44100.0f;
+    double m_window_seconds = 0.5;
+    // Window accumulators
+    double m_audio_seconds = 0, m_render_seconds = 0, m_voice_seconds = 0;
+    float m_min = 0, m_max = 0;
+    int m_window_blocks = 0;
+    std::vector<InstrumentCost> m_instruments;
+    std::atomic<float> m_callback_max{ 0.0f };
+    DspStats m_stats;
+    TripleBuffer<DspStats> m_published;
+};
+
+#endif // DSP_LOAD_METER_H
@@ -2,6 +2,7 @@
 #define EFFECT_H
 
 #include <vector>
+#include <string>
 
 enum class EffectType {
     NONE,
@@ -11,7 +12,10 @@ enum class EffectType {
     FADE_IN,    // Volume ramp up
     FADE_OUT,   // Volume ramp down
     TREMOLO,    // Amplitude modulation
-    REVERB      // Reverb
+    REVERB,     // Reverb
+    CONVOLVE,   // Convolution with a recorded impulse response
+    CHORUS,     // Detuned doubling from a slowly swept delay
+    FLANGER     // Comb sweep from a short swept delay with feedback
 };
 
 struct Effect {
@@ -19,6 +23,7 @@ struct Effect {
     float param1 = 0.0f;
     float param2 = 0.0f;
     float param3 = 0.0f;
+    std::string path; // Impulse response file (CONVOLVE)
     
     // Helper constructors could be added here
 };
@@ -0,0 +1,327 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#define _USE_MATH_DEFINES
+#include "EffectProcessor.h"
+#include "ReverbProcessor.h"
+#include "Convolver.h"
+#include "Oversampler.h"
+#include "FastMath.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace {
+    // 'effect distortion <drive> [oversample]' (and bitcrush): 2, 4 or 8, otherwise the voice rate
+    int oversample_factor(const Effect& fx) {
+        if (fx.type != EffectType::DISTORTION && fx.type != EffectType::BITCRUSH) return 1;
+        int factor = static_cast<int>(std::lround(fx.param2));
+        return factor >= 8 ? 8 : factor >= 4 ? 4 : factor >= 2 ? 2 : 1;
+    }
+
+    bool is_stateless(const Effect& fx) {
+        if (fx.type == EffectType::DISTORTION || fx.type == EffectType::BITCRUSH) return oversample_factor(fx) == 1;
+        return fx.type == EffectType::TREMOLO || fx.type == EffectType::FADE_IN || fx.type == EffectType::FADE_OUT;
+    }
+
+    // Gain and a run of stateless effects, applied frame by frame in one pass
+    class FusedStages : public EffectProcessor {
+    public:
+        FusedStages(float gain, double pass_duration_samples) : m_gain(gain), m_pass_duration(pass_duration_samples) {}
+
+        void add(const Effect& fx) { m_effects.push_back(fx); }
+
+        void prepare(float sample_rate) override {
+            m_sample_rate = sample_rate;
+            m_precision = FastMath::get_precision();
+            for (const auto& fx : m_effects) {
+                Stage stage{ fx.type, fx.param1, fx.param2 };
+                if (fx.type == EffectType::BITCRUSH) {
+                    stage.a = std::pow(2.0f, fx.param1); // Steps
+                } else if (fx.type == EffectType::FADE_IN || fx.type == EffectType::FADE_OUT) {
+                    stage.a = (fx.param1 / 1000.0f) * sample_rate; // Duration
+                    stage.b = static_cast<float>(m_pass_duration - stage.a); // Where the fade out starts
+                }
+                m_stages.push_back(stage);
+            }
+        }
+
+        void process(const EffectBlock& block) override {
+            float* s = block.samples;
+            for (int f = 0; f < block.frame_count; ++f) {
+                float left = s[f * 2] * m_gain;
+                float right = s[f * 2 + 1] * m_gain;
+                double position = block.position[f];
+                for (const Stage& stage : m_stages) {
+                    switch (stage.type) {
+                        case EffectType::DISTORTION:
+                            left = FastMath::tanh(left * stage.a, m_precision);
+                            right = FastMath::tanh(right * stage.a, m_precision);
+                            break;
+                        case EffectType::BITCRUSH:
+                            left = FastMath::round(left * stage.a, m_precision) / stage.a;
+                            right = FastMath::round(right * stage.a, m_precision) / stage.a;
+                            break;
+                        case EffectType::TREMOLO: {
+                            float mod = 1.0f - stage.b * (0.5f * (1.0f + FastMath::sin(2.0f * M_PI * stage.a * position / m_sample_rate, m_precision)));
+                            left *= mod;
+                            right *= mod;
+                            break;
+                        }
+                        case EffectType::FADE_IN:
+                            if (position < stage.a) {
+                                float gain = static_cast<float>(position / stage.a);
+                                left *= gain;
+                                right *= gain;
+                            }
+                            break;
+                        case EffectType::FADE_OUT:
+                            if (position > stage.b) {
+                                float gain = 1.0f - static_cast<float>((position - stage.b) / stage.a);
+                                if (gain < 0) gain = 0;
+                                left *= gain;
+                                right *= gain;
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                s[f * 2] = left;
+                s[f * 2 + 1] = right;
+            }
+        }
+
+    private:
+        struct Stage {
+            EffectType type;
+            float a, b; // Parameters, with the per-block constants folded in
+        };
+
+        float m_gain;
+        double m_pass_duration;
+        float m_sample_rate = 44100.0f;
+        MathPrecision m_precision = MathPrecision::EXACT;
+        std::vector<Effect> m_effects;
+        std::vector<Stage> m_stages;
+    };
+
+    // Distortion or bitcrush run at a multiple of the voice rate, so the harmonics it adds above the
+    // voice's Nyquist frequency are filtered out instead of folding back as aliases
+    class OversampledShaper : public EffectProcessor {
+    public:
+        OversampledShaper(const Effect& fx, int factor)
+            : m_fx(fx), m_channels{ Oversampler(factor), Oversampler(factor) }, m_steps(std::pow(2.0f, fx.param1)),
+              m_precision(FastMath::get_precision()) {}
+
+        void process(const EffectBlock& block) override {
+            int factor = m_channels[0].get_factor();
+            int count = block.frame_count * factor;
+            m_work.resize(count);
+            for (int c = 0; c < 2; ++c) {
+                m_channels[c].upsample(block.samples + c, 2, block.frame_count, m_work.data());
+                if (m_fx.type == EffectType::DISTORTION) {
+                    FastMath::tanh(m_work.data(), count, m_fx.param1, m_precision);
+                } else {
+                    for (int i = 0; i < count; ++i) m_work[i] = FastMath::round(m_work[i] * m_steps, m_precision) / m_steps;
+                }
+                m_channels[c].downsample(m_work.data(), block.frame_count, block.samples + c, 2);
+            }
+        }
+
+        void reset() override {
+            for (auto& channel : m_channels) channel.reset();
+        }
+
+        // The round trip's delay, to the nearest frame
+        int get_latency() const override { return static_cast<int>(std::lround(m_channels[0].get_latency())); }
+
+    private:
+        Effect m_fx;
+        Oversampler m_channels[2];
+        float m_steps; // Bitcrush levels
+        MathPrecision m_precision;
+        std::vector<float> m_work;
+    };
+
+    // Echo with feedback, on a pooled line sized for its delay. Delays shorter than a frame echo one frame later.
+    class DelayEffect : public EffectProcessor {
+    public:
+        DelayEffect(const Effect& fx, DelayLinePool& pool) : m_fx(fx), m_pool(pool) {}
+        ~DelayEffect() override { m_pool.release(m_line); }
+
+        void prepare(float sample_rate) override {
+            m_delay = (std::max)(1, static_cast<int>((m_fx.param1 / 1000.0f) * sample_rate));
+            m_line = m_pool.acquire(m_delay);
+        }
+
+        void process(const EffectBlock& block) override {
+            float* s = block.samples;
+            float feedback = m_fx.param2;
+            for (int f = 0; f < block.frame_count; ++f) {
+                s[f * 2] += m_line.read(0, m_delay) * feedback;
+                s[f * 2 + 1] += m_line.read(1, m_delay) * feedback;
+                m_line.write(s[f * 2], s[f * 2 + 1]);
+            }
+        }
+
+        void reset() override {
+            std::fill(m_line.buffer.begin(), m_line.buffer.end(), 0.0f);
+            m_line.pos = 0;
+        }
+
+    private:
+        Effect m_fx;
+        DelayLinePool& m_pool;
+        DelayLine m_line;
+        int m_delay = 1;
+    };
+
+    // A short delay swept by a sine; the chorus sweeps the channels a quarter cycle apart
+    class ModulatedDelayEffect : public EffectProcessor {
+    public:
+        ModulatedDelayEffect(const Effect& fx, DelayLinePool& pool) : m_fx(fx), m_pool(pool) {}
+        ~ModulatedDelayEffect() override { m_pool.release(m_line); }
+
+        void prepare(float sample_rate) override {
+            m_sample_rate = sample_rate;
+            m_flanger = m_fx.type == EffectType::FLANGER;
+            m_precision = FastMath::get_precision();
+            m_base = ((m_flanger ? EffectChain::FLANGER_BASE_MS : EffectChain::CHORUS_BASE_MS) / 1000.0f) * sample_rate;
+            m_depth = (std::max)(0.0f, m_fx.param2 / 1000.0f) * sample_rate;
+            m_line = m_pool.acquire(static_cast<int>(m_base + m_depth) + 2);
+        }
+
+        void process(const EffectBlock& block) override {
+            float* s = block.samples;
+            float rate = m_fx.param1;
+            float amount = m_flanger ? (std::max)(-EffectChain::MAX_FLANGER_FEEDBACK, (std::min)(m_fx.param3, EffectChain::MAX_FLANGER_FEEDBACK)) : m_fx.param3;
+            for (int f = 0; f < block.frame_count; ++f) {
+                float angle = static_cast<float>(2.0 * M_PI * rate * (block.position[f] / m_sample_rate));
+                float sweep_left = 0.5f + 0.5f * FastMath::sin(angle, m_precision);
+                float sweep_right = m_flanger ? sweep_left : 0.5f + 0.5f * FastMath::cos(angle, m_precision);
+                float wet_left = m_line.read_fractional(0, m_base + m_depth * sweep_left);
+                float wet_right = m_line.read_fractional(1, m_base + m_depth * sweep_right);
+                float dry_left = s[f * 2];
+                float dry_right = s[f * 2 + 1];
+                if (m_flanger) {
+                    m_line.write(dry_left + wet_left * amount, dry_right + wet_right * amount);
+                    s[f * 2] = dry_left + wet_left;
+                    s[f * 2 + 1] = dry_right + wet_right;
+                } else {
+                    m_line.write(dry_left, dry_right);
+                    s[f * 2] = dry_left + wet_left * amount;
+                    s[f * 2 + 1] = dry_right + wet_right * amount;
+                }
+            }
+        }
+
+        void reset() override {
+            std::fill(m_line.buffer.begin(), m_line.buffer.end(), 0.0f);
+            m_line.pos = 0;
+        }
+
+    private:
+        Effect m_fx;
+        DelayLinePool& m_pool;
+        DelayLine m_line;
+        float m_sample_rate = 44100.0f;
+        float m_base = 0, m_depth = 0;
+        bool m_flanger = false;
+        MathPrecision m_precision = MathPrecision::EXACT;
+    };
+
+    class ReverbEffect : public EffectProcessor {
+    public:
+        explicit ReverbEffect(const Effect& fx) : m_fx(fx) {}
+
+        void prepare(float sample_rate) override {
+            m_reverb = std::make_unique<ReverbProcessor>(sample_rate);
+            m_reverb->set_params(m_fx.param1, m_fx.param2, m_fx.param3);
+        }
+        void process(const EffectBlock& block) override { m_reverb->process(block.samples, block.frame_count); }
+        void reset() override { m_reverb->reset(); }
+
+    private:
+        Effect m_fx;
+        std::unique_ptr<ReverbProcessor> m_reverb;
+    };
+
+    // The convolver is built with the voice, from the impulse response resolved when the song was loaded
+    class ConvolveEffect : public EffectProcessor {
+    public:
+        ConvolveEffect(const Effect& fx, const std::shared_ptr<const ImpulseResponse>& ir) : m_convolver(ir) {
+            m_convolver.set_wet(fx.param1);
+        }
+
+        void process(const EffectBlock& block) override { m_convolver.process(block.samples, block.frame_count); }
+        void reset() override { m_convolver.reset(); }
+
+    private:
+        Convolver m_convolver;
+    };
+}
+
+EffectChain::EffectChain(const std::vector<Effect>& effects, float gain, float sample_rate, double pass_duration_samples,
+                         DelayLinePool& delay_lines, const ImpulseResponseMap& impulse_responses) {
+    FusedStages* fused = nullptr; // Open run of stateless stages
+    if (gain != 1.0f) {
+        auto stage = std::make_unique<FusedStages>(gain, pass_duration_samples);
+        fused = stage.get();
+        m_stages.push_back(std::move(stage));
+    }
+
+    for (const auto& fx : effects) {
+        if (is_stateless(fx)) {
+            if (!fused) {
+                auto stage = std::make_unique<FusedStages>(1.0f, pass_duration_samples);
+                fused = stage.get();
+                m_stages.push_back(std::move(stage));
+            }
+            fused->add(fx);
+            continue;
+        }
+
+        std::unique_ptr<EffectProcessor> stage;
+        switch (fx.type) {
+            case EffectType::DISTORTION:
+            case EffectType::BITCRUSH: stage = std::make_unique<OversampledShaper>(fx, oversample_factor(fx)); break;
+            case EffectType::DELAY: stage = std::make_unique<DelayEffect>(fx, delay_lines); break;
+            case EffectType::CHORUS:
+            case EffectType::FLANGER: stage = std::make_unique<ModulatedDelayEffect>(fx, delay_lines); break;
+            case EffectType::REVERB: stage = std::make_unique<ReverbEffect>(fx); break;
+            case EffectType::CONVOLVE: {
+                // A file that couldn't be read leaves the voice dry
+                auto it = impulse_responses.find(fx.path);
+                if (it != impulse_responses.end() && it->second) {
+                    stage = std::make_unique<ConvolveEffect>(fx, it->second);
+                    m_impulse_length += it->second->get_length();
+                }
+                break;
+            }
+            default: break;
+        }
+        if (stage) {
+            m_stages.push_back(std::move(stage));
+            fused = nullptr;
+        }
+    }
+    for (auto& stage : m_stages) stage->prepare(sample_rate);
+}
+
+void EffectChain::process(const EffectBlock& block) {
+    for (auto& stage : m_stages) stage->process(block);
+}
+
+void EffectChain::reset() {
+    for (auto& stage : m_stages) stage->reset();
+}
+
+int EffectChain::get_latency() const {
+    int latency = 0;
+    for (const auto& stage : m_stages) latency += stage->get_latency();
+    return latency;
+}
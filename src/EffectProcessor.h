@@ -0,0 +1,62 @@
+#ifndef EFFECT_PROCESSOR_H
+#define EFFECT_PROCESSOR_H
+
+#include "Effect.h"
+#include "DelayLine.h"
+#include "Convolver.h"
+#include <memory>
+#include <vector>
+
+// One block of a voice's output on its way through the effects
+struct EffectBlock {
+    float* samples;          // Interleaved stereo, processed in place
+    int frame_count;
+    const double* position;  // Each frame's position in the current pass, so per-pass effects restart on every loop
+};
+
+// One stage of an effect chain
+class EffectProcessor {
+public:
+    virtual ~EffectProcessor() = default;
+
+    // Allocates the stage's state; called once, when the chain is built
+    virtual void prepare(float sample_rate) { (void)sample_rate; }
+    virtual void process(const EffectBlock& block) = 0;
+    // Forgets all history, as if no block had been processed
+    virtual void reset() {}
+    // Frames the stage delays its input by
+    virtual int get_latency() const { return 0; }
+};
+
+// A voice's instrument gain and effects, in order. Consecutive stateless effects (distortion,
+// bitcrush, tremolo, fades) share one stage that makes a single pass over the block.
+// Stages are prepared with the chain, when the voice is created, so the audio thread never
+// allocates effect state for a voice that starts playing.
+class EffectChain {
+public:
+    // Centre of the swept delay of a chorus or flanger, before the depth is added
+    static constexpr float CHORUS_BASE_MS = 15.0f;
+    static constexpr float FLANGER_BASE_MS = 1.0f;
+    // Flanger feedback is clamped to this, so the comb can't ring on forever or blow up
+    static constexpr float MAX_FLANGER_FEEDBACK = 0.95f;
+
+    EffectChain() = default;
+    EffectChain(const std::vector<Effect>& effects, float gain, float sample_rate, double pass_duration_samples,
+                DelayLinePool& delay_lines, const ImpulseResponseMap& impulse_responses);
+
+    bool empty() const { return m_stages.empty(); }
+    size_t get_stage_count() const { return m_stages.size(); }
+    // Total length of the chain's impulse responses: how long its convolution tails ring
+    size_t get_impulse_length() const { return m_impulse_length; }
+    // Frames the whole chain delays the voice by (oversampled stages); the voice renders ahead by this much
+    int get_latency() const;
+
+    void process(const EffectBlock& block);
+    void reset();
+
+private:
+    std::vector<std::unique_ptr<EffectProcessor>> m_stages;
+    size_t m_impulse_length = 0;
+};
+
+#endif // EFFECT_PROCESSOR_H
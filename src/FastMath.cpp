@@ -0,0 +1,132 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#define _USE_MATH_DEFINES
+#include "FastMath.h"
+#include "Simd.h"
+#include <atomic>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Set from the MUSEQ_MATH_PRECISION CMake option
+#ifndef MUSEQ_DEFAULT_MATH_PRECISION
+    #define MUSEQ_DEFAULT_MATH_PRECISION "exact"
+#endif
+
+namespace {
+    std::atomic<int>& active_precision() {
+        static std::atomic<int> precision([] {
+            MathPrecision configured = MathPrecision::EXACT;
+            FastMath::parse_precision(MUSEQ_DEFAULT_MATH_PRECISION, configured);
+            return static_cast<int>(configured);
+        }());
+        return precision;
+    }
+
+    // 440 * 2^((n - 69) / 12) for every MIDI note, rounded once from double
+    struct SemitoneTable {
+        float hz[128];
+        SemitoneTable() {
+            for (int n = 0; n < 128; ++n) hz[n] = static_cast<float>(440.0 * std::pow(2.0, (n - 69) / 12.0));
+        }
+    };
+    const SemitoneTable semitones;
+
+#if MUSEQ_SIMD_X86
+    inline __m128 clamp_ps(__m128 x, float limit) {
+        return _mm_min_ps(_mm_set1_ps(limit), _mm_max_ps(_mm_set1_ps(-limit), x));
+    }
+
+    // Four lanes of detail::tanh_high / tanh_fast
+    inline __m128 tanh_high_ps(__m128 x) {
+        x = clamp_ps(x, 7.9053111f);
+        __m128 x2 = _mm_mul_ps(x, x);
+        __m128 p = _mm_set1_ps(-2.76076847742355e-16f);
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(2.00018790482477e-13f));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-8.60467152213735e-11f));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(5.12229709037114e-08f));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.48572235717979e-05f));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(6.37261928875436e-04f));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(4.89352455891786e-03f));
+        __m128 q = _mm_set1_ps(1.19825839466702e-06f);
+        q = _mm_add_ps(_mm_mul_ps(q, x2), _mm_set1_ps(1.18534705686654e-04f));
+        q = _mm_add_ps(_mm_mul_ps(q, x2), _mm_set1_ps(2.26843463243900e-03f));
+        q = _mm_add_ps(_mm_mul_ps(q, x2), _mm_set1_ps(4.89352518554385e-03f));
+        return _mm_div_ps(_mm_mul_ps(x, p), q);
+    }
+
+    inline __m128 tanh_fast_ps(__m128 x) {
+        x = clamp_ps(x, 3.6470f);
+        __m128 x2 = _mm_mul_ps(x, x);
+        __m128 num = _mm_add_ps(_mm_set1_ps(105.0f), x2);
+        num = _mm_mul_ps(x, _mm_add_ps(_mm_set1_ps(945.0f), _mm_mul_ps(x2, num)));
+        __m128 den = _mm_add_ps(_mm_set1_ps(420.0f), _mm_mul_ps(x2, _mm_set1_ps(15.0f)));
+        den = _mm_add_ps(_mm_set1_ps(945.0f), _mm_mul_ps(x2, den));
+        return clamp_ps(_mm_div_ps(num, den), 1.0f);
+    }
+#endif
+}
+
+MathPrecision FastMath::get_precision() {
+    return static_cast<MathPrecision>(active_precision().load(std::memory_order_relaxed));
+}
+
+void FastMath::set_precision(MathPrecision precision) {
+    active_precision().store(static_cast<int>(precision), std::memory_order_relaxed);
+}
+
+const char* FastMath::get_precision_name(MathPrecision precision) {
+    switch (precision) {
+        case MathPrecision::HIGH: return "high";
+        case MathPrecision::FAST: return "fast";
+        default: return "exact";
+    }
+}
+
+bool FastMath::parse_precision(const std::string& name, MathPrecision& out) {
+    if (name == "exact") out = MathPrecision::EXACT;
+    else if (name == "high") out = MathPrecision::HIGH;
+    else if (name == "fast") out = MathPrecision::FAST;
+    else return false;
+    return true;
+}
+
+void FastMath::tanh(float* x, int count, float drive, MathPrecision precision) {
+    int i = 0;
+    if (precision == MathPrecision::EXACT) {
+        for (; i < count; ++i) x[i] = std::tanh(x[i] * drive);
+        return;
+    }
+#if MUSEQ_SIMD_X86
+    const __m128 gain = _mm_set1_ps(drive);
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(x + i), gain);
+        _mm_storeu_ps(x + i, precision == MathPrecision::HIGH ? tanh_high_ps(v) : tanh_fast_ps(v));
+    }
+#endif
+    for (; i < count; ++i) x[i] = tanh(x[i] * drive, precision);
+}
+
+void FastMath::pan_gains(float pan, float& left, float& right, MathPrecision precision) {
+    float p = (pan + 1.0f) / 2.0f;
+    if (precision == MathPrecision::EXACT) {
+        left = std::cos(p * M_PI / 2.0f);
+        right = std::sin(p * M_PI / 2.0f);
+        return;
+    }
+    // sin of the angle and of its complement, both in [0, pi/2] for pan in [-1, 1]
+    float angle = p * detail::HALF_PI;
+    left = sin(static_cast<double>(detail::HALF_PI - angle), precision);
+    right = sin(static_cast<double>(angle), precision);
+}
+
+float FastMath::midi_to_hz(float pitch, MathPrecision precision) {
+    if (precision == MathPrecision::EXACT) return 440.0f * std::pow(2.0f, (pitch - 69.0f) / 12.0f);
+    float whole = std::floor(pitch);
+    if (whole < 0.0f || whole > 127.0f) return 440.0f * exp2((pitch - 69.0f) / 12.0f, precision);
+    float hz = semitones.hz[static_cast<int>(whole)];
+    float fraction = pitch - whole;
+    return fraction == 0.0f ? hz : hz * exp2(fraction / 12.0f, precision);
+}
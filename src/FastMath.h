@@ -0,0 +1,182 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// How the DSP hot loops evaluate exp2, tanh, sin and the pan law. EXACT calls libm exactly as the
+// renderer always has (renders are bit-identical); HIGH is accurate to a few float ulps; FAST trades
+// accuracy (around 1e-4, 1e-3 for tanh) for the shortest polynomials.
+enum class MathPrecision {
+    EXACT,
+    HIGH,
+    FAST
+};
+
+// Branch-free polynomial and rational approximations that the compiler can vectorize. Each
+// function takes the tier explicitly; processors read get_precision() once when they are set up.
+namespace FastMath {
+    // The tier configured by the MUSEQ_MATH_PRECISION build option, until set_precision() changes it
+    MathPrecision get_precision();
+    void set_precision(MathPrecision precision);
+    const char* get_precision_name(MathPrecision precision);
+    // "exact", "high" or "fast"
+    bool parse_precision(const std::string& name, MathPrecision& out);
+
+    namespace detail {
+        constexpr double TWO_PI = 6.283185307179586476925;
+        constexpr float HALF_PI = 1.5707963267948966f;
+        constexpr float PI = 3.1415926535897932f;
+
+        // 2^n for an integer n in [-126, 127], built from the exponent bits
+        inline float pow2i(int n) {
+            uint32_t bits = static_cast<uint32_t>(n + 127) << 23;
+            float out;
+            std::memcpy(&out, &bits, sizeof(out));
+            return out;
+        }
+
+        // Minimax fits of 2^f on [-0.5, 0.5]: relative error 2.5e-7 in float (degree 5) and 7.5e-5 (degree 3)
+        inline float exp2_high(float x) {
+            x = (std::min)(127.0f, (std::max)(-126.0f, x));
+            float n = std::floor(x + 0.5f);
+            float f = x - n;
+            float p = 1.3276487e-3f;
+            p = p * f + 9.6755467e-3f;
+            p = p * f + 5.5507133e-2f;
+            p = p * f + 2.4022120e-1f;
+            p = p * f + 6.9314697e-1f;
+            p = p * f + 1.0000001f;
+            return p * pow2i(static_cast<int>(n));
+        }
+
+        inline float exp2_fast(float x) {
+            x = (std::min)(127.0f, (std::max)(-126.0f, x));
+            float n = std::floor(x + 0.5f);
+            float f = x - n;
+            float p = 5.5171874e-2f;
+            p = p * f + 2.4261164e-1f;
+            p = p * f + 6.9326100e-1f;
+            p = p * f + 9.9992804e-1f;
+            return p * pow2i(static_cast<int>(n));
+        }
+
+        // 13/6 rational fit, exact to float precision once clamped (abs. error 3.3e-7)
+        inline float tanh_high(float x) {
+            x = (std::min)(7.9053111f, (std::max)(-7.9053111f, x));
+            float x2 = x * x;
+            float p = -2.76076847742355e-16f;
+            p = p * x2 + 2.00018790482477e-13f;
+            p = p * x2 - 8.60467152213735e-11f;
+            p = p * x2 + 5.12229709037114e-08f;
+            p = p * x2 + 1.48572235717979e-05f;
+            p = p * x2 + 6.37261928875436e-04f;
+            p = p * x2 + 4.89352455891786e-03f;
+            float q = 1.19825839466702e-06f;
+            q = q * x2 + 1.18534705686654e-04f;
+            q = q * x2 + 2.26843463243900e-03f;
+            q = q * x2 + 4.89352518554385e-03f;
+            return x * p / q;
+        }
+
+        // Lambert's continued fraction cut at 5/4, clamped where it reaches 1 (abs. error 1.4e-3)
+        inline float tanh_fast(float x) {
+            x = (std::min)(3.6470f, (std::max)(-3.6470f, x));
+            float x2 = x * x;
+            float y = x * (945.0f + x2 * (105.0f + x2)) / (945.0f + x2 * (420.0f + x2 * 15.0f));
+            return (std::min)(1.0f, (std::max)(-1.0f, y));
+        }
+
+        // Reduces x to [-pi/2, pi/2] with the same sine. The whole-turn part is removed in double,
+        // so large arguments (a sweep's phase after minutes of audio) keep their precision.
+        inline float reduce_sin_argument(double x) {
+            double turns = std::floor(x * (1.0 / TWO_PI) + 0.5);
+            float r = static_cast<float>(x - turns * TWO_PI);
+            if (r > HALF_PI) r = PI - r;
+            if (r < -HALF_PI) r = -PI - r;
+            return r;
+        }
+
+        // Odd minimax fits of sin on [-pi/2, pi/2]: abs. error 2.3e-7 in float (degree 9) and 6.8e-5 (degree 5)
+        inline float sin_high_reduced(float r) {
+            float r2 = r * r;
+            float p = 2.5904842e-6f;
+            p = p * r2 - 1.9800896e-4f;
+            p = p * r2 + 8.3328998e-3f;
+            p = p * r2 - 1.6666648e-1f;
+            p = p * r2 + 9.9999998e-1f;
+            return p * r;
+        }
+
+        inline float sin_fast_reduced(float r) {
+            float r2 = r * r;
+            float p = 7.5143246e-3f;
+            p = p * r2 - 1.6567295e-1f;
+            p = p * r2 + 9.9969671e-1f;
+            return p * r;
+        }
+    }
+
+    // 2^x; EXACT is std::pow(2.0f, x)
+    inline float exp2(float x, MathPrecision precision) {
+        switch (precision) {
+            case MathPrecision::HIGH: return detail::exp2_high(x);
+            case MathPrecision::FAST: return detail::exp2_fast(x);
+            default: return std::pow(2.0f, x);
+        }
+    }
+
+    inline float tanh(float x, MathPrecision precision) {
+        switch (precision) {
+            case MathPrecision::HIGH: return detail::tanh_high(x);
+            case MathPrecision::FAST: return detail::tanh_fast(x);
+            default: return std::tanh(x);
+        }
+    }
+
+    // In place: x[i] = tanh(x[i] * drive). The tier is chosen once for the block.
+    void tanh(float* x, int count, float drive, MathPrecision precision);
+
+    // Sine of an angle in radians; the double overload reduces large angles in double precision
+    inline float sin(float x, MathPrecision precision) {
+        switch (precision) {
+            case MathPrecision::HIGH: return detail::sin_high_reduced(detail::reduce_sin_argument(x));
+            case MathPrecision::FAST: return detail::sin_fast_reduced(detail::reduce_sin_argument(x));
+            default: return std::sin(x);
+        }
+    }
+
+    inline double sin(double x, MathPrecision precision) {
+        switch (precision) {
+            case MathPrecision::HIGH: return detail::sin_high_reduced(detail::reduce_sin_argument(x));
+            case MathPrecision::FAST: return detail::sin_fast_reduced(detail::reduce_sin_argument(x));
+            default: return std::sin(x);
+        }
+    }
+
+    inline float cos(float x, MathPrecision precision) {
+        if (precision == MathPrecision::EXACT) return std::cos(x);
+        return sin(static_cast<double>(x) + detail::TWO_PI / 4.0, precision);
+    }
+
+    // Rounds to the nearest integer. EXACT is std::round; the others round halves to even by adding
+    // and removing 1.5 * 2^23, which needs no rounding instruction.
+    inline float round(float x, MathPrecision precision) {
+        if (precision == MathPrecision::EXACT) return std::round(x);
+        if (std::fabs(x) >= 4194304.0f) return x; // Already whole
+        const float magic = 12582912.0f;
+        return (x + magic) - magic;
+    }
+
+    // Constant-power pan law: pan -1 (left) .. 1 (right) to cos/sin gains
+    void pan_gains(float pan, float& left, float& right, MathPrecision precision);
+
+    // 440 * 2^((pitch - 69) / 12). HIGH and FAST look whole semitones up in a table and apply the
+    // fractional part with exp2, so in-tune notes get correctly rounded frequencies.
+    float midi_to_hz(float pitch, MathPrecision precision);
+}
+
+#endif // FAST_MATH_H
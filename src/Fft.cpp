@@ -0,0 +1,84 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#include "Fft.h"
+#include <cmath>
+#include <utility>
+
+namespace {
+    const double PI = 3.14159265358979323846;
+}
+
+FftPlan::FftPlan(int size) : m_size(size), m_bit_reverse(size), m_twiddles(size / 2) {
+    int bits = 0;
+    while ((1 << bits) < size) bits++;
+    for (int i = 0; i < size; ++i) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        }
+        m_bit_reverse[i] = r;
+    }
+    // Computed in double, so large sizes don't accumulate rounding error
+    for (int k = 0; k < size / 2; ++k) {
+        double angle = -2.0 * PI * k / size;
+        m_twiddles[k] = std::complex<float>(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+    }
+}
+
+void FftPlan::forward(std::complex<float>* data) const {
+    transform(data, false);
+}
+
+void FftPlan::inverse(std::complex<float>* data) const {
+    transform(data, true);
+}
+
+void FftPlan::transform(std::complex<float>* data, bool inverse) const {
+    for (int i = 0; i < m_size; ++i) {
+        int j = m_bit_reverse[i];
+        if (i < j) std::swap(data[i], data[j]);
+    }
+    for (int len = 2; len <= m_size; len <<= 1) {
+        int half = len / 2;
+        int stride = m_size / len;
+        for (int i = 0; i < m_size; i += len) {
+            for (int j = 0; j < half; ++j) {
+                std::complex<float> w = m_twiddles[j * stride];
+                if (inverse) w = std::conj(w);
+                std::complex<float> u = data[i + j];
+                std::complex<float> v = complex_multiply(data[i + j + half], w);
+                data[i + j] = u + v;
+                data[i + j + half] = u - v;
+            }
+        }
+    }
+}
+
+RealFftPlan::RealFftPlan(int size) : m_size(size), m_half(size / 2), m_twiddles(size / 4 + 1) {
+    for (int k = 0; k <= size / 4; ++k) {
+        double angle = -2.0 * PI * k / size;
+        m_twiddles[k] = std::complex<float>(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+    }
+}
+
+void RealFftPlan::forward(const float* input, std::complex<float>* out) const {
+    // Even samples as the real parts and odd ones as the imaginary parts of a half-size transform
+    int half = m_size / 2;
+    for (int n = 0; n < half; ++n) out[n] = std::complex<float>(input[2 * n], input[2 * n + 1]);
+    m_half.forward(out);
+
+    // Untangle the even and odd spectra, bins k and half - k together so it can run in place
+    std::complex<float> z0 = out[0];
+    out[0] = std::complex<float>(z0.real() + z0.imag(), 0.0f);
+    out[half] = std::complex<float>(z0.real() - z0.imag(), 0.0f);
+    for (int k = 1; k <= half / 2; ++k) {
+        int m = half - k;
+        std::complex<float> zk = out[k], zm = std::conj(out[m]);
+        std::complex<float> even = (zk + zm) * 0.5f;
+        std::complex<float> odd = complex_multiply(zk - zm, std::complex<float>(0.0f, -0.5f));
+        std::complex<float> twisted = complex_multiply(odd, m_twiddles[k]);
+        out[k] = even + twisted;
+        out[m] = std::conj(even - twisted);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <vector>
+
+// Radix-2 complex FFT of one fixed size. Bit-reversal order and twiddles are computed
+// once in the constructor, so transforms don't call sin/cos.
+class FftPlan {
+public:
+    explicit FftPlan(int size); // 'size' must be a power of two
+
+    int get_size() const { return m_size; }
+
+    // In place. The inverse is unscaled: forward followed by inverse multiplies by get_size().
+    void forward(std::complex<float>* data) const;
+    void inverse(std::complex<float>* data) const;
+
+private:
+    int m_size;
+    std::vector<int> m_bit_reverse;
+    std::vector<std::complex<float>> m_twiddles; // e^(-2 pi i k / size) for k < size / 2
+
+    void transform(std::complex<float>* data, bool inverse) const;
+};
+
+// FFT of real input of one fixed size, computed as a complex FFT of half the size. Twiddles for
+// separating the two interleaved halves are computed once in the constructor.
+class RealFftPlan {
+public:
+    explicit RealFftPlan(int size); // 'size' must be a power of two, at least 4
+
+    int get_size() const { return m_size; }
+
+    // Writes the get_size() / 2 + 1 bins from DC to Nyquist to 'out'. The other half of the
+    // spectrum is their mirror image.
+    void forward(const float* input, std::complex<float>* out) const;
+
+private:
+    int m_size;
+    FftPlan m_half;
+    std::vector<std::complex<float>> m_twiddles; // e^(-2 pi i k / size) for k <= size / 4
+};
+
+// Plain product without the NaN/infinity recovery of std::complex's operator*, which
+// compilers can't inline and which dominates spectral loops
+inline std::complex<float> complex_multiply(std::complex<float> a, std::complex<float> b) {
+    return std::complex<float>(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+#endif // FFT_H
@@ -0,0 +1,108 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#include "FilterBatch.h"
+
+namespace {
+    void process_scalar(VoicePool& pool, const FilterLane& lane, int frame_count) {
+        BiquadState& filter = pool.filter(lane.slot);
+        for (int f = 0; f < frame_count; ++f) {
+            if (lane.gate[f] > 0.0f) lane.samples[f] = filter.process(lane.samples[f]);
+        }
+    }
+
+#if MUSEQ_SIMD_X86
+    // BiquadState keeps its delay line in float, so every stored value is rounded like the scalar path
+    inline __m128d round_to_float(__m128d v) { return _mm_cvtps_pd(_mm_cvtpd_ps(v)); }
+    inline __m128d select(__m128d mask, __m128d a, __m128d b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+
+    void process_sse2(VoicePool& pool, const FilterLane* lanes, int frame_count) {
+        BiquadState& s0 = pool.filter(lanes[0].slot);
+        BiquadState& s1 = pool.filter(lanes[1].slot);
+        const __m128d a0 = _mm_set_pd(s1.a0, s0.a0);
+        const __m128d a1 = _mm_set_pd(s1.a1, s0.a1);
+        const __m128d a2 = _mm_set_pd(s1.a2, s0.a2);
+        const __m128d b1 = _mm_set_pd(s1.b1, s0.b1);
+        const __m128d b2 = _mm_set_pd(s1.b2, s0.b2);
+        __m128d z1 = _mm_set_pd(s1.z1, s0.z1);
+        __m128d z2 = _mm_set_pd(s1.z2, s0.z2);
+        const __m128d zero = _mm_setzero_pd();
+        float* x0 = lanes[0].samples;
+        float* x1 = lanes[1].samples;
+
+        for (int f = 0; f < frame_count; ++f) {
+            __m128d in = _mm_set_pd(x1[f], x0[f]);
+            __m128d open = _mm_cmpgt_pd(_mm_set_pd(lanes[1].gate[f], lanes[0].gate[f]), zero);
+            __m128d out = round_to_float(_mm_add_pd(_mm_mul_pd(in, a0), z1));
+            __m128d next_z1 = round_to_float(_mm_sub_pd(_mm_add_pd(_mm_mul_pd(in, a1), z2), _mm_mul_pd(b1, out)));
+            __m128d next_z2 = round_to_float(_mm_sub_pd(_mm_mul_pd(in, a2), _mm_mul_pd(b2, out)));
+            z1 = select(open, next_z1, z1);
+            z2 = select(open, next_z2, z2);
+
+            double result[2];
+            _mm_storeu_pd(result, select(open, out, in));
+            x0[f] = static_cast<float>(result[0]);
+            x1[f] = static_cast<float>(result[1]);
+        }
+
+        double zs1[2], zs2[2];
+        _mm_storeu_pd(zs1, z1);
+        _mm_storeu_pd(zs2, z2);
+        s0.z1 = static_cast<float>(zs1[0]); s0.z2 = static_cast<float>(zs2[0]);
+        s1.z1 = static_cast<float>(zs1[1]); s1.z2 = static_cast<float>(zs2[1]);
+    }
+
+    MUSEQ_TARGET_AVX2 inline __m256d round_to_float_avx(__m256d v) { return _mm256_cvtps_pd(_mm256_cvtpd_ps(v)); }
+
+    MUSEQ_TARGET_AVX2 void process_avx2(VoicePool& pool, const FilterLane* lanes, int frame_count) {
+        BiquadState* s[4];
+        for (int l = 0; l < 4; ++l) s[l] = &pool.filter(lanes[l].slot);
+        const __m256d a0 = _mm256_set_pd(s[3]->a0, s[2]->a0, s[1]->a0, s[0]->a0);
+        const __m256d a1 = _mm256_set_pd(s[3]->a1, s[2]->a1, s[1]->a1, s[0]->a1);
+        const __m256d a2 = _mm256_set_pd(s[3]->a2, s[2]->a2, s[1]->a2, s[0]->a2);
+        const __m256d b1 = _mm256_set_pd(s[3]->b1, s[2]->b1, s[1]->b1, s[0]->b1);
+        const __m256d b2 = _mm256_set_pd(s[3]->b2, s[2]->b2, s[1]->b2, s[0]->b2);
+        __m256d z1 = _mm256_set_pd(s[3]->z1, s[2]->z1, s[1]->z1, s[0]->z1);
+        __m256d z2 = _mm256_set_pd(s[3]->z2, s[2]->z2, s[1]->z2, s[0]->z2);
+        const __m256d zero = _mm256_setzero_pd();
+        float* x[4] = { lanes[0].samples, lanes[1].samples, lanes[2].samples, lanes[3].samples };
+        const float* g[4] = { lanes[0].gate, lanes[1].gate, lanes[2].gate, lanes[3].gate };
+
+        for (int f = 0; f < frame_count; ++f) {
+            __m256d in = _mm256_cvtps_pd(_mm_set_ps(x[3][f], x[2][f], x[1][f], x[0][f]));
+            __m256d open = _mm256_cmp_pd(_mm256_cvtps_pd(_mm_set_ps(g[3][f], g[2][f], g[1][f], g[0][f])), zero, _CMP_GT_OQ);
+            __m256d out = round_to_float_avx(_mm256_add_pd(_mm256_mul_pd(in, a0), z1));
+            __m256d next_z1 = round_to_float_avx(_mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(in, a1), z2), _mm256_mul_pd(b1, out)));
+            __m256d next_z2 = round_to_float_avx(_mm256_sub_pd(_mm256_mul_pd(in, a2), _mm256_mul_pd(b2, out)));
+            z1 = _mm256_blendv_pd(z1, next_z1, open);
+            z2 = _mm256_blendv_pd(z2, next_z2, open);
+
+            float result[4];
+            _mm_storeu_ps(result, _mm256_cvtpd_ps(_mm256_blendv_pd(in, out, open)));
+            for (int l = 0; l < 4; ++l) x[l][f] = result[l];
+        }
+
+        float zs1[4], zs2[4];
+        _mm_storeu_ps(zs1, _mm256_cvtpd_ps(z1));
+        _mm_storeu_ps(zs2, _mm256_cvtpd_ps(z2));
+        for (int l = 0; l < 4; ++l) {
+            s[l]->z1 = zs1[l];
+            s[l]->z2 = zs2[l];
+        }
+    }
+#endif
+}
+
+void FilterBatch::process(VoicePool& pool, const FilterLane* lanes, size_t count, int frame_count) {
+    size_t i = 0;
+#if MUSEQ_SIMD_X86
+    SimdLevel level = Simd::get_level();
+    if (level == SimdLevel::AVX2) {
+        for (; i + 4 <= count; i += 4) process_avx2(pool, lanes + i, frame_count);
+    }
+    if (level != SimdLevel::SCALAR) {
+        for (; i + 2 <= count; i += 2) process_sse2(pool, lanes + i, frame_count);
+    }
+#endif
+    for (; i < count; ++i) process_scalar(pool, lanes[i], frame_count);
+}
@@ -0,0 +1,28 @@
+#ifndef FILTER_BATCH_H
+#define FILTER_BATCH_H
+
+#include "VoicePool.h"
+#include "Simd.h"
+#include <cstddef>
+
+// One voice's deferred filter: its pool slot and the mono block to filter in place
+struct FilterLane {
+    size_t slot;
+    float* samples;
+    const float* gate; // Where the gate is 0 the sample passes through and the filter state holds
+};
+
+// Runs the biquads of many voices side by side, one voice per SIMD lane
+// (2 per step with SSE2, 4 with AVX2; see Simd for the level in use).
+// A biquad's feedback makes every sample depend on the previous one, so a single voice
+// can't be vectorized over time, but independent voices can share each step.
+// Lanes compute in double precision exactly like BiquadState::process(), so every
+// instruction set produces the same output as the scalar path.
+// Only filters are batched: oscillators and envelopes stay in the per-voice kernels, whose
+// note timing branches differ per voice and whose waveforms would change if vectorized.
+class FilterBatch {
+public:
+    static void process(VoicePool& pool, const FilterLane* lanes, size_t count, int frame_count);
+};
+
+#endif // FILTER_BATCH_H
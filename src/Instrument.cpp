@@ -53,6 +53,8 @@ Instrument::Instrument(const Instrument& other)
       portamento_time(other.portamento_time),
       pan(other.pan),
       gain(other.gain),
+      polyphony(other.polyphony),
+      stealing(other.stealing),
       effects(other.effects) {
     if (other.sampler) {
         sampler = new Sampler(*other.sampler);
@@ -75,6 +77,8 @@ Instrument& Instrument::operator=(const Instrument& other) {
     portamento_time = other.portamento_time;
     pan = other.pan;
     gain = other.gain;
+    polyphony = other.polyphony;
+    stealing = other.stealing;
     effects = other.effects;
 
     if (sampler) {
@@ -102,6 +106,8 @@ Instrument::Instrument(Instrument&& other) noexcept
       portamento_time(other.portamento_time),
       pan(other.pan),
       gain(other.gain),
+      polyphony(other.polyphony),
+      stealing(other.stealing),
       effects(std::move(other.effects)) {
     other.sampler = nullptr;
 }
@@ -122,6 +128,8 @@ Instrument& Instrument::operator=(Instrument&& other) noexcept {
     portamento_time = other.portamento_time;
     pan = other.pan;
     gain = other.gain;
+    polyphony = other.polyphony;
+    stealing = other.stealing;
     effects = std::move(other.effects);
 
     if (sampler) {
@@ -35,6 +35,13 @@ enum class LFOTarget {
     FILTER_CUTOFF
 };
 
+// Which playing voice makes room when a polyphony limit is reached. The victim fades out quickly.
+enum class VoiceStealing {
+    OLDEST,         // The voice that started first
+    QUIETEST,       // The voice with the lowest output level
+    SAME_INSTRUMENT // The oldest voice of the new voice's instrument, else the oldest overall
+};
+
 struct LFO {
     LFOTarget target = LFOTarget::NONE;
     Waveform waveform = Waveform::SINE;
@@ -70,6 +77,8 @@ public:
     float portamento_time = 0.0f; // In milliseconds
     float pan = 0.0f; // -1.0 to 1.0
     float gain = 1.0f; // 0.0 to 1.0+
+    int polyphony = 0; // Voices of this instrument that play at once (0 = unlimited)
+    VoiceStealing stealing = VoiceStealing::OLDEST;
     
     // Effects Chain
     std::vector<Effect> effects;
@@ -0,0 +1,202 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#include "LevelMeter.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const double PI = 3.14159265358979323846;
+
+    float energy_to_lufs(double energy) {
+        if (energy <= 0.0) return Levels::SILENCE_LUFS;
+        return (std::max)(Levels::SILENCE_LUFS, static_cast<float>(-0.691 + 10.0 * std::log10(energy)));
+    }
+
+    // Transposed direct form II, as BiquadState does
+    inline double biquad(const double* c, double* z, double in) {
+        double out = c[0] * in + z[0];
+        z[0] = c[1] * in - c[3] * out + z[1];
+        z[1] = c[2] * in - c[4] * out;
+        return out;
+    }
+
+#if MUSEQ_SIMD_X86
+    inline __m128d biquad_sse2(const double* c, __m128d& z1, __m128d& z2, __m128d in) {
+        __m128d out = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(c[0]), in), z1);
+        z1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(_mm_set1_pd(c[1]), in), _mm_mul_pd(_mm_set1_pd(c[3]), out)), z2);
+        z2 = _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(c[2]), in), _mm_mul_pd(_mm_set1_pd(c[4]), out));
+        return out;
+    }
+#endif
+}
+
+Levels Levels::scaled(float gain) const {
+    if (gain == 1.0f) return *this;
+    Levels l = *this;
+    float db = 20.0f * std::log10(gain);
+    for (float* amplitude : { &l.peak, &l.rms, &l.max_peak, &l.overall_rms }) *amplitude *= gain;
+    for (float* lufs : { &l.momentary_lufs, &l.short_term_lufs, &l.max_momentary_lufs, &l.max_short_term_lufs, &l.integrated_lufs }) {
+        if (*lufs > SILENCE_LUFS) *lufs = (std::max)(SILENCE_LUFS, *lufs + db);
+    }
+    return l;
+}
+
+void LevelMeter::reset(float sample_rate) {
+    // K-weighting for any rate, from the analog prototypes behind the 48 kHz coefficients of BS.1770
+    double k = std::tan(PI * 1681.974450955533 / sample_rate);
+    double q = 0.7071752369554196;
+    double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    m_shelf[0] = (vh + vb * k / q + k * k) / a0;
+    m_shelf[1] = 2.0 * (k * k - vh) / a0;
+    m_shelf[2] = (vh - vb * k / q + k * k) / a0;
+    m_shelf[3] = 2.0 * (k * k - 1.0) / a0;
+    m_shelf[4] = (1.0 - k / q + k * k) / a0;
+
+    k = std::tan(PI * 38.13547087602444 / sample_rate);
+    q = 0.5003270373238773;
+    a0 = 1.0 + k / q + k * k;
+    m_high_pass[0] = 1.0;
+    m_high_pass[1] = -2.0;
+    m_high_pass[2] = 1.0;
+    m_high_pass[3] = 2.0 * (k * k - 1.0) / a0;
+    m_high_pass[4] = (1.0 - k / q + k * k) / a0;
+
+    std::fill(&m_state[0][0], &m_state[0][0] + 8, 0.0);
+    m_hop_frames = (std::max)(1, static_cast<int>(std::lround(sample_rate * HOP_SECONDS)));
+    m_hop_filled = 0;
+    m_hop_energy = m_hop_squares = 0;
+    m_hop_peak = 0.0f;
+    std::fill(m_hop_energies, m_hop_energies + SHORT_TERM_HOPS, 0.0);
+    m_hop_index = 0;
+    m_hops = 0;
+    m_total_squares = 0;
+    m_total_frames = 0;
+    std::fill(m_histogram, m_histogram + HISTOGRAM_BINS, 0u);
+    m_levels = Levels();
+}
+
+bool LevelMeter::process(const float* stereo, int frames) {
+    bool updated = false;
+    while (frames > 0) {
+        int take = (std::min)(frames, m_hop_frames - m_hop_filled);
+        double energy = 0, squares = 0;
+        float peak = m_hop_peak;
+        int f = 0;
+#if MUSEQ_SIMD_X86
+        if (Simd::get_level() != SimdLevel::SCALAR) {
+            // Left and right share each step
+            __m128d shelf_z1 = _mm_set_pd(m_state[1][0], m_state[0][0]), shelf_z2 = _mm_set_pd(m_state[1][1], m_state[0][1]);
+            __m128d high_z1 = _mm_set_pd(m_state[1][2], m_state[0][2]), high_z2 = _mm_set_pd(m_state[1][3], m_state[0][3]);
+            __m128d energy_sum = _mm_setzero_pd(), square_sum = _mm_setzero_pd(), peak_max = _mm_setzero_pd();
+            const __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+            for (; f < take; ++f) {
+                __m128d in = _mm_set_pd(stereo[f * 2 + 1], stereo[f * 2]);
+                __m128d weighted = biquad_sse2(m_high_pass, high_z1, high_z2, biquad_sse2(m_shelf, shelf_z1, shelf_z2, in));
+                energy_sum = _mm_add_pd(energy_sum, _mm_mul_pd(weighted, weighted));
+                square_sum = _mm_add_pd(square_sum, _mm_mul_pd(in, in));
+                peak_max = _mm_max_pd(peak_max, _mm_and_pd(in, abs_mask));
+            }
+            double lanes[2];
+            _mm_storeu_pd(lanes, energy_sum);
+            energy = lanes[0] + lanes[1];
+            _mm_storeu_pd(lanes, square_sum);
+            squares = lanes[0] + lanes[1];
+            _mm_storeu_pd(lanes, peak_max);
+            peak = (std::max)(peak, static_cast<float>((std::max)(lanes[0], lanes[1])));
+            _mm_storeu_pd(lanes, shelf_z1); m_state[0][0] = lanes[0]; m_state[1][0] = lanes[1];
+            _mm_storeu_pd(lanes, shelf_z2); m_state[0][1] = lanes[0]; m_state[1][1] = lanes[1];
+            _mm_storeu_pd(lanes, high_z1); m_state[0][2] = lanes[0]; m_state[1][2] = lanes[1];
+            _mm_storeu_pd(lanes, high_z2); m_state[0][3] = lanes[0]; m_state[1][3] = lanes[1];
+        }
+#endif
+        for (; f < take; ++f) {
+            for (int ch = 0; ch < 2; ++ch) {
+                double in = stereo[f * 2 + ch];
+                double weighted = biquad(m_high_pass, m_state[ch] + 2, biquad(m_shelf, m_state[ch], in));
+                energy += weighted * weighted;
+                squares += in * in;
+                peak = (std::max)(peak, static_cast<float>(std::abs(in)));
+            }
+        }
+        // The filters ring down towards denormals in silence
+        for (double& z : m_state[0]) if (std::abs(z) < 1e-30) z = 0.0;
+        for (double& z : m_state[1]) if (std::abs(z) < 1e-30) z = 0.0;
+
+        m_hop_energy += energy;
+        m_hop_squares += squares;
+        m_hop_peak = peak;
+        m_hop_filled += take;
+        stereo += take * 2;
+        frames -= take;
+        if (m_hop_filled == m_hop_frames) {
+            end_hop();
+            updated = true;
+        }
+    }
+    return updated;
+}
+
+void LevelMeter::end_hop() {
+    m_hop_index = (m_hop_index + 1) % SHORT_TERM_HOPS;
+    m_hop_energies[m_hop_index] = m_hop_energy / m_hop_frames; // Channels add up (BS.1770 weights L and R by 1)
+    m_hops++;
+    m_total_squares += m_hop_squares;
+    m_total_frames += m_hop_frames;
+
+    auto mean_energy = [this](int hops) {
+        hops = (std::min)(hops, m_hops);
+        double sum = 0;
+        for (int i = 0; i < hops; ++i) sum += m_hop_energies[(m_hop_index - i + SHORT_TERM_HOPS) % SHORT_TERM_HOPS];
+        return sum / hops;
+    };
+    Levels& l = m_levels;
+    l.peak = m_hop_peak;
+    l.rms = static_cast<float>(std::sqrt(m_hop_squares / (2.0 * m_hop_frames)));
+    l.momentary_lufs = energy_to_lufs(mean_energy(MOMENTARY_HOPS));
+    l.short_term_lufs = energy_to_lufs(mean_energy(SHORT_TERM_HOPS));
+    l.max_peak = (std::max)(l.max_peak, l.peak);
+    l.overall_rms = static_cast<float>(std::sqrt(m_total_squares / (2.0 * m_total_frames)));
+    l.max_momentary_lufs = (std::max)(l.max_momentary_lufs, l.momentary_lufs);
+    l.max_short_term_lufs = (std::max)(l.max_short_term_lufs, l.short_term_lufs);
+
+    // Whole 400 ms blocks, overlapping by 75%, go into the gated measurement
+    if (m_hops >= MOMENTARY_HOPS && l.momentary_lufs > HISTOGRAM_MIN_LUFS) {
+        int bin = static_cast<int>((l.momentary_lufs - HISTOGRAM_MIN_LUFS) / HISTOGRAM_STEP_LU);
+        m_histogram[(std::min)(bin, HISTOGRAM_BINS - 1)]++;
+        l.integrated_lufs = integrated_lufs();
+    }
+
+    m_hop_filled = 0;
+    m_hop_energy = m_hop_squares = 0;
+    m_hop_peak = 0.0f;
+}
+
+float LevelMeter::integrated_lufs() const {
+    // Energy at the centre of each histogram bin
+    static const auto bin_energy = [] {
+        static double energy[HISTOGRAM_BINS];
+        for (int i = 0; i < HISTOGRAM_BINS; ++i) {
+            energy[i] = std::pow(10.0, (HISTOGRAM_MIN_LUFS + (i + 0.5) * HISTOGRAM_STEP_LU + 0.691) / 10.0);
+        }
+        return energy;
+    }();
+    auto gated_mean = [&](int first_bin) {
+        double sum = 0;
+        uint64_t count = 0;
+        for (int i = first_bin; i < HISTOGRAM_BINS; ++i) {
+            sum += m_histogram[i] * bin_energy[i];
+            count += m_histogram[i];
+        }
+        return count ? sum / count : 0.0;
+    };
+    // Absolute gate at -70 LUFS (the histogram starts there), then a relative gate 10 LU below that level
+    double absolute = gated_mean(0);
+    if (absolute <= 0.0) return Levels::SILENCE_LUFS;
+    double relative_gate = energy_to_lufs(absolute) - 10.0;
+    int first_bin = (std::max)(0, static_cast<int>(std::ceil((relative_gate - HISTOGRAM_MIN_LUFS) / HISTOGRAM_STEP_LU - 0.5)));
+    return energy_to_lufs(gated_mean(first_bin));
+}
@@ -0,0 +1,83 @@
+#ifndef LEVEL_METER_H
+#define LEVEL_METER_H
+
+#include <cstdint>
+
+// Levels of one stereo signal. Amplitudes are linear (1.0 = full scale); loudness is K-weighted
+// per ITU-R BS.1770 in LUFS, where quieter than SILENCE_LUFS reads as SILENCE_LUFS.
+struct Levels {
+    static constexpr float SILENCE_LUFS = -70.0f;
+
+    // Over the last control period (LevelMeter::HOP_SECONDS)
+    float peak = 0.0f;
+    float rms = 0.0f; // Both channels together
+    float momentary_lufs = SILENCE_LUFS;  // Over the last 400 ms
+    float short_term_lufs = SILENCE_LUFS; // Over the last 3 s
+    // Since the meter was reset
+    float max_peak = 0.0f;
+    float overall_rms = 0.0f;
+    float max_momentary_lufs = SILENCE_LUFS;
+    float max_short_term_lufs = SILENCE_LUFS;
+    float integrated_lufs = SILENCE_LUFS; // Gated like BS.1770 programme loudness
+
+    // The levels of the signal times 'gain'
+    Levels scaled(float gain) const;
+};
+
+// Meters a stereo signal block by block. The K-weighting filter runs per sample (both channels in
+// one SIMD register); everything else is summed per block and evaluated once per control period,
+// so metering costs a few operations per sample and can stay on during playback. Never allocates
+// after reset().
+class LevelMeter {
+public:
+    static constexpr double HOP_SECONDS = 0.1; // Control period: levels update this often
+    static constexpr int MOMENTARY_HOPS = 4;
+    static constexpr int SHORT_TERM_HOPS = 30;
+
+    void reset(float sample_rate);
+    // Interleaved stereo. Returns true when a control period completed and get_levels() changed.
+    bool process(const float* stereo, int frames);
+    const Levels& get_levels() const { return m_levels; }
+
+private:
+    // Loudness histogram of the 400 ms blocks, for the gated integrated loudness
+    static constexpr float HISTOGRAM_MIN_LUFS = Levels::SILENCE_LUFS;
+    static constexpr float HISTOGRAM_STEP_LU = 0.1f;
+    static constexpr int HISTOGRAM_BINS = 800; // Up to +10 LUFS
+
+    // K-weighting: high shelf then high pass, as one biquad pair per channel
+    double m_shelf[5] = {}, m_high_pass[5] = {}; // a0, a1, a2, b1, b2 named as in BiquadState
+    double m_state[2][4] = {};                   // Per channel: shelf z1, z2, high pass z1, z2
+
+    int m_hop_frames = 4410;
+    int m_hop_filled = 0;
+    double m_hop_energy = 0; // K-weighted sum of squares, both channels
+    double m_hop_squares = 0; // Unweighted
+    float m_hop_peak = 0.0f;
+    double m_hop_energies[SHORT_TERM_HOPS] = {}; // Mean K-weighted energy of the last hops, newest at m_hop_index
+    int m_hop_index = 0;
+    int m_hops = 0;
+    double m_total_squares = 0;
+    uint64_t m_total_frames = 0;
+    uint32_t m_histogram[HISTOGRAM_BINS] = {};
+    Levels m_levels;
+
+    void end_hop();
+    float integrated_lufs() const;
+};
+
+// Levels of the output and each instrument, as published by AudioRenderer
+struct LevelReport {
+    static constexpr int MAX_TRACKS = 31;
+    struct Track {
+        char name[32];
+        Levels levels;
+    };
+
+    Levels master;
+    Track tracks[MAX_TRACKS] = {};
+    int track_count = 0;
+    uint64_t updates = 0; // Counts publications, so readers can tell new levels from old
+};
+
+#endif // LEVEL_METER_H
@@ -4,8 +4,10 @@
 #include "AudioRenderer.h"
 
 void Mp3Writer::write(AudioRenderer& renderer, const Song& song, const std::string& file_path, float sample_rate, int bitrate) {
-    std::vector<float> pcm_buffer = renderer.render(song, sample_rate);
+    write(renderer.render(song, sample_rate), file_path, sample_rate, bitrate);
+}
 
+void Mp3Writer::write(const std::vector<float>& pcm_buffer, const std::string& file_path, float sample_rate, int bitrate) {
     // Initialize the LAME encoder
     lame_global_flags* gfp = lame_init();
     lame_set_in_samplerate(gfp, sample_rate);
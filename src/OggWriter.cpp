@@ -8,8 +8,10 @@
 #include <algorithm>
 
 void OggWriter::write(AudioRenderer& renderer, const Song& song, const std::string& file_path, float sample_rate, float quality) {
-    std::vector<float> pcm_buffer = renderer.render(song, sample_rate);
+    write(renderer.render(song, sample_rate), file_path, sample_rate, quality);
+}
 
+void OggWriter::write(const std::vector<float>& pcm_buffer, const std::string& file_path, float sample_rate, float quality) {
     ogg_stream_state os;
     ogg_page         og;
     ogg_packet       op;
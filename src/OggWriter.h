@@ -3,12 +3,15 @@
 
 #include "Song.h"
 #include <string>
+#include <vector>
 
 class AudioRenderer;
 
 class OggWriter {
 public:
     void write(AudioRenderer& renderer, const Song& song, const std::string& file_path, float sample_rate = 44100.0f, float quality = 0.4f);
+    // Already rendered interleaved stereo
+    void write(const std::vector<float>& pcm_buffer, const std::string& file_path, float sample_rate, float quality = 0.4f);
 };
 
 #endif // OGG_WRITER_H
@@ -0,0 +1,147 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#define _USE_MATH_DEFINES
+#include "Oversampler.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace {
+    // Zeroth-order modified Bessel function, for the Kaiser window
+    double bessel_i0(double x) {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // The nonzero (odd) taps h[2j - N], j = 0..N, of a Kaiser-windowed halfband filter,
+    // scaled so they sum to 1/2 and the filter passes DC unchanged
+    std::vector<float> halfband_taps(int half_length, float scale) {
+        const double beta = 7.0; // About 70dB stopband
+        std::vector<double> taps(half_length + 1);
+        double sum = 0;
+        for (int j = 0; j <= half_length; ++j) {
+            int k = 2 * j - half_length;
+            double r = static_cast<double>(k) / (half_length + 1);
+            double window = bessel_i0(beta * std::sqrt((std::max)(0.0, 1.0 - r * r))) / bessel_i0(beta);
+            taps[j] = std::sin(M_PI * k / 2.0) / (M_PI * k) * window;
+            sum += taps[j];
+        }
+        std::vector<float> out(taps.size());
+        for (size_t j = 0; j < taps.size(); ++j) out[j] = static_cast<float>(taps[j] * 0.5 / sum * scale);
+        return out;
+    }
+
+    // out[i] = dot(taps, line + i) for every i < count, four outputs at a time
+    void fir(const float* line, const std::vector<float>& taps, int count, float* out) {
+        const int length = static_cast<int>(taps.size());
+        int i = 0;
+#if MUSEQ_SIMD_X86
+        for (; i + 4 <= count; i += 4) {
+            __m128 sum = _mm_setzero_ps();
+            for (int k = 0; k < length; ++k) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(taps[k]), _mm_loadu_ps(line + i + k)));
+            }
+            _mm_storeu_ps(out + i, sum);
+        }
+#endif
+        for (; i < count; ++i) {
+            float sum = 0.0f;
+            for (int k = 0; k < length; ++k) sum += taps[k] * line[i + k];
+            out[i] = sum;
+        }
+    }
+
+    // Keeps the newest 'history' samples at the front of the line for the next block
+    void keep_history(std::vector<float>& line, size_t history) {
+        std::copy(line.end() - history, line.end(), line.begin());
+        line.resize(history);
+    }
+}
+
+HalfbandUpsampler::HalfbandUpsampler(int half_length)
+    : m_taps(halfband_taps(half_length, 2.0f)), m_line(m_taps.size() - 1, 0.0f) {}
+
+void HalfbandUpsampler::process(const float* in, int count, float* out) {
+    const size_t history = m_taps.size() - 1;
+    m_line.insert(m_line.end(), in, in + count);
+    // Even outputs are the FIR, odd outputs the centre tap: the input from (half_length - 1) / 2 samples ago
+    float* fir_out = out + count; // The second half of 'out' is free until the interleave below
+    fir(m_line.data(), m_taps, count, fir_out);
+    for (int i = 0; i < count; ++i) {
+        out[i * 2] = fir_out[i];
+        out[i * 2 + 1] = m_line[i + m_taps.size() / 2];
+    }
+    keep_history(m_line, history);
+}
+
+void HalfbandUpsampler::reset() {
+    m_line.assign(m_taps.size() - 1, 0.0f);
+}
+
+HalfbandDownsampler::HalfbandDownsampler(int half_length)
+    : m_taps(halfband_taps(half_length, 1.0f)), m_odd(m_taps.size() - 1, 0.0f), m_even((half_length - 1) / 2, 0.0f) {}
+
+void HalfbandDownsampler::process(const float* in, int count, float* out) {
+    const size_t odd_history = m_odd.size();
+    const size_t even_history = m_even.size();
+    for (int i = 0; i < count; ++i) {
+        m_even.push_back(in[i * 2]);
+        m_odd.push_back(in[i * 2 + 1]);
+    }
+    fir(m_odd.data(), m_taps, count, out);
+    // Centre tap: the even input from (half_length - 1) / 2 pairs ago
+    for (int i = 0; i < count; ++i) out[i] += 0.5f * m_even[i];
+    keep_history(m_odd, odd_history);
+    keep_history(m_even, even_history);
+}
+
+void HalfbandDownsampler::reset() {
+    std::fill(m_odd.begin(), m_odd.end(), 0.0f);
+    std::fill(m_even.begin(), m_even.end(), 0.0f);
+}
+
+Oversampler::Oversampler(int factor) : m_factor(factor) {
+    for (int rate = 1; rate < factor; rate *= 2) {
+        int half_length = (rate == 1) ? OUTER_HALF_LENGTH : INNER_HALF_LENGTH;
+        m_up.emplace_back(half_length);
+        m_down.emplace_back(half_length);
+    }
+}
+
+double Oversampler::get_latency() const {
+    double latency = 0;
+    int rate = 1;
+    for (size_t s = 0; s < m_up.size(); ++s, rate *= 2) {
+        int half_length = (s == 0) ? OUTER_HALF_LENGTH : INNER_HALF_LENGTH;
+        latency += (half_length - 0.5) / rate;
+    }
+    return latency;
+}
+
+// Each stage copies its input into its own history before writing, so stages can run in place
+void Oversampler::upsample(const float* in, int stride, int count, float* out) {
+    for (int i = 0; i < count; ++i) out[i] = in[i * stride];
+    for (size_t s = 0, n = count; s < m_up.size(); ++s, n *= 2) m_up[s].process(out, static_cast<int>(n), out);
+}
+
+void Oversampler::downsample(const float* in, int count, float* out, int stride) {
+    m_scratch.assign(in, in + static_cast<size_t>(count) * m_factor);
+    for (size_t s = m_down.size(), n = m_scratch.size() / 2; s-- > 0; n /= 2) {
+        m_down[s].process(m_scratch.data(), static_cast<int>(n), m_scratch.data());
+    }
+    for (int i = 0; i < count; ++i) out[i * stride] = m_scratch[i];
+}
+
+void Oversampler::reset() {
+    for (auto& up : m_up) up.reset();
+    for (auto& down : m_down) down.reset();
+}
@@ -0,0 +1,66 @@
+#ifndef OVERSAMPLER_H
+#define OVERSAMPLER_H
+
+#include <vector>
+
+// Doubles the rate of a stream with a halfband low-pass. Every other tap of a halfband filter is
+// zero and the centre tap is 1/2, so one output of each pair is a plain delayed copy of the input
+// and the other is a short symmetric FIR.
+class HalfbandUpsampler {
+public:
+    // 'half_length' is odd; the filter has 2 * half_length + 1 taps
+    explicit HalfbandUpsampler(int half_length);
+
+    // 2 * count outputs for 'count' inputs
+    void process(const float* in, int count, float* out);
+    void reset();
+
+private:
+    std::vector<float> m_taps; // The nonzero taps, times 2 for the zeros stuffed between inputs
+    std::vector<float> m_line; // The last taps - 1 inputs, followed by the block being processed
+};
+
+// Halves the rate of a stream with the same halfband filter
+class HalfbandDownsampler {
+public:
+    explicit HalfbandDownsampler(int half_length);
+
+    // 'count' outputs for 2 * count inputs
+    void process(const float* in, int count, float* out);
+    void reset();
+
+private:
+    std::vector<float> m_taps;
+    std::vector<float> m_odd;  // FIR input: history, then the odd inputs of the block
+    std::vector<float> m_even; // Centre tap input: history, then the even inputs of the block
+};
+
+// Runs a mono stream at 2, 4 or 8 times its rate through cascaded halfband stages. The stage next to
+// the base rate has the steep filter; the inner stages only have to keep their images away from the
+// base band, so they are much shorter.
+class Oversampler {
+public:
+    explicit Oversampler(int factor);
+
+    int get_factor() const { return m_factor; }
+    // Delay of an upsample + downsample round trip, in base rate samples
+    double get_latency() const;
+
+    // 'count' strided samples in, count * factor contiguous samples out
+    void upsample(const float* in, int stride, int count, float* out);
+    // count * factor contiguous samples in, 'count' strided samples out
+    void downsample(const float* in, int count, float* out, int stride);
+    void reset();
+
+    // Half lengths are 4k - 1, so each stage has a multiple of 4 nonzero taps
+    static constexpr int OUTER_HALF_LENGTH = 31;
+    static constexpr int INNER_HALF_LENGTH = 7;
+
+private:
+    int m_factor;
+    std::vector<HalfbandUpsampler> m_up;     // Base rate first
+    std::vector<HalfbandDownsampler> m_down; // Base rate first
+    std::vector<float> m_scratch;
+};
+
+#endif // OVERSAMPLER_H
@@ -0,0 +1,71 @@
+#include "Patch.h"
+#include <type_traits>
+
+namespace {
+    template <typename T>
+    void put(std::string& key, const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "key fields must be plain values");
+        key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void put_string(std::string& key, const std::string& value) {
+        put(key, value.size());
+        key.append(value);
+    }
+}
+
+void append_patch_description(std::string& key, const Instrument& inst, const std::vector<Effect>& parent_effects) {
+    put(key, inst.type);
+
+    const Synth& synth = inst.synth;
+    put(key, synth.waveform);
+    put(key, synth.frequency);
+    put(key, synth.envelope.attack);
+    put(key, synth.envelope.decay);
+    put(key, synth.envelope.sustain);
+    put(key, synth.envelope.release);
+    put(key, synth.filter.type);
+    put(key, synth.filter.cutoff);
+    put(key, synth.filter.resonance);
+    put(key, synth.lfo.target);
+    put(key, synth.lfo.waveform);
+    put(key, synth.lfo.frequency);
+    put(key, synth.lfo.amount);
+
+    // Samplers without a path can't be told apart by content
+    put(key, inst.sampler && inst.sampler->get_path().empty() ? static_cast<const void*>(inst.sampler) : nullptr);
+    put_string(key, inst.sampler ? inst.sampler->get_path() : std::string());
+    put_string(key, inst.soundfont_path);
+    put(key, inst.bank_index);
+    put(key, inst.preset_index);
+    put(key, inst.portamento_time);
+    put(key, inst.pan);
+    put(key, inst.gain);
+
+    put(key, inst.effects.size() + parent_effects.size());
+    for (const auto* chain : { &inst.effects, &parent_effects }) {
+        for (const auto& fx : *chain) {
+            put(key, fx.type);
+            put(key, fx.param1);
+            put(key, fx.param2);
+            put(key, fx.param3);
+            put_string(key, fx.path);
+        }
+    }
+}
+
+std::shared_ptr<const Patch> PatchTable::get(const Instrument& inst, const std::vector<Effect>& parent_effects) {
+    m_key_scratch.clear();
+    append_patch_description(m_key_scratch, inst, parent_effects);
+
+    auto it = m_patches.find(m_key_scratch);
+    if (it != m_patches.end()) return it->second;
+
+    auto patch = std::make_shared<Patch>();
+    patch->instrument = inst;
+    patch->instrument.sequence.notes.clear();
+    patch->instrument.sequence.notes.shrink_to_fit();
+    patch->instrument.effects.insert(patch->instrument.effects.end(), parent_effects.begin(), parent_effects.end());
+    m_patches.emplace(m_key_scratch, patch);
+    return patch;
+}
@@ -0,0 +1,33 @@
+#ifndef PATCH_H
+#define PATCH_H
+
+#include "Instrument.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+// Immutable sound-shaping data of an instrument (everything except its notes), shared by
+// every voice that plays it. Voices reference their notes from the song tree instead of copying them.
+struct Patch {
+    Instrument instrument; // Notes stripped; effects are the instrument's own followed by the enclosing blocks'
+};
+
+// Appends a byte-exact description of everything in 'inst' (apart from its notes) and
+// 'parent_effects' that affects how it sounds.
+void append_patch_description(std::string& key, const Instrument& inst, const std::vector<Effect>& parent_effects);
+
+// Deduplicates patches by content, so repeated sections and function calls share one copy
+// of each instrument (including any loaded sample data).
+class PatchTable {
+public:
+    std::shared_ptr<const Patch> get(const Instrument& inst, const std::vector<Effect>& parent_effects);
+    void clear() { m_patches.clear(); }
+    size_t size() const { return m_patches.size(); }
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<const Patch>> m_patches;
+    std::string m_key_scratch;
+};
+
+#endif // PATCH_H
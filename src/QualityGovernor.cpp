@@ -0,0 +1,43 @@
+#include "QualityGovernor.h"
+
+void QualityGovernor::reset() {
+    m_level = QualityLevel::FULL;
+    m_smoothed_load = 0;
+    m_since_change = 0;
+    m_calm_seconds = 0;
+}
+
+QualityLevel QualityGovernor::update(double load, double block_seconds, double buffer_fill) {
+    // About a tenth of a second of smoothing at 512-frame blocks
+    m_smoothed_load += (load - m_smoothed_load) * 0.1;
+    m_since_change += block_seconds;
+    int level = static_cast<int>(m_level);
+
+    bool overloaded = load > 1.0 || m_smoothed_load > STEP_DOWN_LOAD;
+    // A well filled buffer still covers the device, however long this block took
+    if (buffer_fill >= LOW_BUFFER_FILL) overloaded = false;
+    if (overloaded && m_since_change >= SETTLE_SECONDS && level + 1 < LEVEL_COUNT) {
+        m_level = static_cast<QualityLevel>(level + 1);
+        m_since_change = 0;
+        m_calm_seconds = 0;
+        return m_level;
+    }
+
+    m_calm_seconds = (m_smoothed_load < STEP_UP_LOAD && load < STEP_DOWN_LOAD) ? m_calm_seconds + block_seconds : 0;
+    if (m_calm_seconds >= RECOVER_SECONDS && level > 0) {
+        m_level = static_cast<QualityLevel>(level - 1);
+        m_since_change = 0;
+        m_calm_seconds = 0;
+    }
+    return m_level;
+}
+
+const char* QualityGovernor::get_level_name(QualityLevel level) {
+    switch (level) {
+        case QualityLevel::FAST_MATH: return "fast math";
+        case QualityLevel::CONTROL_RATE_FILTERS: return "control-rate filters";
+        case QualityLevel::SHORT_TAILS: return "short tails";
+        case QualityLevel::DROP_QUIET: return "quiet voices dropped";
+        default: return "full";
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+// Realtime synthesis quality, cheapest last. Each level keeps the savings of the ones before it.
+enum class QualityLevel {
+    FULL,
+    FAST_MATH,            // Oscillators, LFOs, pitch and pan use the fast DSP math tier
+    CONTROL_RATE_FILTERS, // Modulated filters update their coefficients every FILTER_CONTROL_INTERVAL samples
+    SHORT_TAILS,          // Voices whose notes are over fade out instead of ringing through their effect tails
+    DROP_QUIET            // Voices below QUIET_VOICE_PEAK fade out
+};
+
+// Picks the quality level from the measured load of each block (render time / audio time). A slow
+// block or a high average steps down one level right away; the level only steps back up after the
+// load has stayed low for a while, so it doesn't oscillate around the threshold. Blocks rendered
+// ahead into a buffer can be slow while the buffer lasts: then the level only steps down once the
+// buffer has drained below LOW_BUFFER_FILL.
+class QualityGovernor {
+public:
+    static constexpr int LEVEL_COUNT = 5;
+    static constexpr int FILTER_CONTROL_INTERVAL = 32;
+    static constexpr float QUIET_VOICE_PEAK = 0.01f; // -40 dBFS
+    static constexpr double TAIL_FADE_SECONDS = 0.05;
+    static constexpr double LOW_BUFFER_FILL = 0.5;
+
+    void reset();
+    // Returns the level for the next block. 'buffer_fill' is how full the render-ahead buffer was
+    // when the block was rendered (0..1), or negative if the block goes straight to the device.
+    QualityLevel update(double load, double block_seconds, double buffer_fill = -1.0);
+    QualityLevel get_level() const { return m_level; }
+    static const char* get_level_name(QualityLevel level);
+
+private:
+    static constexpr double STEP_DOWN_LOAD = 0.7;
+    static constexpr double STEP_UP_LOAD = 0.35;
+    static constexpr double SETTLE_SECONDS = 0.1;  // After a step down, before judging its effect
+    static constexpr double RECOVER_SECONDS = 2.0; // Of low load before stepping up
+
+    QualityLevel m_level = QualityLevel::FULL;
+    double m_smoothed_load = 0;
+    double m_since_change = 0;
+    double m_calm_seconds = 0;
+};
+
+#endif // QUALITY_GOVERNOR_H
@@ -0,0 +1,268 @@
+#include "RenderCache.h"
+#include "Patch.h"
+#include "FastMath.h"
+#include <type_traits>
+#include <filesystem>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+    template <typename T>
+    void put(std::string& key, const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "key fields must be plain values");
+        key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    const char DISK_MAGIC[4] = { 'M', 'Q', 'R', 'C' };
+
+    uint64_t fnv1a(const std::string& data) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+}
+
+RenderCache::~RenderCache() {
+    if (!m_writer.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_write_mutex);
+        m_stop_writer = true;
+    }
+    m_write_cv.notify_all();
+    m_writer.join(); // Writes everything still queued first
+}
+
+// Size and modification time of an asset file, so edited samples/soundfonts invalidate disk entries
+void RenderCache::put_asset_stamp(std::string& key, const std::string& path) const {
+    auto it = m_asset_stamps.find(path);
+    if (it == m_asset_stamps.end()) {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        if (!path.empty()) {
+            std::error_code ec;
+            auto fsize = std::filesystem::file_size(path, ec);
+            if (!ec) size = fsize;
+            auto ftime = std::filesystem::last_write_time(path, ec);
+            if (!ec) mtime = static_cast<int64_t>(ftime.time_since_epoch().count());
+        }
+        it = m_asset_stamps.emplace(path, std::make_pair(size, mtime)).first;
+    }
+    put(key, it->second.first);
+    put(key, it->second.second);
+}
+
+std::string RenderCache::make_key(const Instrument& inst, const std::vector<Effect>& parent_effects,
+                                  double loop_period_samples, int loop_count, float sample_rate) const {
+    std::string key;
+    if (inst.type == InstrumentType::SAMPLER && (!inst.sampler || inst.sampler->get_path().empty())) return key;
+
+    key.reserve(128 + inst.sequence.notes.size() * 24);
+    put(key, FORMAT_VERSION);
+    put(key, sample_rate);
+    put(key, loop_period_samples);
+    put(key, loop_count);
+    put(key, FastMath::get_precision()); // The approximations change the samples
+    if (has_disk()) {
+        put_asset_stamp(key, inst.sampler ? inst.sampler->get_path() : std::string());
+        put_asset_stamp(key, inst.soundfont_path);
+        for (const auto* chain : { &inst.effects, &parent_effects }) {
+            for (const auto& fx : *chain) {
+                if (!fx.path.empty()) put_asset_stamp(key, fx.path);
+            }
+        }
+    }
+    append_patch_description(key, inst, parent_effects);
+
+    put(key, inst.sequence.notes.size());
+    for (const auto& note : inst.sequence.notes) {
+        put(key, note.pitch);
+        put(key, note.duration);
+        put(key, note.velocity);
+        put(key, note.pan);
+        put(key, note.is_rest);
+        put(key, note.advance_time);
+    }
+    return key;
+}
+
+void RenderCache::clear() {
+    m_entries.clear();
+    m_seen.clear();
+    m_reserved_bytes = 0;
+    m_hits = 0;
+    m_asset_stamps.clear();
+}
+
+void RenderCache::preload(const std::vector<std::string>& keys) {
+    if (!has_disk()) return;
+    start_writer();
+    for (const auto& key : keys) {
+        if (key.empty() || m_entries.count(key)) continue;
+        auto entry = std::make_shared<CachedRender>();
+        if (!load_from_disk(key, *entry)) continue;
+        size_t bytes = entry->pcm.size() * sizeof(float);
+        if (m_reserved_bytes + bytes > m_budget_bytes) break;
+        entry->complete = true;
+        entry->persisted = true;
+        entry->reserved_bytes = bytes;
+        m_reserved_bytes += bytes;
+        m_entries[key] = entry;
+    }
+}
+
+std::shared_ptr<const CachedRender> RenderCache::find(const std::string& key) {
+    auto it = m_entries.find(key);
+    if (it != m_entries.end() && it->second->degraded) {
+        // The voices already replaying it keep their reference; everyone else renders afresh
+        m_reserved_bytes -= it->second->reserved_bytes;
+        m_entries.erase(it);
+        it = m_entries.end();
+    }
+    if (it == m_entries.end()) return nullptr;
+    m_hits++;
+    return it->second;
+}
+
+std::shared_ptr<CachedRender> RenderCache::begin_record(const std::string& key, double expected_frames) {
+    // Without a disk cache, only content that has already occurred once is worth keeping
+    bool seen_before = m_seen[key]++ > 0;
+    if (!seen_before && !has_disk()) return nullptr;
+    if (m_entries.count(key)) return nullptr;
+
+    size_t bytes = static_cast<size_t>(expected_frames + 1) * 2 * sizeof(float);
+    if (m_reserved_bytes + bytes > m_budget_bytes) return nullptr;
+    m_reserved_bytes += bytes;
+
+    auto entry = std::make_shared<CachedRender>();
+    entry->pcm.reserve(static_cast<size_t>(expected_frames + 1) * 2);
+    entry->reserved_bytes = bytes;
+    m_entries[key] = entry;
+    return entry;
+}
+
+void RenderCache::drop_incomplete() {
+    for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+        if (!it->second->complete) {
+            m_reserved_bytes -= it->second->reserved_bytes;
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RenderCache::flush() {
+    if (!has_disk()) return;
+    for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+        auto& entry = it->second;
+        if (entry->degraded) {
+            if (entry.use_count() == 1) {
+                m_reserved_bytes -= entry->reserved_bytes;
+                it = m_entries.erase(it);
+            } else {
+                ++it;
+            }
+            continue;
+        }
+        if (entry->complete && !entry->persisted) {
+            start_writer();
+            {
+                std::lock_guard<std::mutex> lock(m_write_mutex);
+                m_write_queue.push_back({ disk_path(it->first), it->first, entry });
+            }
+            m_write_cv.notify_all();
+            entry->persisted = true;
+        }
+        ++it;
+    }
+}
+
+void RenderCache::wait_for_writes() {
+    std::unique_lock<std::mutex> lock(m_write_mutex);
+    m_write_cv.wait(lock, [this] { return m_write_queue.empty() && !m_writing; });
+}
+
+void RenderCache::start_writer() {
+    if (!m_writer.joinable()) m_writer = std::thread(&RenderCache::writer_loop, this);
+}
+
+void RenderCache::writer_loop() {
+    std::unique_lock<std::mutex> lock(m_write_mutex);
+    while (true) {
+        m_write_cv.wait(lock, [this] { return m_stop_writer || !m_write_queue.empty(); });
+        if (m_write_queue.empty()) return;
+        WriteJob job = std::move(m_write_queue.front());
+        m_write_queue.pop_front();
+        m_writing = true;
+        lock.unlock();
+        save_to_disk(job.path, job.key, *job.entry);
+        lock.lock();
+        m_writing = false;
+        m_write_cv.notify_all();
+    }
+}
+
+size_t RenderCache::get_size_bytes() const {
+    size_t total = 0;
+    for (const auto& [key, entry] : m_entries) total += entry->pcm.size() * sizeof(float);
+    return total;
+}
+
+std::string RenderCache::disk_path(const std::string& key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.pcm", static_cast<unsigned long long>(fnv1a(key)));
+    return (std::filesystem::path(m_disk_dir) / name).string();
+}
+
+bool RenderCache::load_from_disk(const std::string& key, CachedRender& out) const {
+    std::ifstream in(disk_path(key), std::ios::binary);
+    if (!in) return false;
+
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t key_size = 0, sample_count = 0;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&key_size), sizeof(key_size));
+    if (!in || std::string(magic, 4) != std::string(DISK_MAGIC, 4) || version != FORMAT_VERSION) return false;
+    if (key_size != key.size()) return false;
+
+    // The full key is stored, so a hash collision can never replay the wrong audio
+    std::string stored_key(key_size, '\0');
+    in.read(&stored_key[0], key_size);
+    if (!in || stored_key != key) return false;
+
+    in.read(reinterpret_cast<char*>(&sample_count), sizeof(sample_count));
+    if (!in) return false;
+    out.pcm.resize(sample_count);
+    in.read(reinterpret_cast<char*>(out.pcm.data()), sample_count * sizeof(float));
+    return static_cast<bool>(in);
+}
+
+void RenderCache::save_to_disk(const std::string& path, const std::string& key, const CachedRender& entry) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Warning: Could not write render cache file " << tmp_path << std::endl;
+            return;
+        }
+        uint32_t version = FORMAT_VERSION;
+        uint64_t key_size = key.size(), sample_count = entry.pcm.size();
+        out.write(DISK_MAGIC, 4);
+        out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        out.write(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+        out.write(key.data(), key.size());
+        out.write(reinterpret_cast<const char*>(&sample_count), sizeof(sample_count));
+        out.write(reinterpret_cast<const char*>(entry.pcm.data()), entry.pcm.size() * sizeof(float));
+    }
+    std::filesystem::rename(tmp_path, path, ec);
+}
@@ -0,0 +1,117 @@
+#ifndef RENDER_CACHE_H
+#define RENDER_CACHE_H
+
+#include "Instrument.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+// Rendered stereo PCM of one voice, shared by every later occurrence of identical content.
+struct CachedRender {
+    std::vector<float> pcm; // Interleaved stereo, starting at the voice's first block
+    bool complete = false;
+    bool persisted = false; // Handed to the disk writer (or read from the disk cache)
+    size_t reserved_bytes = 0;
+    // Recorded while playback traded quality for speed (see QualityGovernor): the voices already
+    // replaying it finish with it, but it is never handed out again or written to disk
+    bool degraded = false;
+    // The recording voice was stolen, faded out or dropped before the end; replaying voices
+    // synthesize the rest themselves (see AudioRenderer::resynthesize())
+    bool abandoned = false;
+    double recorder_start = 0; // Song sample where the recording voice started
+};
+
+// Content-keyed cache of voice renders.
+// A voice's output only depends on its instrument, notes, effects, loop settings and the
+// sample rate (all timing is relative to the voice's own start), so voices with identical
+// content render to identical PCM wherever they are placed in the song.
+//
+// With a disk directory set, every finished voice is also written to disk, so later runs
+// only synthesize voices whose content changed. Disk entries are read in preload() at load
+// time and written by a background thread, so rendering never waits for the disk.
+class RenderCache {
+public:
+    RenderCache() = default;
+    ~RenderCache();
+    RenderCache(const RenderCache&) = delete;
+    RenderCache& operator=(const RenderCache&) = delete;
+
+    // Bump whenever synthesis output changes, so stale disk entries are never replayed
+    static constexpr unsigned int FORMAT_VERSION = 6;
+
+    // Byte-exact description of everything that affects a voice's output. 'parent_effects' are
+    // the enclosing blocks' effects, applied after the instrument's own. Empty if the instrument
+    // can't be identified by content (e.g. a sampler without a source path).
+    std::string make_key(const Instrument& inst, const std::vector<Effect>& parent_effects,
+                         double loop_period_samples, int loop_count, float sample_rate) const;
+
+    // Drops in-memory entries and asset stamps; the disk directory is kept.
+    void clear();
+    void set_budget_bytes(size_t bytes) { m_budget_bytes = bytes; }
+    void set_disk_dir(const std::string& dir) { m_disk_dir = dir; }
+    const std::string& get_disk_dir() const { return m_disk_dir; }
+    bool has_disk() const { return !m_disk_dir.empty(); }
+
+    // Reads the disk entries for 'keys' (a song's voices in order) into memory, up to the budget
+    void preload(const std::vector<std::string>& keys);
+
+    // Returns the render for 'key', or nullptr. Only looks in memory, see preload(). An entry may
+    // still be recording: only voices starting after 'recorder_start' may replay it, since the
+    // recording voice renders first in each block and replay never overtakes it.
+    std::shared_ptr<const CachedRender> find(const std::string& key);
+
+    // Called for each new voice. Returns an entry the voice should record into when the
+    // content is worth keeping: it has been seen before, or a disk cache is in use.
+    std::shared_ptr<CachedRender> begin_record(const std::string& key, double expected_frames);
+
+    // Forget recordings that were cut off (e.g. by a seek) and will never complete
+    void drop_incomplete();
+
+    // Hand finished recordings to the disk writer and release degraded ones no voice is using
+    void flush();
+    // Blocks until everything handed to the disk writer has been written
+    void wait_for_writes();
+
+    size_t get_hit_count() const { return m_hits; }
+    size_t get_size_bytes() const;
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<CachedRender>> m_entries;
+    std::unordered_map<std::string, int> m_seen;
+    std::string m_disk_dir;
+    size_t m_budget_bytes = 256 * 1024 * 1024;
+    size_t m_reserved_bytes = 0;
+    size_t m_hits = 0;
+    // Size and modification time per asset path, so keys don't stat files while rendering
+    mutable std::unordered_map<std::string, std::pair<uint64_t, int64_t>> m_asset_stamps;
+
+    // Disk writer
+    std::thread m_writer;
+    std::mutex m_write_mutex;
+    std::condition_variable m_write_cv;
+    struct WriteJob {
+        std::string path;
+        std::string key;
+        std::shared_ptr<const CachedRender> entry;
+    };
+    std::deque<WriteJob> m_write_queue;
+    bool m_writing = false;
+    bool m_stop_writer = false;
+
+    void start_writer();
+    void writer_loop();
+    void put_asset_stamp(std::string& key, const std::string& path) const;
+    std::string disk_path(const std::string& key) const;
+    bool load_from_disk(const std::string& key, CachedRender& out) const;
+    // Runs on the writer thread, so it only touches its arguments
+    static void save_to_disk(const std::string& path, const std::string& key, const CachedRender& entry);
+};
+
+#endif // RENDER_CACHE_H
@@ -0,0 +1,140 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#define _USE_MATH_DEFINES
+#include "Resampler.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace {
+    double bessel_i0(double x) {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Kaiser-windowed sinc, 'cutoff' relative to the input Nyquist frequency
+    double kernel(double u, double cutoff) {
+        const double half = Resampler::TAPS / 2.0;
+        const double beta = 8.0;
+        double r = u / half;
+        if (r <= -1.0 || r >= 1.0) return 0.0;
+        double x = M_PI * cutoff * u;
+        double sinc = (x == 0.0) ? 1.0 : std::sin(x) / x;
+        return cutoff * sinc * bessel_i0(beta * std::sqrt(1.0 - r * r)) / bessel_i0(beta);
+    }
+
+    // out[j] = a[j] + w * (b[j] - a[j])
+    void lerp(const float* a, const float* b, float w, float* out) {
+        int j = 0;
+#if MUSEQ_SIMD_X86
+        __m128 weight = _mm_set1_ps(w);
+        for (; j < Resampler::TAPS; j += 4) {
+            __m128 va = _mm_loadu_ps(a + j);
+            _mm_storeu_ps(out + j, _mm_add_ps(va, _mm_mul_ps(weight, _mm_sub_ps(_mm_loadu_ps(b + j), va))));
+        }
+#endif
+        for (; j < Resampler::TAPS; ++j) out[j] = a[j] + w * (b[j] - a[j]);
+    }
+
+    float dot(const float* a, const float* b) {
+#if MUSEQ_SIMD_X86
+        __m128 sum = _mm_setzero_ps();
+        for (int j = 0; j < Resampler::TAPS; j += 4) sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(b + j)));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+#else
+        float sum = 0.0f;
+        for (int j = 0; j < Resampler::TAPS; ++j) sum += a[j] * b[j];
+        return sum;
+#endif
+    }
+}
+
+Resampler::Resampler(double input_rate, double output_rate, int channels)
+    : m_input_rate(input_rate), m_output_rate(output_rate), m_channels(channels), m_step(input_rate / output_rate),
+      m_table(static_cast<size_t>(PHASES + 1) * TAPS), m_taps(TAPS) {
+    // Keep the transition band below the lower of the two Nyquist frequencies
+    double cutoff = 0.92 * (std::min)(1.0, output_rate / input_rate);
+    for (int p = 0; p <= PHASES; ++p) {
+        double frac = static_cast<double>(p) / PHASES;
+        for (int j = 0; j < TAPS; ++j) {
+            m_table[p * TAPS + j] = static_cast<float>(kernel(frac + TAPS / 2 - 1 - j, cutoff));
+        }
+    }
+    reset();
+}
+
+void Resampler::reset() {
+    m_lines.assign(m_channels, std::vector<float>(TAPS / 2, 0.0f));
+    m_line_start = -TAPS / 2;
+    m_frames_in = 0;
+    m_frames_out = 0;
+}
+
+void Resampler::process(const float* in, int frames, std::vector<float>& out) {
+    if (is_passthrough()) {
+        out.insert(out.end(), in, in + static_cast<size_t>(frames) * m_channels);
+        m_frames_in += frames;
+        m_frames_out += frames;
+        return;
+    }
+    for (int c = 0; c < m_channels; ++c) {
+        auto& line = m_lines[c];
+        for (int f = 0; f < frames; ++f) line.push_back(in[f * m_channels + c]);
+    }
+    m_frames_in += frames;
+    produce(out, -1);
+}
+
+void Resampler::flush(std::vector<float>& out) {
+    if (is_passthrough()) return;
+    for (auto& line : m_lines) line.insert(line.end(), TAPS / 2, 0.0f);
+    produce(out, static_cast<long long>(std::ceil(m_frames_in / m_step - 1e-9)));
+}
+
+void Resampler::produce(std::vector<float>& out, long long limit) {
+    const long long size = static_cast<long long>(m_lines[0].size());
+    while (limit < 0 || m_frames_out < limit) {
+        // Output at position t reads input frames floor(t) - TAPS/2 + 1 .. floor(t) + TAPS/2
+        double position = m_frames_out * m_step - m_line_start;
+        long long whole = static_cast<long long>(std::floor(position));
+        if (whole + TAPS / 2 >= size) break;
+        double phase = (position - whole) * PHASES;
+        int row = (std::min)(static_cast<int>(phase), PHASES - 1);
+        lerp(&m_table[row * TAPS], &m_table[(row + 1) * TAPS], static_cast<float>(phase - row), m_taps.data());
+        for (int c = 0; c < m_channels; ++c) out.push_back(dot(m_lines[c].data() + whole - TAPS / 2 + 1, m_taps.data()));
+        m_frames_out++;
+    }
+
+    // Drop the input no later output can reach
+    long long drop = static_cast<long long>(std::floor(m_frames_out * m_step - m_line_start)) - TAPS / 2 + 1;
+    drop = (std::min)(drop, size);
+    if (drop > 0) {
+        for (auto& line : m_lines) line.erase(line.begin(), line.begin() + drop);
+        m_line_start += drop;
+    }
+}
+
+std::vector<float> Resampler::convert(const std::vector<float>& in, double input_rate, double output_rate, int channels) {
+    if (input_rate == output_rate) return in;
+    Resampler resampler(input_rate, output_rate, channels);
+    std::vector<float> out;
+    out.reserve(static_cast<size_t>(in.size() * (output_rate / input_rate)) + TAPS * channels);
+    const int CHUNK = 4096;
+    int frames = static_cast<int>(in.size() / channels);
+    for (int start = 0; start < frames; start += CHUNK) {
+        resampler.process(in.data() + static_cast<size_t>(start) * channels, (std::min)(CHUNK, frames - start), out);
+    }
+    resampler.flush(out);
+    return out;
+}
@@ -0,0 +1,47 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <vector>
+
+// Streaming sample rate converter: a windowed-sinc filter evaluated at each output position. The
+// filter is tabulated at PHASES sub-sample offsets and interpolated between them, so any pair of
+// rates works without a table per rational ratio. When converting down, the cutoff follows the
+// output Nyquist frequency.
+class Resampler {
+public:
+    static constexpr int TAPS = 64;    // Input samples per output sample
+    static constexpr int PHASES = 256; // Filter table resolution between two input samples
+
+    Resampler(double input_rate, double output_rate, int channels = 2);
+
+    double get_input_rate() const { return m_input_rate; }
+    double get_output_rate() const { return m_output_rate; }
+    bool is_passthrough() const { return m_input_rate == m_output_rate; }
+
+    // Consumes 'frames' interleaved input frames and appends every output frame they complete.
+    // Output frame m is the input at time m * input_rate / output_rate; it is only complete once
+    // the TAPS / 2 input frames after that time have arrived.
+    void process(const float* in, int frames, std::vector<float>& out);
+    // Feeds silence until the output has caught up with everything passed in so far
+    void flush(std::vector<float>& out);
+    void reset();
+
+    // A whole buffer at once, aligned with the input and cut to its duration at the new rate
+    static std::vector<float> convert(const std::vector<float>& in, double input_rate, double output_rate, int channels = 2);
+
+private:
+    double m_input_rate, m_output_rate;
+    int m_channels;
+    double m_step;                // Input frames per output frame
+    std::vector<float> m_table;   // (PHASES + 1) rows of TAPS coefficients
+    std::vector<std::vector<float>> m_lines; // Per channel: input from TAPS / 2 frames before the next output on
+    std::vector<float> m_taps;    // Scratch: the coefficients for the current output position
+    long long m_line_start = 0;   // Input frame at the start of m_lines (negative: silence before the start)
+    long long m_frames_in = 0;
+    long long m_frames_out = 0;
+
+    // Computes outputs while their input is in m_lines, up to 'limit' outputs in total
+    void produce(std::vector<float>& out, long long limit);
+};
+
+#endif // RESAMPLER_H
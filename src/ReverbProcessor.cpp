@@ -0,0 +1,176 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#include "ReverbProcessor.h"
+#include "Simd.h"
+#include <algorithm>
+
+namespace {
+    // Mono input and comb output are staged per chunk, so the comb bank runs as one block
+    const int CHUNK = 256;
+
+    int next_power_of_two(int n) {
+        int p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // Each comb's output is summed in comb order in every version, so all instruction sets
+    // produce exactly the same samples.
+    void combs_scalar(CombBank& bank, const float* in, float* out, int frames) {
+        const float damp1 = 1.0f - bank.damp;
+        for (int f = 0; f < frames; ++f) {
+            float* row = bank.lines + bank.pos * CombBank::LANES;
+            float sum = 0.0f;
+            for (int c = 0; c < CombBank::LANES; ++c) {
+                float y = bank.lines[((bank.pos - bank.delays[c]) & bank.mask) * CombBank::LANES + c];
+                bank.state[c] = (y * damp1) + (bank.state[c] * bank.damp);
+                row[c] = in[f] + (bank.state[c] * bank.feedback);
+                sum += y;
+            }
+            out[f] = sum;
+            bank.pos = (bank.pos + 1) & bank.mask;
+        }
+    }
+
+#if MUSEQ_SIMD_X86
+    inline float sum_lanes(const float* y) {
+        float sum = 0.0f;
+        for (int c = 0; c < CombBank::LANES; ++c) sum += y[c];
+        return sum;
+    }
+
+    void combs_sse2(CombBank& bank, const float* in, float* out, int frames) {
+        const __m128 damp = _mm_set1_ps(bank.damp);
+        const __m128 damp1 = _mm_set1_ps(1.0f - bank.damp);
+        const __m128 feedback = _mm_set1_ps(bank.feedback);
+        __m128 state_lo = _mm_load_ps(bank.state);
+        __m128 state_hi = _mm_load_ps(bank.state + 4);
+        const int32_t* d = bank.delays;
+        const int mask = bank.mask;
+        int pos = bank.pos;
+
+        for (int f = 0; f < frames; ++f) {
+            const float* l = bank.lines;
+            alignas(16) float y[CombBank::LANES];
+            for (int c = 0; c < CombBank::LANES; ++c) y[c] = l[((pos - d[c]) & mask) * CombBank::LANES + c];
+            __m128 y_lo = _mm_load_ps(y);
+            __m128 y_hi = _mm_load_ps(y + 4);
+            state_lo = _mm_add_ps(_mm_mul_ps(y_lo, damp1), _mm_mul_ps(state_lo, damp));
+            state_hi = _mm_add_ps(_mm_mul_ps(y_hi, damp1), _mm_mul_ps(state_hi, damp));
+            __m128 x = _mm_set1_ps(in[f]);
+            float* row = bank.lines + pos * CombBank::LANES;
+            _mm_store_ps(row, _mm_add_ps(x, _mm_mul_ps(state_lo, feedback)));
+            _mm_store_ps(row + 4, _mm_add_ps(x, _mm_mul_ps(state_hi, feedback)));
+            out[f] = sum_lanes(y);
+            pos = (pos + 1) & mask;
+        }
+
+        _mm_store_ps(bank.state, state_lo);
+        _mm_store_ps(bank.state + 4, state_hi);
+        bank.pos = pos;
+    }
+
+    MUSEQ_TARGET_AVX2 void combs_avx2(CombBank& bank, const float* in, float* out, int frames) {
+        const __m256i lane_ids = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i delays = _mm256_load_si256(reinterpret_cast<const __m256i*>(bank.delays));
+        const __m256i mask = _mm256_set1_epi32(bank.mask);
+        const __m256 damp = _mm256_set1_ps(bank.damp);
+        const __m256 damp1 = _mm256_set1_ps(1.0f - bank.damp);
+        const __m256 feedback = _mm256_set1_ps(bank.feedback);
+        __m256 state = _mm256_load_ps(bank.state);
+        int pos = bank.pos;
+
+        for (int f = 0; f < frames; ++f) {
+            __m256i rows = _mm256_and_si256(_mm256_sub_epi32(_mm256_set1_epi32(pos), delays), mask);
+            __m256i idx = _mm256_add_epi32(_mm256_slli_epi32(rows, 3), lane_ids);
+            __m256 y = _mm256_i32gather_ps(bank.lines, idx, 4);
+            state = _mm256_add_ps(_mm256_mul_ps(y, damp1), _mm256_mul_ps(state, damp));
+            _mm256_store_ps(bank.lines + pos * CombBank::LANES,
+                            _mm256_add_ps(_mm256_set1_ps(in[f]), _mm256_mul_ps(state, feedback)));
+            alignas(32) float ys[CombBank::LANES];
+            _mm256_store_ps(ys, y);
+            out[f] = sum_lanes(ys);
+            pos = (pos + 1) & bank.mask;
+        }
+
+        _mm256_store_ps(bank.state, state);
+        bank.pos = pos;
+    }
+#endif
+}
+
+AllPassFilter::AllPassFilter(int size) {
+    delay = (std::max)(1, size);
+    buffer.assign(next_power_of_two(delay), 0.0f);
+    mask = static_cast<int>(buffer.size()) - 1;
+}
+
+void AllPassFilter::reset() {
+    std::fill(buffer.begin(), buffer.end(), 0.0f);
+    pos = 0;
+}
+
+ReverbProcessor::ReverbProcessor(float sample_rate) {
+    // Freeverb-ish constants
+    const int comb_sizes[] = {1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617};
+    const int allpass_sizes[] = {556, 441, 341, 225};
+
+    int longest = 1;
+    for (int c = 0; c < CombBank::LANES; ++c) {
+        m_combs.delays[c] = (std::max)(1, static_cast<int>(comb_sizes[c] * (sample_rate / 44100.0f)));
+        longest = (std::max)(longest, static_cast<int>(m_combs.delays[c]));
+    }
+    int rows = next_power_of_two(longest);
+    m_combs.mask = rows - 1;
+    // One spare row, so the lines can start on a 32-byte boundary
+    m_combs.storage.assign(static_cast<size_t>(rows + 1) * CombBank::LANES, 0.0f);
+    size_t misalignment = reinterpret_cast<uintptr_t>(m_combs.storage.data()) % 32;
+    m_combs.lines = m_combs.storage.data() + (misalignment ? (32 - misalignment) / sizeof(float) : 0);
+
+    for (int s : allpass_sizes) m_allpasses.emplace_back(static_cast<int>(s * (sample_rate / 44100.0f)));
+}
+
+void ReverbProcessor::reset() {
+    std::fill(m_combs.storage.begin(), m_combs.storage.end(), 0.0f);
+    std::fill(m_combs.state, m_combs.state + CombBank::LANES, 0.0f);
+    m_combs.pos = 0;
+    for (auto& a : m_allpasses) a.reset();
+}
+
+void ReverbProcessor::set_params(float room_size, float damp, float mix) {
+    m_combs.feedback = room_size;
+    m_combs.damp = damp;
+    mix = (std::max)(0.0f, (std::min)(mix, 1.0f));
+    m_wet = (std::min)(1.0f, 2.0f * mix);
+    m_dry = (std::min)(1.0f, 2.0f * (1.0f - mix));
+}
+
+void ReverbProcessor::process(float* buffer, int frames) {
+    float input[CHUNK], combs[CHUNK];
+    SimdLevel level = Simd::get_level();
+
+    for (int start = 0; start < frames; start += CHUNK) {
+        int count = (std::min)(CHUNK, frames - start);
+        float* frame = buffer + start * 2;
+        for (int f = 0; f < count; ++f) input[f] = (frame[f * 2] + frame[f * 2 + 1]) * 0.5f;
+
+        // Parallel combs
+#if MUSEQ_SIMD_X86
+        if (level == SimdLevel::AVX2) combs_avx2(m_combs, input, combs, count);
+        else if (level == SimdLevel::SSE2) combs_sse2(m_combs, input, combs, count);
+        else combs_scalar(m_combs, input, combs, count);
+#else
+        (void)level;
+        combs_scalar(m_combs, input, combs, count);
+#endif
+
+        // Serial all-passes, then the wet and dry mix
+        for (int f = 0; f < count; ++f) {
+            float out = combs[f];
+            for (auto& a : m_allpasses) out = a.process(out);
+            frame[f * 2] = frame[f * 2] * m_dry + out * m_wet;
+            frame[f * 2 + 1] = frame[f * 2 + 1] * m_dry + out * m_wet;
+        }
+    }
+}
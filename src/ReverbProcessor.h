@@ -2,83 +2,65 @@
 #define REVERB_PROCESSOR_H
 
 #include <vector>
+#include <cstdint>
 
-// Simple Comb Filter for Reverb
-struct CombFilter {
-    std::vector<float> buffer;
-    int write_idx = 0;
-    float feedback = 0.5f;
-    float filter_state = 0.0f;
-    float dampening = 0.2f;
-
-    CombFilter(int size) : buffer(size, 0.0f) {}
+// Freeverb's eight parallel comb filters, sharing one interleaved delay line:
+// row r holds sample r of every comb, so a step writes all combs with one vector store
+// and reads them with one gather. Rows are a power of two, so wrapping is a mask.
+struct CombBank {
+    static constexpr int LANES = 8;
 
-    float process(float in) {
-        float out = buffer[write_idx];
-        filter_state = (out * (1.0f - dampening)) + (filter_state * dampening);
-        buffer[write_idx] = in + (filter_state * feedback);
-        if (++write_idx >= buffer.size()) write_idx = 0;
-        return out;
-    }
+    std::vector<float> storage;
+    float* lines = nullptr; // 32-byte aligned start inside 'storage'
+    int mask = 0;           // Row count - 1
+    int pos = 0;            // Row written next
+    alignas(32) int32_t delays[LANES] = {};
+    alignas(32) float state[LANES] = {}; // One-pole damping filter per comb
+    float feedback = 0.5f;
+    float damp = 0.2f;
 };
 
-// Simple All-pass Filter
+// Simple All-pass Filter, with a power-of-two buffer so the wrap needs no branch
 struct AllPassFilter {
     std::vector<float> buffer;
-    int write_idx = 0;
+    int delay = 0;
+    int mask = 0;
+    int pos = 0;
     float feedback = 0.5f;
 
-    AllPassFilter(int size) : buffer(size, 0.0f) {}
+    AllPassFilter(int size);
+    void reset();
 
     float process(float in) {
-        float buf_out = buffer[write_idx];
+        float buf_out = buffer[(pos - delay) & mask];
         float out = -in + buf_out;
-        buffer[write_idx] = in + (buf_out * feedback);
-        if (++write_idx >= buffer.size()) write_idx = 0;
+        buffer[pos] = in + (buf_out * feedback);
+        pos = (pos + 1) & mask;
         return out;
     }
 };
 
 class ReverbProcessor {
 public:
-    ReverbProcessor(float sample_rate) {
-        // Freeverb-ish constants
-        const int comb_sizes[] = {1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617};
-        const int allpass_sizes[] = {556, 441, 341, 225};
-        
-        for (int s : comb_sizes) m_combs.emplace_back(static_cast<int>(s * (sample_rate / 44100.0f)));
-        for (int s : allpass_sizes) m_allpasses.emplace_back(static_cast<int>(s * (sample_rate / 44100.0f)));
-    }
+    ReverbProcessor(float sample_rate);
+    ReverbProcessor(const ReverbProcessor&) = delete;
+    ReverbProcessor& operator=(const ReverbProcessor&) = delete;
 
-    void set_params(float room_size, float damp) {
-        for (auto& c : m_combs) {
-            c.feedback = room_size;
-            c.dampening = damp;
-        }
-    }
+    // 'mix' runs from dry only (0) through both at full level (0.5) to reverb only (1)
+    void set_params(float room_size, float damp, float mix = DEFAULT_MIX);
 
-    void process(float* left, float* right, int frames) {
-        for (int i = 0; i < frames; ++i) {
-            float in = (left[i] + right[i]) * 0.5f;
-            float out = 0;
-            
-            // Parallel combs
-            for (auto& c : m_combs) out += c.process(in);
-            
-            // Serial all-passes
-            for (auto& a : m_allpasses) out = a.process(out);
-            
-            // Mix (Wet/Dry handled outside or here?)
-            // For now, simple additive mix
-            float wet = 0.2f;
-            left[i] += out * wet;
-            right[i] += out * wet;
-        }
-    }
+    // Mixes the reverb into an interleaved stereo block in place
+    void process(float* buffer, int frames);
+    // Clears every line in place, as if nothing had been processed
+    void reset();
+
+    static constexpr float DEFAULT_MIX = 0.1f; // Dry at full level, reverb at 0.2
 
 private:
-    std::vector<CombFilter> m_combs;
+    CombBank m_combs;
     std::vector<AllPassFilter> m_allpasses;
+    float m_wet = 2.0f * DEFAULT_MIX;
+    float m_dry = 1.0f;
 };
 
 #endif
@@ -1,8 +1,9 @@
 #include "Sampler.h"
+#include "Resampler.h"
 #include "sndfile.h"
 #include <iostream>
 
-Sampler::Sampler(const std::string& file_path) : sample_rate(0.0f) {
+Sampler::Sampler(const std::string& file_path) : path(file_path), sample_rate(0.0f) {
     SF_INFO sfinfo;
     SNDFILE* infile = sf_open(file_path.c_str(), SFM_READ, &sfinfo);
     if (infile) {
@@ -17,16 +18,19 @@ Sampler::Sampler(const std::string& file_path) : sample_rate(0.0f) {
 
 // Copy constructor
 Sampler::Sampler(const Sampler& other)
-    : samples(other.samples), sample_rate(other.sample_rate) {
+    : path(other.path), samples(other.samples), sample_rate(other.sample_rate) {
 }
 
-float Sampler::get_sample(float time) {
-    if (sample_rate == 0.0f || samples.empty()) {
-        return 0.0f;
-    }
-    int index = static_cast<int>(time * sample_rate);
-    if (index >= 0 && static_cast<size_t>(index) < samples.size()) {
-        return samples[index];
-    }
+std::shared_ptr<const RenderedSample> Sampler::render_at(float rate) const {
+    auto rendered = std::make_shared<RenderedSample>();
+    if (sample_rate == 0.0f || samples.empty()) return rendered;
+    rendered->rate = rate;
+    rendered->samples = (rate == sample_rate) ? samples : Resampler::convert(samples, sample_rate, rate, 1);
+    return rendered;
+}
+
+float RenderedSample::get_sample(float time) const {
+    int index = static_cast<int>(time * rate);
+    if (index >= 0 && static_cast<size_t>(index) < samples.size()) return samples[index];
     return 0;
 }
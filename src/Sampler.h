@@ -3,14 +3,27 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+
+// A sample file converted to the rate voices render at. Each renderer keeps its own, so the
+// Sampler in the song tree is never modified while another thread may be reading it.
+struct RenderedSample {
+    std::vector<float> samples;
+    float rate = 0.0f;
+
+    float get_sample(float time) const;
+};
 
 class Sampler {
 public:
     Sampler(const std::string& file_path);
     Sampler(const Sampler& other); // Copy constructor
-    float get_sample(float time);
+    const std::string& get_path() const { return path; }
+    // The file at 'rate', converted without aliasing
+    std::shared_ptr<const RenderedSample> render_at(float rate) const;
 
 private:
+    std::string path;
     std::vector<float> samples;
     float sample_rate;
 };
@@ -0,0 +1,115 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#include "ScopeBus.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // Copies the writer overtook are retried this often before a reader gives up
+    const int READ_ATTEMPTS = 4;
+}
+
+ScopeTap::ScopeTap(int length_frames) : m_length((std::max)(1, length_frames)) {
+    m_capacity = 1;
+    while (m_capacity < static_cast<uint64_t>(m_length) * 2) m_capacity <<= 1;
+    m_samples = std::make_unique<std::atomic<float>[]>(m_capacity * 2);
+    for (uint64_t i = 0; i < m_capacity * 2; ++i) m_samples[i].store(0.0f, std::memory_order_relaxed);
+}
+
+void ScopeTap::write(const float* stereo, int frames) {
+    append(stereo, frames, m_decimation.load(std::memory_order_relaxed));
+}
+
+void ScopeTap::append(const float* stereo, int frames, int decimation) {
+    // In batches no longer than the tap, so the newest m_length frames are never being overwritten
+    while (frames > 0) {
+        int take = (std::min)(frames, m_length);
+        int kept = 0;
+        for (int phase = m_phase; phase < take; phase += decimation) kept++;
+
+        uint64_t start = m_claimed.load(std::memory_order_relaxed);
+        m_claimed.store(start + kept, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release); // Readers see the claim before any of the new samples
+
+        uint64_t pos = start;
+        int f = m_phase;
+        for (; f < take; f += decimation, ++pos) {
+            uint64_t slot = (pos & (m_capacity - 1)) * 2;
+            m_samples[slot].store(stereo[f * 2], std::memory_order_relaxed);
+            m_samples[slot + 1].store(stereo[f * 2 + 1], std::memory_order_relaxed);
+        }
+        m_phase = f - take;
+        m_published.store(start + kept, std::memory_order_release);
+
+        stereo += take * 2;
+        frames -= take;
+    }
+}
+
+void ScopeTap::clear() {
+    // Pushes the old frames out with silence, so readers never see a tap go backwards
+    static const float silence[256 * 2] = {};
+    m_phase = 0;
+    for (int left = m_length; left > 0; left -= 256) append(silence, (std::min)(left, 256), 1);
+}
+
+bool ScopeTap::copy(uint64_t start, int count, float* stereo) const {
+    for (int i = 0; i < count; ++i) {
+        uint64_t slot = ((start + i) & (m_capacity - 1)) * 2;
+        stereo[i * 2] = m_samples[slot].load(std::memory_order_relaxed);
+        stereo[i * 2 + 1] = m_samples[slot + 1].load(std::memory_order_relaxed);
+    }
+    // If the writer had claimed past our oldest slot's next lap, some of the copy may be newer
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return m_claimed.load(std::memory_order_relaxed) <= start + m_capacity;
+}
+
+int ScopeTap::snapshot(float* stereo, int frames) const {
+    for (int attempt = 0; attempt < READ_ATTEMPTS; ++attempt) {
+        uint64_t end = m_published.load(std::memory_order_acquire);
+        int count = static_cast<int>((std::min)(static_cast<uint64_t>((std::min)(frames, m_length)), end));
+        if (copy(end - count, count, stereo)) return count;
+    }
+    return 0;
+}
+
+int ScopeTap::read_since(uint64_t& position, float* stereo, int max_frames) const {
+    for (int attempt = 0; attempt < READ_ATTEMPTS; ++attempt) {
+        uint64_t end = m_published.load(std::memory_order_acquire);
+        if (position > end) position = end;
+        if (end - position > static_cast<uint64_t>(m_length)) position = end - m_length;
+        int count = static_cast<int>((std::min)(static_cast<uint64_t>((std::max)(max_frames, 0)), end - position));
+        if (copy(position, count, stereo)) {
+            position += count;
+            return count;
+        }
+    }
+    return 0;
+}
+
+ScopeBus::ScopeBus(int master_length_frames, int track_length_frames) {
+    m_taps.reserve(MAX_TAPS);
+    m_taps.push_back(std::make_unique<ScopeTap>(master_length_frames));
+    for (int i = 1; i < MAX_TAPS; ++i) m_taps.push_back(std::make_unique<ScopeTap>(track_length_frames));
+    m_published_layout.publish(m_layout);
+}
+
+int ScopeBus::find_or_assign_track(const std::string& name) {
+    for (int i = 1; i < m_layout.count; ++i) {
+        if (name.compare(0, NAME_LENGTH - 1, m_layout.names[i]) == 0) return i;
+    }
+    if (m_layout.count == MAX_TAPS) return -1;
+    int index = m_layout.count++;
+    std::size_t length = (std::min)(name.size(), static_cast<std::size_t>(NAME_LENGTH - 1));
+    std::memcpy(m_layout.names[index], name.data(), length);
+    m_layout.names[index][length] = '\0';
+    m_published_layout.publish(m_layout);
+    return index;
+}
+
+void ScopeBus::release_tracks() {
+    for (int i = 1; i < m_layout.count; ++i) m_taps[i]->clear();
+    m_layout.count = 1;
+    m_published_layout.publish(m_layout);
+}
@@ -0,0 +1,86 @@
+#ifndef SCOPE_BUS_H
+#define SCOPE_BUS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TripleBuffer.h"
+
+// The newest stereo frames of one signal, for scopes and analysis. One thread writes; any number
+// of threads copy out of it without locks and without ever holding up the writer. A copy the
+// writer overtook is detected and retried, so readers always get frames from one moment in time.
+class ScopeTap {
+public:
+    explicit ScopeTap(int length_frames = 4096);
+
+    // Frames a snapshot can hold
+    int get_length() const { return m_length; }
+
+    // Writer: interleaved stereo. Only every 'decimation'-th frame is kept, so a tap of the same
+    // length covers a longer stretch of time.
+    void write(const float* stereo, int frames);
+    void set_decimation(int decimation) { m_decimation.store(decimation < 1 ? 1 : decimation, std::memory_order_relaxed); }
+    int get_decimation() const { return m_decimation.load(std::memory_order_relaxed); }
+    // Forget what was written (the writer's thread, or while it is stopped)
+    void clear();
+
+    // Reader: the newest 'frames' kept frames, oldest first. Returns how many were copied (fewer
+    // when less has been written, 0 if the writer kept overtaking the copy).
+    int snapshot(float* stereo, int frames) const;
+    // Reader, as a stream: the frames kept since 'position' (a count of kept frames), which is
+    // advanced. Frames the writer has already overwritten are skipped.
+    int read_since(uint64_t& position, float* stereo, int max_frames) const;
+    uint64_t get_frames_kept() const { return m_published.load(std::memory_order_acquire); }
+
+private:
+    int m_length;
+    uint64_t m_capacity; // Twice the length, rounded up to a power of two: room for the writer to run ahead
+    std::unique_ptr<std::atomic<float>[]> m_samples;
+    std::atomic<uint64_t> m_claimed{ 0 };   // Frames the writer has started to overwrite
+    std::atomic<uint64_t> m_published{ 0 }; // Frames that are complete
+    std::atomic<int> m_decimation{ 1 };
+    int m_phase = 0; // Writer's position in the decimation cycle
+
+    void append(const float* stereo, int frames, int decimation);
+    // Copies kept frames [start, start + count); false if the writer overwrote any of them meanwhile
+    bool copy(uint64_t start, int count, float* stereo) const;
+};
+
+// A fixed set of taps: the master output, and one per track. Taps are allocated up front, so
+// handing them out never allocates in a writer or pulls memory from under a reader.
+class ScopeBus {
+public:
+    static constexpr int MAX_TAPS = 32;
+    static constexpr int MASTER = 0;
+    static constexpr int NAME_LENGTH = 32; // Longer track names are cut short
+
+    // Which tap carries what. Published by the thread that assigns tracks, read by one UI thread.
+    struct Layout {
+        int count = 1;
+        char names[MAX_TAPS][NAME_LENGTH] = { "Master" };
+    };
+
+    ScopeBus(int master_length_frames = 4096, int track_length_frames = 4096);
+
+    ScopeTap& tap(int index) { return *m_taps[index]; }
+    const ScopeTap& tap(int index) const { return *m_taps[index]; }
+
+    // Track taps, from the thread that writes them: the tap for 'name', assigned on first use.
+    // Returns -1 once all taps are taken.
+    int find_or_assign_track(const std::string& name);
+    int get_track_count() const { return m_layout.count - 1; }
+    // Frees all track taps (the master stays), e.g. when a new song is loaded
+    void release_tracks();
+
+    // Reader: call from one thread
+    const Layout& read_layout() { return m_published_layout.read(); }
+
+private:
+    std::vector<std::unique_ptr<ScopeTap>> m_taps;
+    Layout m_layout;
+    TripleBuffer<Layout> m_published_layout;
+};
+
+#endif // SCOPE_BUS_H
@@ -5,11 +5,15 @@
 #include <vector>
 #include <algorithm>
 #include <filesystem>
+#include <cctype>
+#include <iomanip>
 #include "NoteParser.h"
 #include "SongElement.h"
 #include "Chord.h"
+#include "ReverbProcessor.h"
+#include "Convolver.h"
 
-int ScriptParser::s_global_bpm = 120;
+std::atomic<int> ScriptParser::s_global_bpm{ 120 };
 
 void ScriptParser::set_global_bpm(int bpm) {
     if (bpm > 0) s_global_bpm = bpm;
@@ -31,6 +35,31 @@ int ScriptParser::calculate_denominator_duration(int denominator) {
     return static_cast<int>((4.0 / denominator) * beat_duration);
 }
 
+// Reads a trailing numeric argument if there is one; anything else is left in the stream
+static float read_optional_float(std::istream& in, float fallback) {
+    in >> std::ws;
+    int c = in.peek();
+    if (c == EOF || !(std::isdigit(c) || c == '.' || c == '-')) return fallback;
+    float value = fallback;
+    if (!(in >> value)) return fallback;
+    return value;
+}
+
+// Reads "polyphony <voices> [oldest|quietest]" arguments into 'inst'; returns an error message, if any
+static std::string read_polyphony(std::istream& in, Instrument& inst) {
+    std::string policy;
+    in >> inst.polyphony >> policy;
+    if (inst.polyphony < 0) inst.polyphony = 0;
+    if (policy.empty()) return "";
+    if (policy == "quietest") {
+        inst.stealing = VoiceStealing::QUIETEST;
+    } else {
+        inst.stealing = VoiceStealing::OLDEST;
+        if (policy != "oldest") return "Unknown voice stealing policy '" + policy + "'. Using 'oldest'.";
+    }
+    return "";
+}
+
 static std::string preprocess_line(const std::string& raw_line) {
     std::string line = raw_line;
     size_t comment_pos = line.find("//");
@@ -53,9 +82,10 @@ static std::string preprocess_line(const std::string& raw_line) {
 }
 
 ScriptParser::ScriptParser() {
-    m_current_bpm = s_global_bpm;
+    // Read once, so the whole parse uses one tempo
+    m_current_bpm = s_global_bpm.load(std::memory_order_relaxed);
     // Set default duration based on global BPM
-    m_default_duration = 60000 / s_global_bpm;
+    m_default_duration = 60000 / m_current_bpm;
 
     // Add built-in Rest instrument (produces silence)
     Instrument rest("Rest", Waveform::SINE, AdsrEnvelope(0, 0, 0, 0));
@@ -79,6 +109,7 @@ Song ScriptParser::parse(const std::string& file_path) {
     parser.m_current_line = 0;
     std::map<std::string, std::string> empty_params;
     parser.process_script_stream(file, empty_params, parser.m_song.root, 0);
+    parser.m_song.bpm = parser.m_current_bpm;
 
     return parser.m_song;
 }
@@ -93,6 +124,7 @@ Song ScriptParser::parse_string(const std::string& script_content) {
     std::stringstream process_stream(script_content);
     std::map<std::string, std::string> empty_params;
     parser.process_script_stream(process_stream, empty_params, parser.m_song.root, 0);
+    parser.m_song.bpm = parser.m_current_bpm;
 
     return parser.m_song;
 }
@@ -360,16 +392,22 @@ void ScriptParser::collect_definitions(std::istream& input_stream, const std::st
                     sub_ss >> template_inst.pan;
                 } else if (sub_kw == "gain") {
                     sub_ss >> template_inst.gain;
+                } else if (sub_kw == "polyphony") {
+                    std::string error = read_polyphony(sub_ss, template_inst);
+                    if (!error.empty()) report_error(error);
                 } else if (sub_kw == "effect") {
                     std::string type_str; sub_ss >> type_str;
                     Effect fx;
                     if (type_str == "delay") { fx.type = EffectType::DELAY; sub_ss >> fx.param1 >> fx.param2; }
-                    else if (type_str == "distortion") { fx.type = EffectType::DISTORTION; sub_ss >> fx.param1; }
-                    else if (type_str == "bitcrush") { fx.type = EffectType::BITCRUSH; sub_ss >> fx.param1; }
+                    else if (type_str == "distortion") { fx.type = EffectType::DISTORTION; sub_ss >> fx.param1; fx.param2 = read_optional_float(sub_ss, 1.0f); }
+                    else if (type_str == "bitcrush") { fx.type = EffectType::BITCRUSH; sub_ss >> fx.param1; fx.param2 = read_optional_float(sub_ss, 1.0f); }
                     else if (type_str == "fadein") { fx.type = EffectType::FADE_IN; sub_ss >> fx.param1; }
                     else if (type_str == "fadeout") { fx.type = EffectType::FADE_OUT; sub_ss >> fx.param1; }
                     else if (type_str == "tremolo") { fx.type = EffectType::TREMOLO; sub_ss >> fx.param1 >> fx.param2; }
-                    else if (type_str == "reverb") { fx.type = EffectType::REVERB; sub_ss >> fx.param1 >> fx.param2; }
+                    else if (type_str == "reverb") { fx.type = EffectType::REVERB; sub_ss >> fx.param1 >> fx.param2; fx.param3 = read_optional_float(sub_ss, ReverbProcessor::DEFAULT_MIX); }
+                    else if (type_str == "convolve") { fx.type = EffectType::CONVOLVE; sub_ss >> std::quoted(fx.path); fx.param1 = read_optional_float(sub_ss, Convolver::DEFAULT_WET); }
+                    else if (type_str == "chorus") { fx.type = EffectType::CHORUS; sub_ss >> fx.param1 >> fx.param2; fx.param3 = read_optional_float(sub_ss, 0.5f); }
+                    else if (type_str == "flanger") { fx.type = EffectType::FLANGER; sub_ss >> fx.param1 >> fx.param2; fx.param3 = read_optional_float(sub_ss, 0.5f); }
                     template_inst.effects.push_back(fx);
                 } else if (sub_kw == "sequence") {
                     in_sequence = true;
@@ -730,12 +768,15 @@ void ScriptParser::process_script_stream(std::istream& input_stream, const std::
             std::string type_str; ss >> type_str;
             Effect fx;
             if (type_str == "delay") { fx.type = EffectType::DELAY; ss >> fx.param1 >> fx.param2; }
-            else if (type_str == "distortion") { fx.type = EffectType::DISTORTION; ss >> fx.param1; }
-            else if (type_str == "bitcrush") { fx.type = EffectType::BITCRUSH; ss >> fx.param1; }
+            else if (type_str == "distortion") { fx.type = EffectType::DISTORTION; ss >> fx.param1; fx.param2 = read_optional_float(ss, 1.0f); }
+            else if (type_str == "bitcrush") { fx.type = EffectType::BITCRUSH; ss >> fx.param1; fx.param2 = read_optional_float(ss, 1.0f); }
             else if (type_str == "fadein") { fx.type = EffectType::FADE_IN; ss >> fx.param1; }
             else if (type_str == "fadeout") { fx.type = EffectType::FADE_OUT; ss >> fx.param1; }
             else if (type_str == "tremolo") { fx.type = EffectType::TREMOLO; ss >> fx.param1 >> fx.param2; }
-            else if (type_str == "reverb") { fx.type = EffectType::REVERB; ss >> fx.param1 >> fx.param2; }
+            else if (type_str == "reverb") { fx.type = EffectType::REVERB; ss >> fx.param1 >> fx.param2; fx.param3 = read_optional_float(ss, ReverbProcessor::DEFAULT_MIX); }
+            else if (type_str == "convolve") { fx.type = EffectType::CONVOLVE; ss >> std::quoted(fx.path); fx.param1 = read_optional_float(ss, Convolver::DEFAULT_WET); }
+            else if (type_str == "chorus") { fx.type = EffectType::CHORUS; ss >> fx.param1 >> fx.param2; fx.param3 = read_optional_float(ss, 0.5f); }
+            else if (type_str == "flanger") { fx.type = EffectType::FLANGER; ss >> fx.param1 >> fx.param2; fx.param3 = read_optional_float(ss, 0.5f); }
             
             if (fx.type != EffectType::NONE) {
                 current_parent->effects.push_back(fx);
@@ -848,18 +889,24 @@ void ScriptParser::process_script_stream(std::istream& input_stream, const std::
                         lss >> inst.pan;
                     } else if (lkw == "gain") {
                         lss >> inst.gain;
+                    } else if (lkw == "polyphony") {
+                        std::string error = read_polyphony(lss, inst);
+                        if (!error.empty()) report_error(error);
                     } else if (lkw == "octave") {
                         lss >> current_octave;
                     } else if (lkw == "effect") {
                         std::string type_str; lss >> type_str;
                         Effect fx;
                         if (type_str == "delay") { fx.type = EffectType::DELAY; lss >> fx.param1 >> fx.param2; }
-                        else if (type_str == "distortion") { fx.type = EffectType::DISTORTION; lss >> fx.param1; }
-                        else if (type_str == "bitcrush") { fx.type = EffectType::BITCRUSH; lss >> fx.param1; }
+                        else if (type_str == "distortion") { fx.type = EffectType::DISTORTION; lss >> fx.param1; fx.param2 = read_optional_float(lss, 1.0f); }
+                        else if (type_str == "bitcrush") { fx.type = EffectType::BITCRUSH; lss >> fx.param1; fx.param2 = read_optional_float(lss, 1.0f); }
                         else if (type_str == "fadein") { fx.type = EffectType::FADE_IN; lss >> fx.param1; }
                         else if (type_str == "fadeout") { fx.type = EffectType::FADE_OUT; lss >> fx.param1; }
                         else if (type_str == "tremolo") { fx.type = EffectType::TREMOLO; lss >> fx.param1 >> fx.param2; }
-                        else if (type_str == "reverb") { fx.type = EffectType::REVERB; lss >> fx.param1 >> fx.param2; }
+                        else if (type_str == "reverb") { fx.type = EffectType::REVERB; lss >> fx.param1 >> fx.param2; fx.param3 = read_optional_float(lss, ReverbProcessor::DEFAULT_MIX); }
+                        else if (type_str == "convolve") { fx.type = EffectType::CONVOLVE; lss >> std::quoted(fx.path); fx.param1 = read_optional_float(lss, Convolver::DEFAULT_WET); }
+                        else if (type_str == "chorus") { fx.type = EffectType::CHORUS; lss >> fx.param1 >> fx.param2; fx.param3 = read_optional_float(lss, 0.5f); }
+                        else if (type_str == "flanger") { fx.type = EffectType::FLANGER; lss >> fx.param1 >> fx.param2; fx.param3 = read_optional_float(lss, 0.5f); }
                         inst.effects.push_back(fx);
                     }
                 }
@@ -2,6 +2,7 @@
 #define SCRIPT_PARSER_H
 
 #include "Song.h"
+#include <atomic>
 #include <memory>
 #include <map>
 #include <sstream>
@@ -21,7 +22,7 @@ public:
 
 private:
     Song m_song;
-    static int s_global_bpm;
+    static std::atomic<int> s_global_bpm; // Set by the UI while songs parse on other threads
     std::map<std::string, FunctionDefinition> m_functions;
     std::map<std::string, Instrument> m_templates;
     std::map<std::string, std::string> m_globals;
@@ -0,0 +1,59 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#include "Simd.h"
+#include <atomic>
+
+#if MUSEQ_SIMD_X86 && defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace {
+    SimdLevel detect_level() {
+#if MUSEQ_SIMD_X86
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return SimdLevel::SSE2;
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        // The OS must save the YMM registers on context switches
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return SimdLevel::SSE2;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#else
+        return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#endif
+#else
+        return SimdLevel::SCALAR;
+#endif
+    }
+
+    std::atomic<int>& active_level() {
+        static std::atomic<int> level(static_cast<int>(Simd::get_supported_level()));
+        return level;
+    }
+}
+
+SimdLevel Simd::get_supported_level() {
+    static const SimdLevel supported = detect_level();
+    return supported;
+}
+
+SimdLevel Simd::get_level() {
+    return static_cast<SimdLevel>(active_level().load(std::memory_order_relaxed));
+}
+
+void Simd::set_level(SimdLevel level) {
+    if (static_cast<int>(level) > static_cast<int>(get_supported_level())) level = get_supported_level();
+    active_level().store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+const char* Simd::get_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// SSE2 is part of every x86-64 CPU; AVX2 code is compiled per function and only called when detected
+#if defined(__x86_64__) || defined(_M_X64)
+    #define MUSEQ_SIMD_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #define MUSEQ_TARGET_AVX2
+    #else
+        #define MUSEQ_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#else
+    #define MUSEQ_SIMD_X86 0
+#endif
+
+enum class SimdLevel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+// Instruction set used by the vectorized DSP paths (FilterBatch, ReverbProcessor)
+class Simd {
+public:
+    // Best level supported by this CPU, detected once at startup
+    static SimdLevel get_supported_level();
+    static SimdLevel get_level();
+    // Limit the instruction set (e.g. to compare against the scalar path); clamped to what the CPU supports
+    static void set_level(SimdLevel level);
+    static const char* get_level_name(SimdLevel level);
+};
+
+#endif // SIMD_H
@@ -8,6 +8,10 @@ class Song {
 public:
     std::shared_ptr<CompositeElement> root;
     std::vector<std::pair<int, std::string>> errors;
+    // Tempo the script ends on, so live edits can land on its beats. Those are counted from the start
+    // of the song at this one tempo: after a tempo change partway through they can fall between the
+    // beats actually played.
+    int bpm = 120;
 
     Song() {
         root = std::make_shared<CompositeElement>(CompositeType::SEQUENTIAL);
@@ -0,0 +1,209 @@
+#include "SongScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    bool contains_auto_loop(const std::shared_ptr<SongElement>& element) {
+        auto comp_elem = std::dynamic_pointer_cast<CompositeElement>(element);
+        if (!comp_elem) return false;
+        if (comp_elem->type == CompositeType::AUTO_LOOP) return true;
+        for (const auto& child : comp_elem->children) {
+            if (contains_auto_loop(child)) return true;
+        }
+        return false;
+    }
+
+    // Iterations of a follower it takes to cover the leader
+    int loop_iterations(double leader_dur, double follower_dur) {
+        if (leader_dur <= 0 || follower_dur <= 0) return 0;
+        return static_cast<int>(std::ceil(leader_dur / follower_dur));
+    }
+
+    // Longest an instrument in 'element' sounds for, release tail included
+    double longest_pass_ms(const std::shared_ptr<SongElement>& element) {
+        if (auto inst_elem = std::dynamic_pointer_cast<InstrumentElement>(element)) {
+            const auto& inst = inst_elem->instrument;
+            if (inst.sequence.notes.empty()) return 0;
+            return inst_elem->get_duration_ms() + inst.synth.envelope.release * 1000.0f;
+        }
+        double longest = 0;
+        if (auto comp_elem = std::dynamic_pointer_cast<CompositeElement>(element)) {
+            for (const auto& child : comp_elem->children) longest = (std::max)(longest, longest_pass_ms(child));
+        }
+        return longest;
+    }
+
+    double element_end_ms(const std::shared_ptr<SongElement>& element, double current_time_ms) {
+        if (!element) return 0;
+        double start_time = current_time_ms + element->start_offset_ms;
+
+        if (auto inst_elem = std::dynamic_pointer_cast<InstrumentElement>(element)) {
+            const auto& inst = inst_elem->instrument;
+            if (inst.sequence.notes.empty()) return start_time;
+            return start_time + inst_elem->get_duration_ms() + inst.synth.envelope.release * 1000.0f;
+        }
+
+        double end = 0;
+        auto comp_elem = std::dynamic_pointer_cast<CompositeElement>(element);
+        if (!comp_elem) return end;
+
+        if (comp_elem->type == CompositeType::SEQUENTIAL) {
+            double local_time = start_time;
+            for (const auto& child : comp_elem->children) {
+                end = (std::max)(end, element_end_ms(child, local_time));
+                local_time += (child ? (child->start_offset_ms + child->get_duration_ms()) : 0);
+            }
+        } else if (comp_elem->type == CompositeType::PARALLEL) {
+            for (const auto& child : comp_elem->children) {
+                end = (std::max)(end, element_end_ms(child, start_time));
+            }
+        } else if (comp_elem->type == CompositeType::AUTO_LOOP && !comp_elem->children.empty()) {
+            auto leader = comp_elem->children[0];
+            if (!leader) return end;
+            double leader_dur = leader->get_duration_ms();
+            end = element_end_ms(leader, start_time);
+
+            for (size_t i = 1; i < comp_elem->children.size(); ++i) {
+                auto follower = comp_elem->children[i];
+                if (!follower) continue;
+                double follower_dur = follower->get_duration_ms();
+                if (follower_dur <= 0) continue;
+                // Every iteration is the same subtree shifted in time, so only the last one can end latest
+                int iterations = loop_iterations(leader_dur, follower_dur);
+                if (iterations > 0) end = (std::max)(end, element_end_ms(follower, start_time + (iterations - 1) * follower_dur));
+            }
+        }
+        return end;
+    }
+}
+
+void SongScheduler::reset(std::shared_ptr<SongElement> root) {
+    m_pending = decltype(m_pending)();
+    m_next_order = 0;
+    if (!root) return;
+    push(FrameKind::ELEMENT, root->start_offset_ms, 0.0, root, std::make_shared<const std::vector<Effect>>());
+}
+
+void SongScheduler::push(FrameKind kind, double key_ms, double time_ms, std::shared_ptr<SongElement> element,
+                         std::shared_ptr<const std::vector<Effect>> effects, size_t index, int iteration,
+                         double loop_period_ms, int loop_count) {
+    Frame f;
+    f.kind = kind;
+    f.key_ms = key_ms;
+    f.time_ms = time_ms;
+    f.iteration = iteration;
+    f.index = index;
+    f.loop_period_ms = loop_period_ms;
+    f.loop_count = loop_count;
+    f.order = m_next_order++;
+    f.element = std::move(element);
+    f.effects = std::move(effects);
+    m_pending.push(std::move(f));
+}
+
+void SongScheduler::advance(double horizon_ms, std::vector<ScheduledEvent>& out) {
+    while (!m_pending.empty() && m_pending.top().key_ms < horizon_ms) {
+        Frame frame = m_pending.top();
+        m_pending.pop();
+        expand(frame, out);
+    }
+}
+
+void SongScheduler::expand(const Frame& frame, std::vector<ScheduledEvent>& out) {
+    if (frame.kind == FrameKind::SEQ_STEP) {
+        auto comp = std::static_pointer_cast<CompositeElement>(frame.element);
+        auto child = comp->children[frame.index];
+        double next_time = frame.time_ms;
+        if (child) {
+            push(FrameKind::ELEMENT, frame.time_ms + child->start_offset_ms, frame.time_ms, child, frame.effects,
+                 0, 0, frame.loop_period_ms, frame.loop_count);
+            next_time += child->start_offset_ms + child->get_duration_ms();
+        }
+        if (frame.index + 1 < comp->children.size()) {
+            auto next = comp->children[frame.index + 1];
+            double key = next_time + (next ? (std::min)(0, next->start_offset_ms) : 0);
+            push(FrameKind::SEQ_STEP, key, next_time, comp, frame.effects, frame.index + 1, 0,
+                 frame.loop_period_ms, frame.loop_count);
+        }
+        return;
+    }
+
+    if (frame.kind == FrameKind::LOOP_STEP) {
+        auto comp = std::static_pointer_cast<CompositeElement>(frame.element);
+        auto follower = comp->children[frame.index];
+        double follower_dur = follower->get_duration_ms();
+        if (frame.iteration >= loop_iterations(comp->children[0]->get_duration_ms(), follower_dur)) return;
+        double t = frame.time_ms + frame.iteration * follower_dur;
+        push(FrameKind::ELEMENT, t + follower->start_offset_ms, t, follower, frame.effects);
+        push(FrameKind::LOOP_STEP, t + follower_dur, frame.time_ms, comp, frame.effects, frame.index, frame.iteration + 1);
+        return;
+    }
+
+    auto element = frame.element;
+    double start_time = frame.time_ms + element->start_offset_ms;
+
+    if (auto inst_elem = std::dynamic_pointer_cast<InstrumentElement>(element)) {
+        ScheduledEvent ev;
+        ev.element = inst_elem;
+        ev.start_ms = start_time;
+        ev.parent_effects = frame.effects;
+        ev.loop_period_ms = frame.loop_period_ms;
+        ev.loop_count = frame.loop_count;
+        out.push_back(std::move(ev));
+    }
+    else if (auto comp_elem = std::dynamic_pointer_cast<CompositeElement>(element)) {
+        // Parent effects (outer blocks) apply after this block's own effects
+        auto effects = frame.effects;
+        if (!comp_elem->effects.empty()) {
+            auto combined = std::make_shared<std::vector<Effect>>(*frame.effects);
+            combined->insert(combined->end(), comp_elem->effects.begin(), comp_elem->effects.end());
+            effects = combined;
+        }
+        if (comp_elem->children.empty()) return;
+
+        if (comp_elem->type == CompositeType::SEQUENTIAL) {
+            auto first = comp_elem->children[0];
+            double key = start_time + (first ? (std::min)(0, first->start_offset_ms) : 0);
+            push(FrameKind::SEQ_STEP, key, start_time, comp_elem, effects, 0, 0, frame.loop_period_ms, frame.loop_count);
+        } else if (comp_elem->type == CompositeType::PARALLEL) {
+            for (auto child : comp_elem->children) {
+                if (child) push(FrameKind::ELEMENT, start_time + child->start_offset_ms, start_time, child, effects,
+                                0, 0, frame.loop_period_ms, frame.loop_count);
+            }
+        } else if (comp_elem->type == CompositeType::AUTO_LOOP) {
+            auto leader = comp_elem->children[0];
+            if (!leader) return;
+            double leader_dur = leader->get_duration_ms();
+            push(FrameKind::ELEMENT, start_time + leader->start_offset_ms, start_time, leader, effects);
+            for (size_t i = 1; i < comp_elem->children.size(); ++i) {
+                auto follower = comp_elem->children[i];
+                if (!follower) continue;
+                double follower_dur = follower->get_duration_ms();
+                if (follower_dur <= 0) continue;
+
+                if (contains_auto_loop(follower)) {
+                    // A loop inside a follower can't be expressed as a single re-trigger period,
+                    // so fall back to placing each iteration separately.
+                    push(FrameKind::LOOP_STEP, start_time, start_time, comp_elem, effects, i, 0);
+                    continue;
+                }
+
+                int iterations = loop_iterations(leader_dur, follower_dur);
+                if (iterations == 0) continue;
+                // A voice re-triggers only once its previous pass has rung out: when release tails
+                // outlast the follower, successive iterations take turns between that many voices
+                int voices = static_cast<int>(std::ceil(longest_pass_ms(follower) / follower_dur));
+                voices = (std::max)(1, (std::min)(voices, iterations));
+                for (int v = 0; v < voices; ++v) {
+                    double t = start_time + v * follower_dur;
+                    push(FrameKind::ELEMENT, t + follower->start_offset_ms, t, follower, effects,
+                         0, 0, follower_dur * voices, (iterations - v + voices - 1) / voices);
+                }
+            }
+        }
+    }
+}
+
+double SongScheduler::compute_end_ms(std::shared_ptr<SongElement> root) {
+    return element_end_ms(root, 0.0);
+}
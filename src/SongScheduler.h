@@ -0,0 +1,70 @@
+#ifndef SONG_SCHEDULER_H
+#define SONG_SCHEDULER_H
+
+#include "SongElement.h"
+#include <vector>
+#include <memory>
+#include <queue>
+
+// A single instrument track placed on the timeline by the scheduler.
+struct ScheduledEvent {
+    std::shared_ptr<InstrumentElement> element;
+    double start_ms = 0;
+    // Effects inherited from enclosing composite blocks (applied after the instrument's own).
+    std::shared_ptr<const std::vector<Effect>> parent_effects;
+    // Auto-loop followers are emitted once and re-triggered every loop_period_ms, loop_count times
+    double loop_period_ms = 0;
+    int loop_count = 1;
+};
+
+// Lazy, incremental flattener for the SongElement tree.
+// Instead of expanding the whole song up front, it keeps a queue of pending tree
+// positions ordered by start time and only expands as far as the requested horizon.
+class SongScheduler {
+public:
+    void reset(std::shared_ptr<SongElement> root);
+
+    // Append every event that starts before horizon_ms to 'out', in start order.
+    void advance(double horizon_ms, std::vector<ScheduledEvent>& out);
+    bool is_exhausted() const { return m_pending.empty(); }
+
+    // End time of the song including release tails, computed without expanding loops.
+    static double compute_end_ms(std::shared_ptr<SongElement> root);
+
+private:
+    enum class FrameKind {
+        ELEMENT,   // Place 'element' at time_ms
+        SEQ_STEP,  // Place child 'index' of a sequential block, then schedule the next one
+        LOOP_STEP  // Place one iteration of follower 'index' of an auto loop (nested loops only)
+    };
+
+    struct Frame {
+        FrameKind kind;
+        double key_ms;       // Earliest start this frame can produce (queue ordering)
+        double time_ms;      // Base time of the frame
+        int iteration;       // LOOP_STEP: which iteration of the follower to place
+        size_t index;
+        double loop_period_ms; // Repetition inherited from an enclosing auto loop
+        int loop_count;
+        unsigned long order; // Tie breaker so equal keys expand in tree order
+        std::shared_ptr<SongElement> element;
+        std::shared_ptr<const std::vector<Effect>> effects;
+    };
+
+    struct FrameLater {
+        bool operator()(const Frame& a, const Frame& b) const {
+            if (a.key_ms != b.key_ms) return a.key_ms > b.key_ms;
+            return a.order > b.order;
+        }
+    };
+
+    std::priority_queue<Frame, std::vector<Frame>, FrameLater> m_pending;
+    unsigned long m_next_order = 0;
+
+    void push(FrameKind kind, double key_ms, double time_ms, std::shared_ptr<SongElement> element,
+              std::shared_ptr<const std::vector<Effect>> effects, size_t index = 0, int iteration = 0,
+              double loop_period_ms = 0, int loop_count = 1);
+    void expand(const Frame& frame, std::vector<ScheduledEvent>& out);
+};
+
+#endif // SONG_SCHEDULER_H
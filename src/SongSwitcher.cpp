@@ -0,0 +1,137 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#include "SongSwitcher.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const double PI = 3.14159265358979323846;
+}
+
+SongSwitcher::SongSwitcher(std::function<void()> standby_changed) : m_standby_changed(std::move(standby_changed)) {}
+
+uint64_t SongSwitcher::begin_request() {
+    m_switch_pending.store(true, std::memory_order_release);
+    return ++m_requested_generation;
+}
+
+void SongSwitcher::cancel() {
+    m_switch_pending.store(false, std::memory_order_release);
+    if (m_fading) end_fade();
+}
+
+bool SongSwitcher::can_load(uint64_t generation) const {
+    Standby state = m_standby_state.load(std::memory_order_relaxed);
+    return generation != m_loaded_generation && (state == Standby::IDLE || state == Standby::READY);
+}
+
+bool SongSwitcher::load(Request request) {
+    Standby expected = Standby::IDLE;
+    if (!m_standby_state.compare_exchange_strong(expected, Standby::LOADING, std::memory_order_acquire)) {
+        expected = Standby::READY;
+        if (!m_standby_state.compare_exchange_strong(expected, Standby::LOADING, std::memory_order_acquire)) return false;
+    }
+    m_loaded_generation = request.generation;
+
+    // The expensive part: scheduling, patches and the render cache, away from the UI and render threads
+    m_standby->load(request.song, request.rate);
+    if (request.start_ms > 0) m_standby->seek(request.start_ms);
+    m_standby_request = std::move(request);
+    m_standby_state.store(Standby::READY, std::memory_order_release);
+    return true;
+}
+
+SongSwitcher::SwitchResult SongSwitcher::try_switch(uint64_t frame, int crossfade_frames) {
+    Standby ready = Standby::READY;
+    if (!m_standby_state.compare_exchange_strong(ready, Standby::SWAPPING, std::memory_order_acquire)) return SwitchResult::NONE;
+    if (m_standby_request.generation != m_requested_generation) {
+        // Asked for again meanwhile: let the loader replace this song
+        m_standby_state.store(Standby::READY, std::memory_order_release);
+        if (m_standby_changed) m_standby_changed();
+        return SwitchResult::SUPERSEDED;
+    }
+
+    AudioRenderer* previous = m_playing.load(std::memory_order_relaxed);
+    m_playing.store(m_standby, std::memory_order_release);
+    m_standby = previous;
+    Marker marker{ frame, m_standby_request.start_ms, m_standby_request.is_preview };
+    m_markers.write(&marker, 1);
+    m_switch_pending.store(false, std::memory_order_release);
+
+    if (crossfade_frames > 0) {
+        m_fading = previous;
+        m_fade_frames = crossfade_frames;
+        m_fade_position = 0;
+        m_standby_state.store(Standby::FADING, std::memory_order_release);
+    } else {
+        standby_free();
+    }
+    return SwitchResult::SWITCHED;
+}
+
+void SongSwitcher::render_block(float* output, int frame_count, double buffer_fill) {
+    AudioRenderer* playing = m_playing.load(std::memory_order_relaxed);
+    playing->set_buffer_fill(buffer_fill);
+    playing->render_block(output, frame_count);
+    if (!m_fading) return;
+
+    m_fading->set_buffer_fill(buffer_fill);
+    m_fade_block.resize(static_cast<size_t>(frame_count) * 2);
+    m_fading->render_block(m_fade_block.data(), frame_count);
+    int frames = (std::min)(frame_count, m_fade_frames - m_fade_position);
+    for (int f = 0; f < frames; ++f) {
+        float fade_in, fade_out;
+        crossfade_gains(m_fade_position + f, m_fade_frames, fade_in, fade_out);
+        output[f * 2] = output[f * 2] * fade_in + m_fade_block[f * 2] * fade_out;
+        output[f * 2 + 1] = output[f * 2 + 1] * fade_in + m_fade_block[f * 2 + 1] * fade_out;
+    }
+    m_fade_position += frames;
+    if (m_fade_position >= m_fade_frames) end_fade();
+}
+
+void SongSwitcher::end_fade() {
+    if (!m_fading) return;
+    m_fading = nullptr;
+    standby_free();
+}
+
+// Equal power, as the two songs are unrelated
+void SongSwitcher::crossfade_gains(int position, int length, float& fade_in, float& fade_out) {
+    double t = (position + 0.5) / length * (PI / 2.0);
+    fade_in = static_cast<float>(std::sin(t));
+    fade_out = static_cast<float>(std::cos(t));
+}
+
+void SongSwitcher::standby_free() {
+    m_standby_state.store(Standby::IDLE, std::memory_order_release);
+    if (m_standby_changed) m_standby_changed();
+}
+
+size_t SongSwitcher::take_switch(uint64_t frames_read, size_t frames, Marker& started) {
+    if (!m_has_next_marker) m_has_next_marker = m_markers.read(&m_next_marker, 1) == 1;
+    if (!m_has_next_marker) return frames;
+    if (m_next_marker.frame <= frames_read) {
+        started = m_next_marker;
+        m_has_next_marker = false;
+        return 0;
+    }
+    return (std::min)(frames, static_cast<size_t>(m_next_marker.frame - frames_read));
+}
+
+bool SongSwitcher::drain_switches(Marker& last) {
+    bool any = m_has_next_marker;
+    if (m_has_next_marker) last = m_next_marker;
+    m_has_next_marker = false;
+    Marker marker;
+    while (m_markers.read(&marker, 1)) {
+        last = marker;
+        any = true;
+    }
+    return any;
+}
+
+void SongSwitcher::clear_switches() {
+    m_markers.clear();
+    m_has_next_marker = false;
+}
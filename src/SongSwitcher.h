@@ -0,0 +1,109 @@
+#ifndef SONG_SWITCHER_H
+#define SONG_SWITCHER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "Song.h"
+#include "AudioRenderer.h"
+#include "SpscRing.h"
+
+// Hands playback over from one song to the next without a gap. Two renderers: one plays while the
+// loader thread loads the next song into the other. The render thread swaps them at a frame of the
+// output and queues a marker for that frame, so the consumer (the audio callback) switches the
+// playhead on the exact frame the new song starts. If the old song is still sounding, both play
+// for the crossfade. Requests carry a generation, and only the newest one is ever swapped in.
+// Threads: request() from the UI, load() from the loader, try_switch() and render_block() from
+// the render thread, take_switch() and drain_switches() from the consumer.
+class SongSwitcher {
+public:
+    struct Request {
+        Song song;
+        float rate = 44100.0f;
+        double start_ms = 0.0;
+        bool is_preview = false;
+        uint64_t generation = 0; // From begin_request()
+    };
+
+    // Where in the output a song starts
+    struct Marker {
+        uint64_t frame = 0;
+        double start_ms = 0.0;
+        bool is_preview = false;
+    };
+
+    enum class SwitchResult {
+        NONE,       // Nothing ready
+        SUPERSEDED, // The standby song is out of date; the loader can replace it
+        SWITCHED
+    };
+
+    // 'standby_changed' is called whenever the loader may have work: the standby renderer became
+    // free, or holds a song that was superseded
+    explicit SongSwitcher(std::function<void()> standby_changed = {});
+
+    std::array<AudioRenderer, 2>& renderers() { return m_renderers; }
+    // The playing renderer (any thread)
+    AudioRenderer* playing() const { return m_playing.load(std::memory_order_acquire); }
+
+    // UI: a new song was asked for. Returns its generation; any older one is dropped.
+    uint64_t begin_request();
+    // A song was asked for and hasn't taken over yet
+    bool is_switch_pending() const { return m_switch_pending.load(std::memory_order_acquire); }
+    // Forget the pending song (playback stopped); the render thread must be idle
+    void cancel();
+
+    // Loader: whether the standby renderer is free for a request of 'generation' not loaded yet
+    bool can_load(uint64_t generation) const;
+    // Loader: load and seek the song into the standby renderer. False if it wasn't free.
+    bool load(Request request);
+
+    // Render thread: swap in the standby song if it is the newest. It starts at output 'frame'; the
+    // previous song fades out over 'crossfade_frames' (0: a cut).
+    SwitchResult try_switch(uint64_t frame, int crossfade_frames);
+    // Render thread: the next block of the playing song, crossfaded with the previous one while it
+    // fades. 'buffer_fill' is passed on to the renderers (see AudioRenderer::set_buffer_fill).
+    void render_block(float* output, int frame_count, double buffer_fill = -1.0);
+    bool is_fading() const { return m_fading != nullptr; }
+    // Render thread (or while it is idle): drop the rest of the crossfade
+    void end_fade();
+    // Equal-power gains of the incoming and outgoing song at 'position' frames into a fade of 'length'
+    static void crossfade_gains(int position, int length, float& fade_in, float& fade_out);
+
+    // Consumer: frames of the next 'frames' still to play before a song starts, given the output
+    // frames read so far. 0 when one starts right at 'frames_read': its marker is returned in 'started'.
+    size_t take_switch(uint64_t frames_read, size_t frames, Marker& started);
+    // Consumer: skip every queued switch (the audio was dropped). False if there was none, otherwise
+    // the newest one is returned in 'last'.
+    bool drain_switches(Marker& last);
+    // Forget queued switches; neither thread may be using them
+    void clear_switches();
+
+private:
+    std::array<AudioRenderer, 2> m_renderers;
+    std::atomic<AudioRenderer*> m_playing{ &m_renderers[0] };
+    AudioRenderer* m_standby = &m_renderers[1];
+    AudioRenderer* m_fading = nullptr; // The previous song while it crossfades into m_playing
+    int m_fade_frames = 0;
+    int m_fade_position = 0;
+    std::vector<float> m_fade_block;
+    std::function<void()> m_standby_changed;
+
+    // Who may use m_standby: the loader (IDLE, LOADING) or the render thread (SWAPPING, FADING)
+    enum class Standby { IDLE, LOADING, READY, SWAPPING, FADING };
+    std::atomic<Standby> m_standby_state{ Standby::IDLE };
+    Request m_standby_request; // What m_standby holds once READY
+    uint64_t m_loaded_generation = 0; // Loader only
+    std::atomic<uint64_t> m_requested_generation{ 0 };
+    std::atomic<bool> m_switch_pending{ false };
+
+    SpscRing<Marker> m_markers{ 16 };
+    Marker m_next_marker; // Consumer only
+    bool m_has_next_marker = false;
+
+    void standby_free();
+};
+
+#endif // SONG_SWITCHER_H
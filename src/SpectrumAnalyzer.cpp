@@ -0,0 +1,108 @@
+#ifdef _WIN32
+    #define NOMINMAX
+#endif
+#include "SpectrumAnalyzer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    const double PI = 3.14159265358979323846;
+}
+
+void Spectrum::to_log_bands(float* bands, int band_count, float min_hz, float max_hz) const {
+    int bin_count = static_cast<int>(magnitudes.size());
+    if (band_count <= 0) return;
+    if (bin_count < 2 || bin_hz <= 0.0f || min_hz <= 0.0f || max_hz <= min_hz) {
+        std::fill(bands, bands + band_count, 0.0f);
+        return;
+    }
+    double ratio = std::log(static_cast<double>(max_hz) / min_hz) / band_count;
+    for (int b = 0; b < band_count; ++b) {
+        double low = min_hz * std::exp(ratio * b) / bin_hz;
+        double high = min_hz * std::exp(ratio * (b + 1)) / bin_hz;
+        if (low >= bin_count - 1) {
+            bands[b] = 0.0f; // Entirely above Nyquist: nothing there to show
+            continue;
+        }
+        int first = static_cast<int>(std::ceil(low));
+        int last = (std::min)(static_cast<int>(std::floor(high)), bin_count - 1);
+        if (first <= last) {
+            bands[b] = *std::max_element(magnitudes.begin() + first, magnitudes.begin() + last + 1);
+        } else {
+            // No bin inside: interpolate at the band's centre
+            double centre = (std::min)(std::sqrt(low * high), static_cast<double>(bin_count - 1));
+            int k = static_cast<int>(centre);
+            float t = static_cast<float>(centre - k);
+            bands[b] = k + 1 < bin_count ? magnitudes[k] + (magnitudes[k + 1] - magnitudes[k]) * t : magnitudes[k];
+        }
+    }
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer() {
+    configure(DEFAULT_SIZE, DEFAULT_OVERLAP, 44100.0f);
+}
+
+void SpectrumAnalyzer::configure(int size, float overlap, float sample_rate) {
+    int rounded = 4;
+    while (rounded < size) rounded <<= 1;
+    overlap = (std::max)(0.0f, (std::min)(0.95f, overlap));
+    m_hop = (std::max)(1, static_cast<int>(std::lround(rounded * (1.0f - overlap))));
+    m_sample_rate = sample_rate;
+
+    if (rounded != m_size) {
+        m_size = rounded;
+        m_plan = std::make_unique<RealFftPlan>(m_size);
+        // Periodic Hann, so overlapping frames sum to a constant
+        m_window.resize(m_size);
+        double sum = 0;
+        for (int i = 0; i < m_size; ++i) {
+            m_window[i] = static_cast<float>(0.5 * (1.0 - std::cos(2.0 * PI * i / m_size)));
+            sum += m_window[i];
+        }
+        m_window_gain = static_cast<float>(2.0 / sum);
+        m_history.assign(m_size, 0.0f);
+        m_frame.resize(m_size);
+        m_bins.resize(m_size / 2 + 1);
+        m_spectrum.magnitudes.assign(m_size / 2 + 1, 0.0f);
+    }
+    m_spectrum.bin_hz = m_sample_rate / m_size;
+    m_filled = 0;
+    m_since_frame = 0;
+}
+
+int SpectrumAnalyzer::push(const float* samples, int count) {
+    int frames = 0;
+    while (count > 0) {
+        // Take samples up to the next frame boundary, shifting the history along
+        int take = (std::min)(count, m_hop - m_since_frame);
+        if (take >= m_size) {
+            std::memcpy(m_history.data(), samples + take - m_size, m_size * sizeof(float));
+        } else {
+            std::memmove(m_history.data(), m_history.data() + take, (m_size - take) * sizeof(float));
+            std::memcpy(m_history.data() + m_size - take, samples, take * sizeof(float));
+        }
+        m_filled = (std::min)(m_size, m_filled + take);
+        m_since_frame += take;
+        samples += take;
+        count -= take;
+
+        if (m_since_frame >= m_hop && m_filled == m_size) {
+            analyze();
+            frames++;
+        }
+        if (m_since_frame >= m_hop) m_since_frame = 0;
+    }
+    return frames;
+}
+
+void SpectrumAnalyzer::analyze() {
+    for (int i = 0; i < m_size; ++i) m_frame[i] = m_history[i] * m_window[i];
+    m_plan->forward(m_frame.data(), m_bins.data());
+    for (size_t k = 0; k < m_bins.size(); ++k) {
+        float re = m_bins[k].real(), im = m_bins[k].imag();
+        m_spectrum.magnitudes[k] = std::sqrt(re * re + im * im) * m_window_gain;
+    }
+    m_spectrum.frame++;
+    m_published.publish(m_spectrum);
+}
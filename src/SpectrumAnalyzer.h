@@ -0,0 +1,63 @@
+#ifndef SPECTRUM_ANALYZER_H
+#define SPECTRUM_ANALYZER_H
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Fft.h"
+#include "TripleBuffer.h"
+
+// Magnitude spectrum of one analysis frame
+struct Spectrum {
+    std::vector<float> magnitudes; // Peak amplitude per bin, DC to Nyquist: a full-scale sine reads 1.0
+    float bin_hz = 0.0f;
+    uint64_t frame = 0; // Counts analyzed frames, so readers can tell a new spectrum from the last one
+
+    // The loudest bin of each of 'band_count' bands spaced evenly in log frequency between 'min_hz'
+    // and 'max_hz', so a tone reads the same in a wide band as in a narrow one. Bands narrower than
+    // a bin take the interpolated magnitude there; bands above Nyquist read 0.
+    void to_log_bands(float* bands, int band_count, float min_hz = 20.0f, float max_hz = 20000.0f) const;
+};
+
+// Windowed real FFT over a sliding frame of a mono signal. The plan and the window are built once
+// per configure(); push() analyzes a new frame every hop and publishes it without locks, so one
+// thread can feed the analyzer (never the audio callback: a frame costs an FFT) while another reads.
+class SpectrumAnalyzer {
+public:
+    static constexpr int DEFAULT_SIZE = 2048;
+    static constexpr float DEFAULT_OVERLAP = 0.5f;
+
+    SpectrumAnalyzer();
+
+    // 'size' is rounded up to a power of two; 'overlap' is the share of each frame the next one
+    // repeats (0 to 0.95). Drops the pending samples. Call from the feeding thread.
+    void configure(int size, float overlap, float sample_rate);
+    int get_size() const { return m_size; }
+    int get_hop() const { return m_hop; }
+
+    // Appends samples; returns the number of frames analyzed and published
+    int push(const float* samples, int count);
+
+    // The newest published spectrum. Call from one reader thread.
+    const Spectrum& read() { return m_published.read(); }
+
+private:
+    int m_size = 0;
+    int m_hop = 0;
+    float m_sample_rate = 44100.0f;
+    std::unique_ptr<RealFftPlan> m_plan;
+    std::vector<float> m_window;
+    float m_window_gain = 1.0f; // Scales bins to peak amplitude
+    std::vector<float> m_history; // The last m_size samples, oldest first
+    int m_filled = 0;             // Valid samples in m_history
+    int m_since_frame = 0;        // Samples pushed since the last frame
+    std::vector<float> m_frame;
+    std::vector<std::complex<float>> m_bins;
+    Spectrum m_spectrum;
+    TripleBuffer<Spectrum> m_published;
+
+    void analyze();
+};
+
+#endif // SPECTRUM_ANALYZER_H
@@ -0,0 +1,71 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Lock-free ring buffer for one producer thread and one consumer thread. Each side owns one index
+// and only reads the other; the release/acquire pair on the indices publishes the items. Neither
+// side ever blocks or allocates, so the consumer can be an audio callback.
+template <typename T>
+class SpscRing {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity = 0) { resize(capacity); }
+
+    // Only while neither thread is using the ring
+    void resize(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        m_items.assign(size, T());
+        m_mask = size - 1;
+        clear();
+    }
+    void clear() {
+        m_write.store(0, std::memory_order_relaxed);
+        m_read.store(0, std::memory_order_relaxed);
+    }
+
+    size_t get_capacity() const { return m_items.size(); }
+    // Either side may call these; the answer may be stale by the time it is used
+    size_t get_read_available() const {
+        return m_write.load(std::memory_order_acquire) - m_read.load(std::memory_order_acquire);
+    }
+    size_t get_write_available() const { return get_capacity() - get_read_available(); }
+
+    // Producer: appends up to 'count' items, returns how many fit
+    size_t write(const T* items, size_t count) {
+        size_t write = m_write.load(std::memory_order_relaxed);
+        size_t read = m_read.load(std::memory_order_acquire);
+        count = (std::min)(count, get_capacity() - (write - read));
+        for (size_t i = 0; i < count; ++i) m_items[(write + i) & m_mask] = items[i];
+        m_write.store(write + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: takes up to 'count' items, returns how many there were
+    size_t read(T* items, size_t count) {
+        size_t read = m_read.load(std::memory_order_relaxed);
+        size_t write = m_write.load(std::memory_order_acquire);
+        count = (std::min)(count, write - read);
+        for (size_t i = 0; i < count; ++i) items[i] = m_items[(read + i) & m_mask];
+        m_read.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: drops everything written so far
+    void discard() {
+        m_read.store(m_write.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    std::vector<T> m_items;
+    size_t m_mask = 0;
+    // Free-running counts; on separate cache lines so the two threads don't share one
+    alignas(64) std::atomic<size_t> m_write{ 0 };
+    alignas(64) std::atomic<size_t> m_read{ 0 };
+};
+
+#endif // SPSC_RING_H
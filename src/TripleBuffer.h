@@ -0,0 +1,36 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Hands the latest value of T from one writer thread to one reader thread without locks. The writer
+// fills its own slot and swaps it with the shared middle one; the reader swaps the middle slot for
+// its own when it holds something newer. Neither side waits, and the reader always gets a whole value.
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer
+    void publish(const T& value) {
+        m_slots[m_back] = value;
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader: the newest published value (or the previous one again if nothing new arrived)
+    const T& read() {
+        if (m_middle.load(std::memory_order_relaxed) & FRESH) {
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        }
+        return m_slots[m_front];
+    }
+
+private:
+    static constexpr int INDEX = 3;
+    static constexpr int FRESH = 4;
+
+    T m_slots[3] = {};
+    int m_back = 0;  // Writer's slot
+    int m_front = 2; // Reader's slot
+    std::atomic<int> m_middle{ 1 };
+};
+
+#endif // TRIPLE_BUFFER_H
@@ -4,6 +4,8 @@
 #endif
 #include "Voice.h"
 #include "AudioUtils.h"
+#include "FilterBatch.h"
+#include "FastMath.h"
 #include <cmath>
 #include <algorithm>
 #include <cstring>
@@ -16,111 +18,344 @@
 #include "tsf.h"
 #include <iostream>
 
-void BiquadState::update(FilterType type, float cutoff, float q, float sample_rate) {
-    if (type == FilterType::NONE) return;
-    if (cutoff > sample_rate * 0.49f) cutoff = sample_rate * 0.49f;
-    if (cutoff < 10.0f) cutoff = 10.0f;
-    if (q < 0.1f) q = 0.1f;
-
-    double w0 = 2.0 * M_PI * cutoff / sample_rate;
-    double alpha = sin(w0) / (2.0 * q);
-    double cosw0 = cos(w0);
-
-    if (type == FilterType::LOWPASS) {
-        double norm = 1.0 / (1.0 + alpha);
-        a0 = ((1.0 - cosw0) / 2.0) * norm;
-        a1 = (1.0 - cosw0) * norm;
-        a2 = ((1.0 - cosw0) / 2.0) * norm;
-        b1 = -2.0 * cosw0 * norm;
-        b2 = (1.0 - alpha) * norm;
-    } else if (type == FilterType::HIGHPASS) {
-        double norm = 1.0 / (1.0 + alpha);
-        a0 = ((1.0 + cosw0) / 2.0) * norm;
-        a1 = -(1.0 + cosw0) * norm;
-        a2 = ((1.0 + cosw0) / 2.0) * norm;
-        b1 = -2.0 * cosw0 * norm;
-        b2 = (1.0 - alpha) * norm;
-    } else if (type == FilterType::BANDPASS) {
-        double norm = 1.0 / (1.0 + alpha);
-        a0 = alpha * norm;
-        a1 = 0;
-        a2 = -alpha * norm;
-        b1 = -2.0 * cosw0 * norm;
-        b2 = (1.0 - alpha) * norm;
+namespace {
+    // Effect tails are followed until they have decayed by 60dB, but never further than this
+    const double MAX_PREROLL_SECONDS = 10.0;
+    const double TAIL_SILENCE = 0.001;
+    // Long enough for a filter's start-up transient to decay below the tail silence
+    const double FILTER_SETTLE_SECONDS = 0.02;
+    const int PREROLL_BLOCK = 512;
+
+    // Per-sample oscillator phase increment, as generate_sample_with_phase() advances it
+    double note_phase_step(const Note& note, const Synth& synth, float sample_rate) {
+        float target_freq = FastMath::midi_to_hz(note.pitch, FastMath::get_precision());
+        return 2.0 * M_PI * (target_freq * synth.frequency) / sample_rate;
     }
 }
 
-float BiquadState::process(float in) {
-    float out = in * a0 + z1;
-    z1 = in * a1 + z2 - b1 * out;
-    z2 = in * a2 - b2 * out;
-    return out;
-}
-
-Voice::Voice(const Instrument& inst, double start_samples, float sample_rate) 
-    : instrument(inst), start_time_samples(start_samples) {
+Voice::Voice(std::shared_ptr<const Patch> patch_in, std::shared_ptr<const InstrumentElement> source_in, VoicePool& pool_in,
+             const ImpulseResponseMap& impulse_responses, double start_samples, float sample_rate, double loop_period, int loops)
+    : patch(std::move(patch_in)), source(std::move(source_in)), start_time_samples(start_samples),
+      pool(&pool_in), loop_period_samples(loop_period), loop_count(loops) {
+    slot = pool->acquire();
+    const Instrument& instrument = patch->instrument;
+    kernel = select_kernel(instrument);
     
-    soundfont_instance = nullptr;
-    
-    if (instrument.sequence.notes.empty()) {
+    if (notes().empty()) {
         total_duration_samples = 0;
         is_finished = true;
         return;
     }
 
     double total_ms = 0;
-    for (const auto& note : instrument.sequence.notes) {
+    for (const auto& note : notes()) {
         total_ms += note.duration;
     }
     // Add release time to total duration to allow for tail
     total_ms += instrument.synth.envelope.release * 1000.0f;
-    total_duration_samples = (total_ms / 1000.0) * sample_rate;
+    pass_duration_samples = (total_ms / 1000.0) * sample_rate;
+    total_duration_samples = pass_duration_samples;
+    if (loop_count > 1 && loop_period_samples > 0) {
+        total_duration_samples += (loop_count - 1) * loop_period_samples;
+    } else {
+        loop_count = 1;
+    }
     
     if (total_duration_samples <= 0) is_finished = true;
 
-    for (const auto& fx : instrument.effects) {
+    effects = EffectChain(instrument.effects, instrument.gain, sample_rate, pass_duration_samples, pool->get_delay_lines(), impulse_responses);
+    latency_frames = effects.get_latency();
+    latency_primed = latency_frames == 0;
+}
+
+Voice::Voice(std::shared_ptr<const CachedRender> cached, double start_samples)
+    : start_time_samples(start_samples), cache_playback(std::move(cached)) {
+    total_duration_samples = static_cast<double>(cache_playback->pcm.size() / 2);
+    pass_duration_samples = total_duration_samples;
+    if (cache_playback->complete && total_duration_samples <= 0) is_finished = true;
+}
+
+Voice::~Voice() {
+    abandon_recording();
+    if (soundfont_instance) {
+        tsf_close(soundfont_instance);
+    }
+    if (pool) pool->release(slot);
+}
+
+void Voice::render_cached(float* buffer, int frame_count) {
+    const auto& pcm = cache_playback->pcm;
+    size_t available = (pcm.size() > cache_playback_pos) ? (pcm.size() - cache_playback_pos) / 2 : 0;
+    size_t frames = (std::min)(available, static_cast<size_t>(frame_count));
+    const float* src = pcm.data() + cache_playback_pos;
+    float peak = 0.0f;
+    if (is_fading()) {
+        float faded[2];
+        for (size_t f = 0; f < frames; ++f) {
+            faded[0] = src[f * 2];
+            faded[1] = src[f * 2 + 1];
+            apply_fade(faded, 1);
+            buffer[f * 2] += faded[0];
+            buffer[f * 2 + 1] += faded[1];
+            peak = (std::max)(peak, (std::max)(std::abs(faded[0]), std::abs(faded[1])));
+        }
+    } else {
+        for (size_t i = 0; i < frames * 2; ++i) {
+            buffer[i] += src[i];
+            peak = (std::max)(peak, std::abs(src[i]));
+        }
+    }
+    last_peak = peak;
+    // Always advance by the full block so replay stays in time with the song
+    cache_playback_pos += static_cast<size_t>(frame_count) * 2;
+    if (cache_playback->complete && cache_playback_pos >= pcm.size()) is_finished = true;
+    if (is_fading() && fade_frames_left == 0) is_finished = true;
+}
+
+void Voice::fade_out(int frames) {
+    frames = (std::max)(1, frames);
+    if (is_fading() && fade_frames_left <= frames) return;
+    // Continue from the gain an earlier fade has reached
+    float gain = is_fading() ? static_cast<float>(fade_frames_left) / fade_frames_total : 1.0f;
+    fade_frames_left = frames;
+    fade_frames_total = (std::max)(frames, static_cast<int>(std::ceil(frames / gain)));
+    abandon_recording();
+}
+
+void Voice::abandon_recording() {
+    // Faded or cut-off samples must never be replayed as this content
+    if (cache_record && !cache_record->complete) {
+        cache_record->abandoned = true;
+        cache_record->degraded = true;
+    }
+    cache_record.reset();
+}
+
+void Voice::apply_fade(float* stereo, int frame_count) {
+    for (int f = 0; f < frame_count; ++f) {
+        float gain = static_cast<float>(fade_frames_left) / fade_frames_total;
+        if (fade_frames_left > 0) fade_frames_left--;
+        stereo[f * 2] *= gain;
+        stereo[f * 2 + 1] *= gain;
+    }
+}
+
+void Voice::retrigger(VoiceDspRef& state) {
+    state.loop_iteration++;
+    state.note_idx = 0;
+    state.samples_into_note = 0;
+    state.last_freq = -1.0f;
+    if (soundfont_instance) {
+        // Let the previous pass ring out through its release while the next one starts
+        tsf_channel_note_off_all(soundfont_instance, 0);
+        soundfont_retrigger = true;
+    }
+}
+
+double Voice::pass_position(double absolute_sample) const {
+    if (loop_count <= 1) return absolute_sample;
+    int pass = static_cast<int>(absolute_sample / loop_period_samples);
+    if (pass > loop_count - 1) pass = loop_count - 1;
+    if (pass < 0) pass = 0;
+    return absolute_sample - pass * loop_period_samples;
+}
+
+void Voice::build_note_offsets(float sample_rate) {
+    const auto& notes = this->notes();
+    const Instrument& instrument = patch->instrument;
+    note_offsets.clear();
+    note_offsets.reserve(notes.size() + 1);
+
+    double start = 0, phase_acc = 0, sounding = 0;
+    for (size_t i = 0; i < notes.size(); ++i) {
+        note_offsets.push_back({ start, phase_acc, sounding, i });
+        // The last note holds through the release tail
+        if (i == notes.size() - 1 && !notes[i].is_rest) break;
+
+        // render() moves on once samples_into_note reaches the duration, so every note lasts at least one sample
+        double note_duration_samples = (notes[i].duration / 1000.0f) * sample_rate;
+        double length = (std::max)(1.0, std::ceil(note_duration_samples));
+        if (!notes[i].is_rest) {
+            phase_acc += length * note_phase_step(notes[i], instrument.synth, sample_rate);
+            sounding += length;
+        }
+        start += length;
+    }
+    if (!notes.empty() && notes.back().is_rest) {
+        note_offsets.push_back({ start, phase_acc, sounding, notes.size() });
+    }
+}
+
+void Voice::jump_to(double offset_samples, float sample_rate) {
+    const auto& notes = this->notes();
+    const Instrument& instrument = patch->instrument;
+    if (note_offsets.empty()) build_note_offsets(sample_rate);
+
+    auto locate = [&](double pass_samples) -> const NoteOffset& {
+        auto it = std::upper_bound(note_offsets.begin(), note_offsets.end(), pass_samples,
+                                   [](double s, const NoteOffset& o) { return s < o.start_sample; });
+        return *(it - 1);
+    };
+    auto accumulate = [&](double pass_samples, double& phase_acc, double& sounding) {
+        const NoteOffset& at = locate(pass_samples);
+        const Note& note = notes[(std::min)(at.note_idx, notes.size() - 1)];
+        bool is_sounding = !(note.is_rest && at.note_idx < notes.size());
+        double into_note = is_sounding ? pass_samples - at.start_sample : 0.0;
+        phase_acc += at.phase + into_note * note_phase_step(note, instrument.synth, sample_rate);
+        sounding += at.sounding_samples + into_note;
+    };
+
+    // Passes begin on the first whole sample at or after each multiple of the loop period (see retrigger())
+    int pass = 0;
+    if (loop_count > 1) {
+        pass = (std::min)(static_cast<int>(offset_samples / loop_period_samples), loop_count - 1);
+        while (pass > 0 && std::ceil(pass * loop_period_samples) > offset_samples) pass--;
+    }
+
+    // Oscillators keep running across passes, so earlier passes contribute their full phase
+    double phase_acc = 0, sounding = 0;
+    for (int p = 0; p < pass; ++p) {
+        accumulate(std::ceil((p + 1) * loop_period_samples) - std::ceil(p * loop_period_samples), phase_acc, sounding);
+    }
+    double pass_samples = offset_samples - std::ceil(pass * loop_period_samples);
+    accumulate(pass_samples, phase_acc, sounding);
+
+    const NoteOffset& at = locate(pass_samples);
+    VoiceDspState state;
+    state.loop_iteration = pass;
+    state.note_idx = at.note_idx;
+    state.samples_into_note = pass_samples - at.start_sample;
+    if (at.note_idx > 0 && at.note_idx < notes.size() && !notes[at.note_idx - 1].is_rest) {
+        state.last_freq = FastMath::midi_to_hz(notes[at.note_idx - 1].pitch, FastMath::get_precision()) * instrument.synth.frequency;
+    }
+    state.phase = static_cast<float>(std::fmod(phase_acc, 2.0 * M_PI));
+    state.lfo_phase = static_cast<float>(std::fmod(sounding * 2.0 * M_PI * instrument.synth.lfo.frequency / sample_rate, 2.0 * M_PI));
+    state.samples_rendered = offset_samples;
+    pool->store(slot, state);
+}
+
+double Voice::effect_preroll_samples(float sample_rate) const {
+    double max_preroll = MAX_PREROLL_SECONDS * sample_rate;
+    // Convolution has no feedback: its tail is exactly the impulse response. The filters of an
+    // oversampled stage remember about as much as they delay.
+    double preroll = static_cast<double>(effects.get_impulse_length() + effects.get_latency());
+    for (const auto& fx : patch->instrument.effects) {
+        double period = 0, feedback = 0;
         if (fx.type == EffectType::DELAY) {
-            // Max delay of 2 seconds
-            int size = static_cast<int>(sample_rate * 2);
-            delay_buffers.push_back(std::vector<float>(size * 2, 0.0f));
-            delay_indices.push_back(0);
-            reverb_processors.push_back(nullptr);
+            period = (fx.param1 / 1000.0) * sample_rate;
+            feedback = std::abs(fx.param2);
         } else if (fx.type == EffectType::REVERB) {
-            reverb_processors.push_back(std::make_unique<ReverbProcessor>(sample_rate));
-            delay_buffers.push_back({});
-            delay_indices.push_back(0);
+            period = 1617.0 * sample_rate / 44100.0; // Longest comb line in ReverbProcessor
+            feedback = std::abs(fx.param1);
+        } else if (fx.type == EffectType::CHORUS || fx.type == EffectType::FLANGER) {
+            double base_ms = (fx.type == EffectType::FLANGER) ? EffectChain::FLANGER_BASE_MS : EffectChain::CHORUS_BASE_MS;
+            period = ((base_ms + (std::max)(0.0f, fx.param2)) / 1000.0) * sample_rate;
+            feedback = (fx.type == EffectType::FLANGER) ? (std::min)(std::abs(fx.param3), EffectChain::MAX_FLANGER_FEEDBACK) : 0.0;
         } else {
-            delay_buffers.push_back({});
-            delay_indices.push_back(0);
-            reverb_processors.push_back(nullptr);
+            continue; // Everything else is stateless or derived from the voice position
         }
+        if (feedback >= 1.0) return max_preroll;
+        double repeats = (feedback > 0.0) ? std::ceil(std::log(TAIL_SILENCE) / std::log(feedback)) : 1.0;
+        preroll += period * repeats;
     }
+    if (patch->instrument.synth.filter.type != FilterType::NONE) preroll = (std::max)(preroll, FILTER_SETTLE_SECONDS * sample_rate);
+    return (std::min)(preroll, max_preroll);
 }
 
-Voice::~Voice() {
-    if (soundfont_instance) {
-        tsf_close(soundfont_instance);
+double Voice::seek(double offset_samples, float sample_rate, std::map<std::string, tsf*>& soundfonts, double max_preroll_samples) {
+    offset_samples = std::floor((std::max)(0.0, offset_samples));
+    if (cache_playback) {
+        cache_playback_pos = static_cast<size_t>(offset_samples) * 2;
+        if (cache_playback->complete && cache_playback_pos >= cache_playback->pcm.size()) is_finished = true;
+        return 0.0;
     }
+    if (is_finished || offset_samples <= 0) return 0.0;
+    if (offset_samples >= total_duration_samples) {
+        is_finished = true;
+        return 0.0;
+    }
+
+    // The synthesis runs latency_frames ahead of the output; a pre-roll shorter than that leaves a gap
+    double preroll = std::floor((std::min)(get_seek_preroll(offset_samples, sample_rate), (std::max)(0.0, max_preroll_samples)));
+    double rendered = 0.0;
+    effects.reset();
+    latency_primed = true;
+    jump_to(offset_samples + latency_frames - preroll, sample_rate);
+
+    std::vector<float> scratch(PREROLL_BLOCK * 2);
+    while (rendered < preroll && !is_finished) {
+        int frames = static_cast<int>((std::min)(preroll - rendered, static_cast<double>(PREROLL_BLOCK)));
+        std::fill(scratch.begin(), scratch.end(), 0.0f);
+        render(scratch.data(), frames, sample_rate, soundfonts);
+        rendered += frames;
+    }
+    return rendered;
 }
 
-void Voice::render(float* buffer, int frame_count, float sample_rate, std::map<std::string, tsf*>& soundfonts) {
-    if (is_finished || instrument.sequence.notes.empty()) return;
+double Voice::get_seek_preroll(double offset_samples, float sample_rate) const {
+    if (cache_playback || is_finished || offset_samples <= 0) return 0.0;
+    return std::floor((std::min)(offset_samples, effect_preroll_samples(sample_rate))) + latency_frames;
+}
+
+void Voice::prime_latency(float sample_rate, std::map<std::string, tsf*>& soundfonts) {
+    latency_primed = true;
+    // What comes out is the effects' delay filling up; it isn't part of the recording either
+    std::shared_ptr<CachedRender> record = std::move(cache_record);
+    float scratch[PREROLL_BLOCK * 2];
+    for (int rendered = 0; rendered < latency_frames && !is_finished; rendered += PREROLL_BLOCK) {
+        int frames = (std::min)(latency_frames - rendered, PREROLL_BLOCK);
+        std::fill(scratch, scratch + frames * 2, 0.0f);
+        render(scratch, frames, sample_rate, soundfonts);
+    }
+    cache_record = std::move(record);
+}
 
-    const auto& notes = instrument.sequence.notes;
-    std::vector<float> local_buffer(frame_count * 2, 0.0f);
+template <InstrumentType TYPE, KernelFilter FILTER, LFOTarget LFO_TARGET, bool PORTAMENTO>
+void Voice::render_kernel(VoiceBlock& block, int frame_count, float sample_rate, VoiceDspRef& state,
+                          std::map<std::string, tsf*>& soundfonts) {
+    const Instrument& instrument = patch->instrument;
+    float* out = block.stereo.data();
+    const auto& notes = this->notes();
+    uint32_t& current_note_idx = state.note_idx;
+    double& samples_into_note = state.samples_into_note;
+    double& total_samples_rendered = state.samples_rendered;
+    float& last_freq = state.last_freq;
+    float& phase = state.phase;
+    float& lfo_phase = state.lfo_phase;
+    BiquadState& filter_state = state.filter;
+    const MathPrecision precision = block.precision;
+    const MathPrecision oscillator_precision = block.oscillator_precision;
+    const int filter_update_interval = block.filter_update_interval;
+
+    // Per-note constants, recomputed only when the note changes
+    size_t cached_note_idx = static_cast<size_t>(-1);
+    double note_duration_samples = 0;
+    float left_gain = 0, right_gain = 0, target_freq = 0, note_dur_secs = 0;
+
+    const double end_samples = total_duration_samples + latency_frames;
 
     for (int f = 0; f < frame_count; ++f) {
-        if (total_samples_rendered >= total_duration_samples) {
+        if (total_samples_rendered >= end_samples) {
             is_finished = true;
             break;
         }
 
+        if (state.loop_iteration + 1 < loop_count && total_samples_rendered >= (state.loop_iteration + 1) * loop_period_samples) {
+            retrigger(state);
+        }
+
         // Use last note if we are in the release tail
         size_t note_idx = current_note_idx;
         if (note_idx >= notes.size()) note_idx = notes.size() - 1;
 
         const auto& note = notes[note_idx];
-        double note_duration_samples = (note.duration / 1000.0f) * sample_rate;
+        if (note_idx != cached_note_idx) {
+            cached_note_idx = note_idx;
+            note_duration_samples = (note.duration / 1000.0f) * sample_rate;
+            FastMath::pan_gains(note.pan, left_gain, right_gain, precision);
+            target_freq = FastMath::midi_to_hz(note.pitch, precision);
+            note_dur_secs = note.duration / 1000.0f;
+        }
         
         if (note.is_rest && current_note_idx < notes.size()) {
             samples_into_note++;
@@ -135,18 +370,13 @@ void Voice::render(float* buffer, int frame_count, float sample_rate, std::map<s
 
         // --- PREPARE RENDER CONTEXT ---
         float mono_sample = 0.0f;
-        float left_gain, right_gain;
-        get_pan_gains(note.pan, left_gain, right_gain);
-
-        float target_freq = 440.0f * std::pow(2.0f, (note.pitch - 69.0f) / 12.0f);
         float time_in_note = (float)samples_into_note / sample_rate;
-        float note_dur_secs = note.duration / 1000.0f;
 
         // --- UNIVERSAL ENVELOPE ---
         const auto& env = instrument.synth.envelope;
         float envelope_val = 0.0f;
         
-        bool is_contiguous_legato = (instrument.portamento_time > 0 && current_note_idx > 0);
+        bool is_contiguous_legato = (PORTAMENTO && current_note_idx > 0);
 
         if (is_contiguous_legato) {
             // In legato mode (portamento active and not the first note),
@@ -182,7 +412,7 @@ void Voice::render(float* buffer, int frame_count, float sample_rate, std::map<s
         float glide_freq = target_freq * instrument.synth.frequency;
         float portamento_samples = (instrument.portamento_time / 1000.0f) * sample_rate;
 
-        if (instrument.portamento_time > 0) {
+        if constexpr (PORTAMENTO) {
             float modified_last = last_freq * instrument.synth.frequency;
             if (last_freq < 0) {
                 last_freq = target_freq;
@@ -195,16 +425,16 @@ void Voice::render(float* buffer, int frame_count, float sample_rate, std::map<s
         }
 
         float lfo_val = 0.0f;
-        if (instrument.synth.lfo.target != LFOTarget::NONE) {
-            lfo_val = generate_sample_with_phase(instrument.synth.lfo.waveform, instrument.synth.lfo.frequency, sample_rate, lfo_phase);
+        if constexpr (LFO_TARGET != LFOTarget::NONE) {
+            lfo_val = generate_sample_with_phase(instrument.synth.lfo.waveform, instrument.synth.lfo.frequency, sample_rate, lfo_phase, oscillator_precision);
             lfo_val *= instrument.synth.lfo.amount;
         }
-        if (instrument.synth.lfo.target == LFOTarget::PITCH) {
-            glide_freq *= std::pow(2.0f, lfo_val / 12.0f);
+        if constexpr (LFO_TARGET == LFOTarget::PITCH) {
+            glide_freq *= FastMath::exp2(lfo_val / 12.0f, precision);
         }
 
         // --- INSTRUMENT TYPE RENDERING ---
-        if (instrument.type == InstrumentType::SOUNDFONT) {
+        if constexpr (TYPE == InstrumentType::SOUNDFONT) {
             if (!soundfont_instance && soundfonts.count(instrument.soundfont_path)) {
                 soundfont_instance = tsf_copy(soundfonts[instrument.soundfont_path]);
                 tsf_set_output(soundfont_instance, TSF_STEREO_INTERLEAVED, sample_rate, 0);
@@ -212,11 +442,16 @@ void Voice::render(float* buffer, int frame_count, float sample_rate, std::map<s
                 tsf_channel_set_pitchrange(soundfont_instance, 0, 24.0f);
                 int preset = tsf_get_presetindex(soundfont_instance, instrument.bank_index, instrument.preset_index);
                 tsf_channel_set_presetindex(soundfont_instance, 0, (preset < 0 ? 0 : preset));
+                // A voice seeked into its release tail has nothing left to start
+                bool in_release = current_note_idx >= notes.size() - 1 && samples_into_note > note_duration_samples;
+                if (!in_release) tsf_channel_note_on(soundfont_instance, 0, note.pitch, note.velocity / 127.0f);
+            } else if (soundfont_instance && soundfont_retrigger) {
                 tsf_channel_note_on(soundfont_instance, 0, note.pitch, note.velocity / 127.0f);
             }
+            soundfont_retrigger = false;
 
             if (soundfont_instance) {
-                if (instrument.portamento_time > 0 || instrument.synth.lfo.target == LFOTarget::PITCH) {
+                if constexpr (PORTAMENTO || LFO_TARGET == LFOTarget::PITCH) {
                     float semitone_offset = 12.0f * std::log2(glide_freq / target_freq);
                     // MIDI Pitch Wheel is 14-bit (0..16383), 8192 is center.
                     // Range is now set to 24 semitones.
@@ -229,32 +464,42 @@ void Voice::render(float* buffer, int frame_count, float sample_rate, std::map<s
                 tsf_render_float(soundfont_instance, stereo, 1);
                 mono_sample = (stereo[0] + stereo[1]) * 0.5f;
             }
-        } else if (instrument.type == InstrumentType::SAMPLER) {
-            if (instrument.sampler) {
-                mono_sample = instrument.sampler->get_sample(time_in_note);
+        } else if constexpr (TYPE == InstrumentType::SAMPLER) {
+            if (sample) {
+                mono_sample = sample->get_sample(time_in_note);
                 mono_sample *= (note.velocity / 127.0f);
             }
         } else {
-            mono_sample = (note.velocity / 127.0f) * 0.5f * generate_sample_with_phase(instrument.synth.waveform, glide_freq, sample_rate, phase);
+            mono_sample = (note.velocity / 127.0f) * 0.5f * generate_sample_with_phase(instrument.synth.waveform, glide_freq, sample_rate, phase, oscillator_precision);
         }
 
         // --- UNIVERSAL POST-PROCESSING ---
         float amp_mod = 1.0f;
-        if (instrument.synth.lfo.target == LFOTarget::AMPLITUDE) {
+        if constexpr (LFO_TARGET == LFOTarget::AMPLITUDE) {
             amp_mod += lfo_val;
             if (amp_mod < 0) amp_mod = 0;
         }
         mono_sample *= envelope_val * amp_mod;
 
-        if (instrument.synth.filter.type != FilterType::NONE) {
+        if constexpr (FILTER == KernelFilter::INLINE) {
             float current_cutoff = instrument.synth.filter.cutoff;
-            if (instrument.synth.lfo.target == LFOTarget::FILTER_CUTOFF) current_cutoff += lfo_val; 
-            filter_state.update(instrument.synth.filter.type, current_cutoff, instrument.synth.filter.resonance, sample_rate);
+            if constexpr (LFO_TARGET == LFOTarget::FILTER_CUTOFF) current_cutoff += lfo_val;
+            if (f % filter_update_interval == 0) {
+                filter_state.update(instrument.synth.filter.type, current_cutoff, instrument.synth.filter.resonance, sample_rate);
+            }
             mono_sample = filter_state.process(mono_sample);
         }
 
-        local_buffer[f * 2] = mono_sample * left_gain;
-        local_buffer[f * 2 + 1] = mono_sample * right_gain;
+        if constexpr (FILTER == KernelFilter::DEFERRED) {
+            // Filtered and panned once the whole block is synthesized
+            block.mono[f] = mono_sample;
+            block.gate[f] = 1.0f;
+            out[f * 2] = left_gain;
+            out[f * 2 + 1] = right_gain;
+        } else {
+            out[f * 2] = mono_sample * left_gain;
+            out[f * 2 + 1] = mono_sample * right_gain;
+        }
 
         samples_into_note++;
         total_samples_rendered++;
@@ -264,101 +509,136 @@ void Voice::render(float* buffer, int frame_count, float sample_rate, std::map<s
             samples_into_note = 0;
             current_note_idx++;
             last_freq = glide_freq; 
-            if (soundfont_instance) {
+            if (TYPE == InstrumentType::SOUNDFONT && soundfont_instance) {
                 tsf_channel_note_off(soundfont_instance, 0, note.pitch);
                 tsf_channel_note_on(soundfont_instance, 0, notes[current_note_idx].pitch, notes[current_note_idx].velocity / 127.0f);
             }
         } else if (current_note_idx == notes.size() - 1 && samples_into_note == (int)note_duration_samples) {
-            if (soundfont_instance) tsf_channel_note_off(soundfont_instance, 0, note.pitch);
+            if (TYPE == InstrumentType::SOUNDFONT && soundfont_instance) tsf_channel_note_off(soundfont_instance, 0, note.pitch);
         }
     }
 
-    // Apply Gain
-    if (instrument.gain != 1.0f) {
-        for (float& s : local_buffer) s *= instrument.gain;
+}
+
+namespace {
+    template <InstrumentType TYPE, KernelFilter FILTER, LFOTarget LFO_TARGET>
+    Voice::RenderKernel pick_portamento(bool portamento) {
+        return portamento ? &Voice::render_kernel<TYPE, FILTER, LFO_TARGET, true>
+                          : &Voice::render_kernel<TYPE, FILTER, LFO_TARGET, false>;
     }
 
-    // Apply Effects
-    for (size_t fx_idx = 0; fx_idx < instrument.effects.size(); ++fx_idx) {
-        const auto& fx = instrument.effects[fx_idx];
-        if (fx.type == EffectType::DISTORTION) {
-            float drive = fx.param1;
-            for (float& s : local_buffer) s = std::tanh(s * drive);
-        }
-        else if (fx.type == EffectType::BITCRUSH) {
-            float steps = std::pow(2.0f, fx.param1);
-            for (float& s : local_buffer) s = std::round(s * steps) / steps;
-        }
-        else if (fx.type == EffectType::TREMOLO) {
-            float rate = fx.param1;
-            float depth = fx.param2;
-            for (int f = 0; f < frame_count; ++f) {
-                float mod = 1.0f - depth * (0.5f * (1.0f + std::sin(2.0f * M_PI * rate * (total_samples_rendered - frame_count + f) / sample_rate)));
-                local_buffer[f * 2] *= mod;
-                local_buffer[f * 2 + 1] *= mod;
-            }
-        }
-        else if (fx.type == EffectType::FADE_IN) {
-            float duration_samples = (fx.param1 / 1000.0f) * sample_rate;
-            for (int f = 0; f < frame_count; ++f) {
-                double absolute_sample = total_samples_rendered - frame_count + f;
-                if (absolute_sample < duration_samples) {
-                    float gain = static_cast<float>(absolute_sample / duration_samples);
-                    local_buffer[f * 2] *= gain;
-                    local_buffer[f * 2 + 1] *= gain;
-                }
-            }
-        }
-        else if (fx.type == EffectType::FADE_OUT) {
-            float duration_samples = (fx.param1 / 1000.0f) * sample_rate;
-            float start_fade_sample = static_cast<float>(total_duration_samples - duration_samples);
-            for (int f = 0; f < frame_count; ++f) {
-                double absolute_sample = total_samples_rendered - frame_count + f;
-                if (absolute_sample > start_fade_sample) {
-                    float gain = 1.0f - static_cast<float>((absolute_sample - start_fade_sample) / duration_samples);
-                    if (gain < 0) gain = 0;
-                    local_buffer[f * 2] *= gain;
-                    local_buffer[f * 2 + 1] *= gain;
-                }
-            }
+    template <InstrumentType TYPE, KernelFilter FILTER>
+    Voice::RenderKernel pick_lfo(LFOTarget target, bool portamento) {
+        switch (target) {
+            case LFOTarget::PITCH: return pick_portamento<TYPE, FILTER, LFOTarget::PITCH>(portamento);
+            case LFOTarget::AMPLITUDE: return pick_portamento<TYPE, FILTER, LFOTarget::AMPLITUDE>(portamento);
+            case LFOTarget::FILTER_CUTOFF: return pick_portamento<TYPE, FILTER, LFOTarget::FILTER_CUTOFF>(portamento);
+            default: return pick_portamento<TYPE, FILTER, LFOTarget::NONE>(portamento);
         }
-        else if (fx.type == EffectType::DELAY) {
-            float time_ms = fx.param1;
-            float feedback = fx.param2;
-            int delay_samples = static_cast<int>((time_ms / 1000.0f) * sample_rate);
-            auto& delay_buf = delay_buffers[fx_idx];
-            int& delay_idx = delay_indices[fx_idx];
-
-            for (int f = 0; f < frame_count; ++f) {
-                int read_idx = (delay_idx - delay_samples + (delay_buf.size() / 2)) % (delay_buf.size() / 2);
-                local_buffer[f * 2] += delay_buf[read_idx * 2] * feedback;
-                local_buffer[f * 2 + 1] += delay_buf[read_idx * 2 + 1] * feedback;
-
-                delay_buf[delay_idx * 2] = local_buffer[f * 2];
-                delay_buf[delay_idx * 2 + 1] = local_buffer[f * 2 + 1];
-                delay_idx = (delay_idx + 1) % (delay_buf.size() / 2);
-            }
+    }
+
+    template <InstrumentType TYPE>
+    Voice::RenderKernel pick_filter(const Instrument& inst) {
+        bool portamento = inst.portamento_time > 0;
+        if (inst.synth.filter.type == FilterType::NONE) return pick_lfo<TYPE, KernelFilter::NONE>(inst.synth.lfo.target, portamento);
+        // Only a modulated cutoff needs new coefficients every sample
+        if (inst.synth.lfo.target == LFOTarget::FILTER_CUTOFF) {
+            return pick_portamento<TYPE, KernelFilter::INLINE, LFOTarget::FILTER_CUTOFF>(portamento);
         }
-        else if (fx.type == EffectType::REVERB) {
-            auto& proc = reverb_processors[fx_idx];
-            if (proc) {
-                proc->set_params(fx.param1, fx.param2);
-                // Extract separate channels for process call
-                std::vector<float> left(frame_count), right(frame_count);
-                for (int f = 0; f < frame_count; ++f) {
-                    left[f] = local_buffer[f * 2];
-                    right[f] = local_buffer[f * 2 + 1];
-                }
-                proc->process(left.data(), right.data(), frame_count);
-                for (int f = 0; f < frame_count; ++f) {
-                    local_buffer[f * 2] = left[f];
-                    local_buffer[f * 2 + 1] = right[f];
-                }
-            }
+        return pick_lfo<TYPE, KernelFilter::DEFERRED>(inst.synth.lfo.target, portamento);
+    }
+}
+
+Voice::RenderKernel Voice::select_kernel(const Instrument& inst) {
+    switch (inst.type) {
+        case InstrumentType::SAMPLER: return pick_filter<InstrumentType::SAMPLER>(inst);
+        case InstrumentType::SOUNDFONT: return pick_filter<InstrumentType::SOUNDFONT>(inst);
+        default: return pick_filter<InstrumentType::SYNTH>(inst);
+    }
+}
+
+void VoiceBlock::prepare(int frame_count, bool deferred_filter) {
+    stereo.assign(frame_count * 2, 0.0f);
+    filter_pending = deferred_filter;
+    if (deferred_filter) {
+        mono.assign(frame_count, 0.0f);
+        gate.assign(frame_count, 0.0f);
+    }
+}
+
+void Voice::render(float* buffer, int frame_count, float sample_rate, std::map<std::string, tsf*>& soundfonts) {
+    VoiceBlock block;
+    begin_render(block, frame_count, sample_rate, soundfonts);
+    if (block.filter_pending) {
+        FilterLane lane{ slot, block.mono.data(), block.gate.data() };
+        FilterBatch::process(*pool, &lane, 1, frame_count);
+    }
+    finish_render(block, buffer, frame_count);
+}
+
+void Voice::begin_render(VoiceBlock& block, int frame_count, float sample_rate, std::map<std::string, tsf*>& soundfonts) {
+    block.filter_pending = false;
+    if (is_finished || cache_playback || notes().empty()) {
+        block.stereo.clear();
+        return;
+    }
+    if (!latency_primed) prime_latency(sample_rate, soundfonts);
+    const Instrument& instrument = patch->instrument;
+    bool deferred = instrument.synth.filter.type != FilterType::NONE && instrument.synth.lfo.target != LFOTarget::FILTER_CUTOFF;
+    block.prepare(frame_count, deferred);
+
+    // The kernel updates the pooled hot state in place
+    VoiceDspRef state = pool->at(slot);
+    (this->*kernel)(block, frame_count, sample_rate, state, soundfonts);
+    if (deferred) {
+        // The cutoff is fixed, so the coefficients only have to be set once
+        state.filter.update(instrument.synth.filter.type, instrument.synth.filter.cutoff, instrument.synth.filter.resonance, sample_rate);
+    }
+    block.samples_rendered = state.samples_rendered;
+}
+
+void Voice::finish_render(VoiceBlock& block, float* buffer, int frame_count) {
+    if (cache_playback) {
+        // Replayed into the block first, so the output of every voice can be tapped (see ScopeBus)
+        block.stereo.assign(frame_count * 2, 0.0f);
+        if (!is_finished) render_cached(block.stereo.data(), frame_count);
+        for (int i = 0; i < frame_count * 2; ++i) buffer[i] += block.stereo[i];
+        return;
+    }
+    if (block.stereo.empty()) return;
+    std::vector<float>& local_buffer = block.stereo;
+
+    if (block.filter_pending) {
+        for (int f = 0; f < frame_count; ++f) {
+            local_buffer[f * 2] = block.mono[f] * local_buffer[f * 2];
+            local_buffer[f * 2 + 1] = block.mono[f] * local_buffer[f * 2 + 1];
         }
+        block.filter_pending = false;
     }
 
+    if (!effects.empty()) {
+        block.position.resize(frame_count);
+        for (int f = 0; f < frame_count; ++f) block.position[f] = pass_position(block.samples_rendered - frame_count + f);
+        effects.process(EffectBlock{ local_buffer.data(), frame_count, block.position.data() });
+    }
+
+    if (is_fading()) {
+        apply_fade(local_buffer.data(), frame_count);
+        if (fade_frames_left == 0) is_finished = true;
+    }
+
+    float peak = 0.0f;
     for (size_t i = 0; i < local_buffer.size(); ++i) {
         buffer[i] += local_buffer[i];
+        peak = (std::max)(peak, std::abs(local_buffer[i]));
+    }
+    last_peak = peak;
+
+    if (cache_record) {
+        cache_record->pcm.insert(cache_record->pcm.end(), local_buffer.begin(), local_buffer.end());
+        if (is_finished) {
+            cache_record->complete = true;
+            cache_record.reset();
+        }
     }
 }
\ No newline at end of file
@@ -2,49 +2,159 @@
 #define VOICE_H
 
 #include "Instrument.h"
+#include "SongElement.h"
+#include "Patch.h"
+#include "VoicePool.h"
 #include "tsf.h"
-#include "ReverbProcessor.h"
+#include "EffectProcessor.h"
+#include "RenderCache.h"
+#include "SongScheduler.h"
+#include "FastMath.h"
 #include <map>
 #include <string>
 #include <memory>
+#include <vector>
 
-// Biquad Filter for Synth
-struct BiquadState {
-    float z1 = 0.0f, z2 = 0.0f;
-    double a0, a1, a2, b1, b2;
+// Per-block scratch of one voice, between its synthesis kernel and its effects
+struct VoiceBlock {
+    std::vector<float> stereo; // Dry output; holds the pan gains while a deferred filter is pending
+    std::vector<float> mono;   // Pre-filter samples for the deferred filter
+    std::vector<float> gate;   // 1 where the filter runs, 0 where it holds its state (rests, after the end)
+    bool filter_pending = false;
+    double samples_rendered = 0; // Voice position at the end of the block
+    // Quality the kernel runs at, set by the renderer before each block (see QualityGovernor)
+    MathPrecision precision = FastMath::get_precision(); // Pitch, pan and LFO
+    MathPrecision oscillator_precision = MathPrecision::EXACT;
+    int filter_update_interval = 1; // Samples between coefficient updates of a modulated filter
+    std::vector<double> position; // Pass position of each frame, for the effects
 
-    void update(FilterType type, float cutoff, float q, float sample_rate);
-    float process(float in);
+    void prepare(int frame_count, bool deferred_filter);
+};
+
+// How a kernel runs the instrument's filter
+enum class KernelFilter {
+    NONE,
+    INLINE,  // Cutoff modulated per sample, filtered inside the kernel
+    DEFERRED // Fixed cutoff, filtered after the kernel so voices can be batched (see FilterBatch)
 };
 
 class Voice {
 public:
-    Instrument instrument;
+    // Specialized per-sample synthesis loop, see render_kernel()
+    using RenderKernel = void (Voice::*)(VoiceBlock& block, int frame_count, float sample_rate, VoiceDspRef& state,
+                                         std::map<std::string, tsf*>& soundfonts);
+
+    // Immutable data: the shared patch, and the song element that owns the notes
+    std::shared_ptr<const Patch> patch;
+    std::shared_ptr<const InstrumentElement> source;
     double start_time_samples;
     bool is_active = false;
     bool is_finished = false;
 
-    // State
-    size_t current_note_idx = 0;
-    double samples_into_note = 0;
-    float last_freq = -1.0f;
-    float phase = 0.0f;
-    float lfo_phase = 0.0f;
-    BiquadState filter_state;
+    // Hot DSP state (note position, oscillator/LFO phase, filter) lives in a pool slot
+    VoicePool* pool = nullptr;
+    size_t slot = 0;
+
     tsf* soundfont_instance = nullptr;
+    RenderKernel kernel = nullptr; // Picked once at construction
+
+    // Looping (auto-loop followers re-trigger the same voice instead of cloning it)
+    double loop_period_samples = 0;
+    int loop_count = 1;
+    bool soundfont_retrigger = false;
 
     // Effect State
-    double total_samples_rendered = 0;
     double total_duration_samples = 0;
-    std::vector<std::vector<float>> delay_buffers; // One per delay effect
-    std::vector<int> delay_indices;
-    std::vector<std::unique_ptr<ReverbProcessor>> reverb_processors;
+    double pass_duration_samples = 0; // Duration of a single pass through the notes (incl. release)
+    EffectChain effects; // Instrument gain and effects, with their state
+    // Frames the effects delay the output by (see EffectChain::get_latency()). The voice renders
+    // this far ahead of its output so it lines up with the song, and that much longer so the tail
+    // isn't cut. The lead is rendered and dropped before the first block (or by a seek).
+    int latency_frames = 0;
+    bool latency_primed = true;
+    std::shared_ptr<const RenderedSample> sample; // Samplers: the file at the render rate
+
+    // Render cache: a voice either records its output for later identical voices,
+    // or replays an earlier voice's output instead of synthesizing.
+    std::shared_ptr<CachedRender> cache_record;
+    std::shared_ptr<const CachedRender> cache_playback;
+    size_t cache_playback_pos = 0;
+    ScheduledEvent replayed_event; // Replaying voices: what to synthesize if the recording is abandoned
+    // What the voice plays, as RenderCache::make_key() describes it (empty: unknown). A live song
+    // swap keeps the voices whose content and start time are unchanged.
+    std::string content_key;
+
+    // Where each note starts within a pass, so a voice can be positioned without rendering up to it.
+    // Only built when the voice is seeked.
+    struct NoteOffset {
+        double start_sample;     // Matches the per-sample note advance in render()
+        double phase;            // Oscillator phase accumulated before this note
+        double sounding_samples; // Non-rest samples before this note (the LFO only runs on these)
+        size_t note_idx;         // notes.size() for the tail after a trailing rest
+    };
+    std::vector<NoteOffset> note_offsets;
+
+    // Loudest sample of the voice's output in its last block
+    float last_peak = 0.0f;
+    // Fade-out in progress (see fade_out())
+    int fade_frames_left = 0;
+    int fade_frames_total = 0;
 
-    Voice(const Instrument& inst, double start_samples, float sample_rate);
+    // 'impulse_responses' holds the renderer's loaded files for the patch's convolution effects
+    Voice(std::shared_ptr<const Patch> patch, std::shared_ptr<const InstrumentElement> source, VoicePool& pool,
+          const ImpulseResponseMap& impulse_responses, double start_samples, float sample_rate, double loop_period = 0, int loops = 1);
+    Voice(std::shared_ptr<const CachedRender> cached, double start_samples);
     ~Voice();
 
+    Voice(const Voice&) = delete;
+    Voice& operator=(const Voice&) = delete;
+
+    const Instrument& instrument() const { return patch->instrument; }
+    const std::vector<Note>& notes() const { return source->instrument.sequence.notes; }
+
+    // Per-sample synthesis loop, compiled separately for every instrument configuration so the
+    // inner loop carries no per-sample branches on instrument type, filter, LFO or portamento.
+    // Writes the dry block into 'block' and advances 'state'.
+    template <InstrumentType TYPE, KernelFilter FILTER, LFOTarget LFO_TARGET, bool PORTAMENTO>
+    void render_kernel(VoiceBlock& block, int frame_count, float sample_rate, VoiceDspRef& state,
+                       std::map<std::string, tsf*>& soundfonts);
+    static RenderKernel select_kernel(const Instrument& inst);
+
     // Render a block of stereo samples
     void render(float* buffer, int frame_count, float sample_rate, std::map<std::string, tsf*>& soundfonts);
+
+    // render() in two halves, so the renderer can run the deferred filters of all voices together
+    // in between. Voices replaying from the cache do all their work in finish_render(). Afterwards
+    // block.stereo holds what the voice added to 'buffer' (empty if it had nothing left to play).
+    void begin_render(VoiceBlock& block, int frame_count, float sample_rate, std::map<std::string, tsf*>& soundfonts);
+    void finish_render(VoiceBlock& block, float* buffer, int frame_count);
+
+    // Jump to 'offset_samples' after the voice's start. Envelope position and oscillator/LFO phase
+    // are set directly; effect tails and filter state are rebuilt by rendering a pre-roll of at most
+    // 'max_preroll_samples' (0: the effects and filter start out empty, which costs nothing).
+    // The result matches rendering from the start only as far as the pre-roll reaches: the filter
+    // starts from rest where it begins, and tails longer than it are cut. Returns the frames rendered.
+    double seek(double offset_samples, float sample_rate, std::map<std::string, tsf*>& soundfonts, double max_preroll_samples);
+    // The pre-roll seek() renders for 'offset_samples' when it isn't limited
+    double get_seek_preroll(double offset_samples, float sample_rate) const;
+
+    // Ramp the output down to silence over the next 'frames' and finish. A fade already under way
+    // is only ever shortened. A recording of the voice stops here and is abandoned.
+    void fade_out(int frames);
+    bool is_fading() const { return fade_frames_total > 0; }
+
+private:
+    void abandon_recording();
+    void render_cached(float* buffer, int frame_count);
+    void prime_latency(float sample_rate, std::map<std::string, tsf*>& soundfonts);
+    void apply_fade(float* stereo, int frame_count);
+    void retrigger(VoiceDspRef& state);
+    // Position inside the current pass, so per-pass effects (fades, tremolo) restart on every loop
+    double pass_position(double absolute_sample) const;
+    void build_note_offsets(float sample_rate);
+    void jump_to(double offset_samples, float sample_rate);
+    // How much of the voice has to be rendered before a seek target to rebuild effect tails and filter state
+    double effect_preroll_samples(float sample_rate) const;
 };
 
 #endif // VOICE_H
@@ -0,0 +1,92 @@
+#ifdef _WIN32
+    #define NOMINMAX
+    #define _USE_MATH_DEFINES
+#endif
+#include "VoicePool.h"
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void BiquadState::update(FilterType type, float cutoff, float q, float sample_rate) {
+    if (type == FilterType::NONE) return;
+    if (cutoff > sample_rate * 0.49f) cutoff = sample_rate * 0.49f;
+    if (cutoff < 10.0f) cutoff = 10.0f;
+    if (q < 0.1f) q = 0.1f;
+
+    double w0 = 2.0 * M_PI * cutoff / sample_rate;
+    double alpha = sin(w0) / (2.0 * q);
+    double cosw0 = cos(w0);
+
+    if (type == FilterType::LOWPASS) {
+        double norm = 1.0 / (1.0 + alpha);
+        a0 = ((1.0 - cosw0) / 2.0) * norm;
+        a1 = (1.0 - cosw0) * norm;
+        a2 = ((1.0 - cosw0) / 2.0) * norm;
+        b1 = -2.0 * cosw0 * norm;
+        b2 = (1.0 - alpha) * norm;
+    } else if (type == FilterType::HIGHPASS) {
+        double norm = 1.0 / (1.0 + alpha);
+        a0 = ((1.0 + cosw0) / 2.0) * norm;
+        a1 = -(1.0 + cosw0) * norm;
+        a2 = ((1.0 + cosw0) / 2.0) * norm;
+        b1 = -2.0 * cosw0 * norm;
+        b2 = (1.0 - alpha) * norm;
+    } else if (type == FilterType::BANDPASS) {
+        double norm = 1.0 / (1.0 + alpha);
+        a0 = alpha * norm;
+        a1 = 0;
+        a2 = -alpha * norm;
+        b1 = -2.0 * cosw0 * norm;
+        b2 = (1.0 - alpha) * norm;
+    }
+}
+
+float BiquadState::process(float in) {
+    float out = in * a0 + z1;
+    z1 = in * a1 + z2 - b1 * out;
+    z2 = in * a2 - b2 * out;
+    return out;
+}
+
+size_t VoicePool::acquire() {
+    if (!m_free.empty()) {
+        size_t slot = m_free.back();
+        m_free.pop_back();
+        store(slot, VoiceDspState());
+        return slot;
+    }
+    size_t slot = m_phase.size();
+    size_t size = slot + 1;
+    m_note_idx.resize(size);
+    m_samples_into_note.resize(size);
+    m_samples_rendered.resize(size);
+    m_last_freq.resize(size);
+    m_phase.resize(size);
+    m_lfo_phase.resize(size);
+    m_loop_iteration.resize(size);
+    m_filters.resize(size);
+    store(slot, VoiceDspState());
+    return slot;
+}
+
+void VoicePool::release(size_t slot) {
+    m_free.push_back(slot);
+}
+
+VoiceDspRef VoicePool::at(size_t slot) {
+    return VoiceDspRef{ m_note_idx[slot], m_samples_into_note[slot], m_samples_rendered[slot], m_last_freq[slot],
+                        m_phase[slot], m_lfo_phase[slot], m_loop_iteration[slot], m_filters[slot] };
+}
+
+void VoicePool::store(size_t slot, const VoiceDspState& s) {
+    m_note_idx[slot] = static_cast<uint32_t>(s.note_idx);
+    m_samples_into_note[slot] = s.samples_into_note;
+    m_samples_rendered[slot] = s.samples_rendered;
+    m_last_freq[slot] = s.last_freq;
+    m_phase[slot] = s.phase;
+    m_lfo_phase[slot] = s.lfo_phase;
+    m_loop_iteration[slot] = s.loop_iteration;
+    m_filters[slot] = s.filter;
+}
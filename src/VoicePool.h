@@ -0,0 +1,74 @@
+#ifndef VOICE_POOL_H
+#define VOICE_POOL_H
+
+#include "Instrument.h"
+#include "DelayLine.h"
+#include <vector>
+#include <cstdint>
+
+// Biquad Filter for Synth
+struct BiquadState {
+    float z1 = 0.0f, z2 = 0.0f;
+    double a0 = 0, a1 = 0, a2 = 0, b1 = 0, b2 = 0;
+
+    void update(FilterType type, float cutoff, float q, float sample_rate);
+    float process(float in);
+};
+
+// One voice's hot DSP state as a value, to place a voice (see VoicePool::store)
+struct VoiceDspState {
+    size_t note_idx = 0;
+    double samples_into_note = 0;
+    double samples_rendered = 0;
+    float last_freq = -1.0f;
+    float phase = 0.0f;
+    float lfo_phase = 0.0f;
+    int loop_iteration = 0;
+    BiquadState filter;
+};
+
+// One voice's hot DSP state in place in the pool's arrays, so kernels update it without copying
+struct VoiceDspRef {
+    uint32_t& note_idx;
+    double& samples_into_note;
+    double& samples_rendered;
+    float& last_freq;
+    float& phase;
+    float& lfo_phase;
+    int32_t& loop_iteration;
+    BiquadState& filter;
+};
+
+// Hot DSP state of all live synthesized voices, kept as parallel arrays indexed by slot.
+// Everything touched per sample sits in a few dense arrays instead of being scattered
+// between each voice's cold instrument data.
+class VoicePool {
+public:
+    // Freed slots are reused first, so the arrays stay dense and recently used memory stays warm
+    size_t acquire();
+    void release(size_t slot);
+    size_t get_live_count() const { return m_phase.size() - m_free.size(); }
+    size_t get_capacity() const { return m_phase.size(); }
+
+    // Valid until the next acquire(), which may grow the arrays
+    VoiceDspRef at(size_t slot);
+    BiquadState& filter(size_t slot) { return m_filters[slot]; }
+    void store(size_t slot, const VoiceDspState& state);
+
+    // Delay line memory, recycled between the voices
+    DelayLinePool& get_delay_lines() { return m_delay_lines; }
+
+private:
+    std::vector<uint32_t> m_note_idx;
+    std::vector<double> m_samples_into_note;
+    std::vector<double> m_samples_rendered;
+    std::vector<float> m_last_freq;
+    std::vector<float> m_phase;
+    std::vector<float> m_lfo_phase;
+    std::vector<int32_t> m_loop_iteration;
+    std::vector<BiquadState> m_filters; // Coefficients and delay line together, as the filter batch reads them
+    std::vector<size_t> m_free;
+    DelayLinePool m_delay_lines;
+};
+
+#endif // VOICE_POOL_H
@@ -3,8 +3,10 @@
 #include "AudioRenderer.h"
 
 void WavWriter::write(AudioRenderer& renderer, const Song& song, const std::string& file_path, float sample_rate) {
-    std::vector<float> pcm_buffer = renderer.render(song, sample_rate);
+    write(renderer.render(song, sample_rate), file_path, sample_rate);
+}
 
+void WavWriter::write(const std::vector<float>& pcm_buffer, const std::string& file_path, float sample_rate) {
     // Write to WAV file
     SF_INFO sfinfo;
     sfinfo.frames = pcm_buffer.size() / 2;
@@ -3,12 +3,15 @@
 
 #include "Song.h"
 #include <string>
+#include <vector>
 
 class AudioRenderer;
 
 class WavWriter {
 public:
     void write(AudioRenderer& renderer, const Song& song, const std::string& file_path, float sample_rate = 44100.0f);
+    // Already rendered interleaved stereo
+    void write(const std::vector<float>& pcm_buffer, const std::string& file_path, float sample_rate);
 };
 
 #endif // WAV_WRITER_H
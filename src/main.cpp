@@ -6,11 +6,19 @@
 #include "OggWriter.h"
 #include "ScriptParser.h"
 #include "AudioRenderer.h"
+#include "Resampler.h"
+#include "FastMath.h"
 #include <string>
+#include <sstream>
 #include <vector>
 #include <algorithm>
 #include <cstdlib>
 #include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <cmath>
 #include "AudioPlayer.h"
 
 void print_usage(const char* prog_name) {
@@ -18,10 +26,57 @@ void print_usage(const char* prog_name) {
     std::cerr << "Options:" << std::endl;
     std::cerr << "  -o, --out <file>      Specify output filename (extension ignored)" << std::endl;
     std::cerr << "  -f, --format <fmt>    Specify output format: wav, mp3, ogg (default: wav)" << std::endl;
-    std::cerr << "  -q, --quality <rate>  Specify sample rate in Hz (default: 44100)" << std::endl;
+    std::cerr << "  -q, --quality <rate>  Specify sample rate in Hz (default: 44100); a comma-separated list writes one file per rate" << std::endl;
+    std::cerr << "  -r, --render-rate <rate> Synthesize at <rate> and convert to the output rate(s)" << std::endl;
+    std::cerr << "  -m, --math <tier>     DSP math precision: exact, high, fast (default: " << FastMath::get_precision_name(FastMath::get_precision()) << ")" << std::endl;
     std::cerr << "  -p, --playback        Play directly to default speaker (ignores -o and -f)" << std::endl;
+    std::cerr << "      --device-rate <hz>  Playback device rate (default: the device's native rate)" << std::endl;
+    std::cerr << "      --period <frames>   Playback device period size (default: the backend's)" << std::endl;
+    std::cerr << "      --periods <n>       Playback device period count (default: the backend's)" << std::endl;
+    std::cerr << "      --render-ahead <ms> Audio rendered ahead of the device during playback (default: 100)" << std::endl;
+    std::cerr << "      --full-quality      Never trade synthesis quality for speed during playback" << std::endl;
+    std::cerr << "      --max-voices <n>    Most voices sounding at once, 0 = unlimited (default: " << AudioPlayer::DEFAULT_MAX_POLYPHONY << " for playback, unlimited for export)" << std::endl;
+    std::cerr << "      --steal <policy>    Voice that makes room at the limit: oldest, quietest, instrument (default: oldest)" << std::endl;
     std::cerr << "  -d, --dump-json       Dump the song structure to a JSON file" << std::endl;
     std::cerr << "  -Q, --query <sf2>     List instruments in a SoundFont file" << std::endl;
+    std::cerr << "  -s, --start <sec>     Start export/playback at <sec> seconds into the song" << std::endl;
+    std::cerr << "  -e, --end <sec>       Stop export at <sec> seconds into the song" << std::endl;
+    std::cerr << "  -c, --cache-dir <dir> Reuse rendered tracks from <dir> and only re-render what changed" << std::endl;
+    std::cerr << "  -S, --stats           Report DSP load, deadline misses and the cost of each instrument" << std::endl;
+    std::cerr << "  -L, --levels          Write peak, RMS and loudness of the mix and each instrument to <out>_levels.json" << std::endl;
+}
+
+void print_dsp_stats(const DspStats& stats, double buffered_ms) {
+    std::printf("DSP %5.1f%% avg %5.1f%% max (%5.1f%% min)  callback %4.1f%%  misses %llu  underruns %llu  voices %.1f (%.2f%% each, %llu stolen)  buffered %.0f ms\n",
+                stats.load_avg * 100.0, stats.load_max * 100.0, stats.load_min * 100.0, stats.callback_load_max * 100.0,
+                static_cast<unsigned long long>(stats.deadline_misses), static_cast<unsigned long long>(stats.underruns),
+                stats.active_voices, stats.load_per_voice * 100.0, static_cast<unsigned long long>(stats.stolen_voices), buffered_ms);
+    if (stats.quality != QualityLevel::FULL) std::printf("    quality reduced: %s\n", QualityGovernor::get_level_name(stats.quality));
+    for (int i = 0; i < stats.instrument_count; ++i) {
+        std::printf("    %-24s %5.1f%%\n", stats.instruments[i].name, stats.instruments[i].load * 100.0);
+    }
+    std::fflush(stdout);
+}
+
+json levels_to_json(const Levels& levels) {
+    // dBFS, with silence floored where JSON has no -inf
+    auto dbfs = [](float amplitude) { return amplitude > 1e-6f ? 20.0 * std::log10(amplitude) : -120.0; };
+    return json{ {"peak_dbfs", dbfs(levels.max_peak)}, {"rms_dbfs", dbfs(levels.overall_rms)},
+                 {"integrated_lufs", levels.integrated_lufs}, {"max_short_term_lufs", levels.max_short_term_lufs},
+                 {"max_momentary_lufs", levels.max_momentary_lufs} };
+}
+
+bool save_level_report(const LevelReport& report, const std::string& path) {
+    json tracks = json::array();
+    for (int i = 0; i < report.track_count; ++i) {
+        json track = levels_to_json(report.tracks[i].levels);
+        track["name"] = report.tracks[i].name;
+        tracks.push_back(track);
+    }
+    std::ofstream file(path);
+    if (!file) return false;
+    file << json{ {"master", levels_to_json(report.master)}, {"tracks", tracks} }.dump(4) << std::endl;
+    return true;
 }
 
 int main(int argc, char* argv[]) {
@@ -33,11 +88,22 @@ int main(int argc, char* argv[]) {
     std::string script_file_path;
     std::string output_base_name = "song";
     std::string format = "wav";
-    int sample_rate = 44100;
+    std::vector<int> sample_rates = { 44100 };
+    int render_rate = 0;
     bool playback_mode = false;
+    AudioDeviceConfig device_config;
+    double render_ahead_ms = AudioPlayer::DEFAULT_RENDER_AHEAD_MS;
+    bool adaptive_quality = true;
+    long max_voices = -1; // Unset: the playback default, unlimited for export
+    VoiceStealing stealing = VoiceStealing::OLDEST;
     bool dump_json = false;
     bool query_mode = false;
     std::string query_path;
+    std::string cache_dir;
+    double start_sec = 0.0;
+    double end_sec = -1.0;
+    bool show_stats = false;
+    bool write_levels = false;
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -62,8 +128,15 @@ int main(int argc, char* argv[]) {
         } else if (arg == "-q" || arg == "--quality") {
             if (i + 1 < argc) {
                 try {
-                    sample_rate = std::stoi(argv[++i]);
-                    if (sample_rate <= 0) throw std::invalid_argument("Invalid rate");
+                    sample_rates.clear();
+                    std::stringstream list(argv[++i]);
+                    std::string item;
+                    while (std::getline(list, item, ',')) {
+                        int rate = std::stoi(item);
+                        if (rate <= 0) throw std::invalid_argument("Invalid rate");
+                        sample_rates.push_back(rate);
+                    }
+                    if (sample_rates.empty()) throw std::invalid_argument("No rate");
                 } catch (...) {
                     std::cerr << "Error: Invalid sample rate." << std::endl;
                     return 1;
@@ -72,8 +145,87 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Error: Missing argument for sample rate." << std::endl;
                 return 1;
             }
+        } else if (arg == "-r" || arg == "--render-rate") {
+            if (i + 1 < argc) {
+                try {
+                    render_rate = std::stoi(argv[++i]);
+                    if (render_rate <= 0) throw std::invalid_argument("Invalid rate");
+                } catch (...) {
+                    std::cerr << "Error: Invalid render rate." << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: Missing argument for render rate." << std::endl;
+                return 1;
+            }
+        } else if (arg == "-m" || arg == "--math") {
+            MathPrecision precision;
+            if (i + 1 < argc && FastMath::parse_precision(argv[i + 1], precision)) {
+                FastMath::set_precision(precision);
+                ++i;
+            } else {
+                std::cerr << "Error: Expected exact, high or fast for math precision." << std::endl;
+                return 1;
+            }
         } else if (arg == "-p" || arg == "--playback") {
             playback_mode = true;
+        } else if (arg == "-S" || arg == "--stats") {
+            show_stats = true;
+        } else if (arg == "-L" || arg == "--levels") {
+            write_levels = true;
+        } else if (arg == "--device-rate" || arg == "--period" || arg == "--periods") {
+            if (i + 1 < argc) {
+                try {
+                    int value = std::stoi(argv[++i]);
+                    if (value <= 0) throw std::invalid_argument("Invalid value");
+                    unsigned int& target = arg == "--device-rate" ? device_config.sample_rate
+                                         : arg == "--period" ? device_config.period_frames : device_config.periods;
+                    target = static_cast<unsigned int>(value);
+                } catch (...) {
+                    std::cerr << "Error: Invalid value for " << arg << "." << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: Missing argument for " << arg << "." << std::endl;
+                return 1;
+            }
+        } else if (arg == "--full-quality") {
+            adaptive_quality = false;
+        } else if (arg == "--max-voices") {
+            if (i + 1 < argc) {
+                try {
+                    max_voices = std::stol(argv[++i]);
+                    if (max_voices < 0) throw std::invalid_argument("Negative count");
+                } catch (...) {
+                    std::cerr << "Error: Invalid voice count." << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: Missing argument for voice count." << std::endl;
+                return 1;
+            }
+        } else if (arg == "--steal") {
+            std::string policy = (i + 1 < argc) ? argv[++i] : "";
+            if (policy == "oldest") stealing = VoiceStealing::OLDEST;
+            else if (policy == "quietest") stealing = VoiceStealing::QUIETEST;
+            else if (policy == "instrument") stealing = VoiceStealing::SAME_INSTRUMENT;
+            else {
+                std::cerr << "Error: Expected oldest, quietest or instrument for voice stealing." << std::endl;
+                return 1;
+            }
+        } else if (arg == "--render-ahead") {
+            if (i + 1 < argc) {
+                try {
+                    render_ahead_ms = std::stod(argv[++i]);
+                    if (render_ahead_ms < 0) throw std::invalid_argument("Negative time");
+                } catch (...) {
+                    std::cerr << "Error: Invalid render-ahead time." << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: Missing argument for render-ahead time." << std::endl;
+                return 1;
+            }
         } else if (arg == "-d" || arg == "--dump-json") {
             dump_json = true;
         } else if (arg == "-Q" || arg == "--query") {
@@ -84,6 +236,39 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Error: Missing argument for query." << std::endl;
                 return 1;
             }
+        } else if (arg == "-s" || arg == "--start") {
+            if (i + 1 < argc) {
+                try {
+                    start_sec = std::stod(argv[++i]);
+                    if (start_sec < 0) throw std::invalid_argument("Negative time");
+                } catch (...) {
+                    std::cerr << "Error: Invalid start time." << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: Missing argument for start time." << std::endl;
+                return 1;
+            }
+        } else if (arg == "-e" || arg == "--end") {
+            if (i + 1 < argc) {
+                try {
+                    end_sec = std::stod(argv[++i]);
+                    if (end_sec < 0) throw std::invalid_argument("Negative time");
+                } catch (...) {
+                    std::cerr << "Error: Invalid end time." << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Error: Missing argument for end time." << std::endl;
+                return 1;
+            }
+        } else if (arg == "-c" || arg == "--cache-dir") {
+            if (i + 1 < argc) {
+                cache_dir = argv[++i];
+            } else {
+                std::cerr << "Error: Missing argument for cache directory." << std::endl;
+                return 1;
+            }
         } else if (arg[0] == '-') {
             std::cerr << "Unknown option: " << arg << std::endl;
             print_usage(argv[0]);
@@ -118,35 +303,116 @@ int main(int argc, char* argv[]) {
         std::cout << "Saved song to " << json_path << std::endl;
     }
 
+    if (end_sec >= 0 && end_sec <= start_sec) {
+        std::cerr << "Error: End time must be after start time." << std::endl;
+        return 1;
+    }
+
     AudioRenderer renderer;
+    if (!cache_dir.empty()) renderer.set_cache_dir(cache_dir);
+    renderer.set_render_range(start_sec * 1000.0, end_sec >= 0 ? end_sec * 1000.0 : -1.0);
+    if (max_voices >= 0) renderer.set_max_polyphony(static_cast<size_t>(max_voices), stealing);
 
     if (playback_mode) {
         std::cout << "Rendering and playing..." << std::endl;
         AudioPlayer player;
-        if (player.init()) {
-            player.play(song);
+        if (render_rate > 0) player.set_render_rate(static_cast<float>(render_rate));
+        player.set_render_ahead_ms(render_ahead_ms);
+        player.set_adaptive_quality(adaptive_quality);
+        player.set_max_polyphony(max_voices >= 0 ? static_cast<size_t>(max_voices) : AudioPlayer::DEFAULT_MAX_POLYPHONY, stealing);
+        if (player.init(device_config)) {
+            std::cout << "Device: " << player.get_device_rate() << " Hz, " << player.get_periods() << " x "
+                      << player.get_period_frames() << " frames (" << player.get_device_latency_ms() << " ms device latency, "
+                      << player.get_output_latency_ms() << " ms with the render-ahead)" << std::endl;
+            player.set_instrument_profiling(show_stats);
+            player.play(song, false, start_sec * 1000.0);
             std::cout << "Playing... Press Enter to stop." << std::endl;
+            std::atomic<bool> stopped(false);
+            std::thread reporter;
+            if (show_stats) {
+                reporter = std::thread([&] {
+                    for (int tick = 1; !stopped; ++tick) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                        if (tick % 10 == 0) print_dsp_stats(player.get_dsp_stats(), player.get_buffered_ms());
+                    }
+                });
+            }
             std::cin.get(); 
+            stopped = true;
+            if (reporter.joinable()) reporter.join();
             player.stop();
         }
     } else {
-        std::string output_file_path = output_base_name + "." + format;
-        if (format == "wav") {
-            WavWriter writer;
-            writer.write(renderer, song, output_file_path, sample_rate);
-            std::cout << "Rendered song to " << output_file_path << " at " << sample_rate << "Hz" << std::endl;
-        } else if (format == "mp3") {
-            Mp3Writer writer;
-            writer.write(renderer, song, output_file_path, sample_rate);
-            std::cout << "Rendered song to " << output_file_path << " at " << sample_rate << "Hz" << std::endl;
-        } else if (format == "ogg") {
-            OggWriter writer;
-            writer.write(renderer, song, output_file_path, sample_rate);
-            std::cout << "Rendered song to " << output_file_path << " at " << sample_rate << "Hz" << std::endl;
-        } else {
+        if (format != "wav" && format != "mp3" && format != "ogg") {
             std::cerr << "Unsupported format: " << format << std::endl;
             return 1;
         }
+
+        renderer.set_profiling(show_stats);
+        renderer.set_metering(write_levels);
+        double synth_seconds = 0, audio_seconds = 0;
+        auto timed_render = [&](int rate, bool normalize) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<float> pcm = renderer.render(song, static_cast<float>(rate), normalize);
+            synth_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            audio_seconds += pcm.size() / 2.0 / rate;
+            return pcm;
+        };
+
+        // Several rates (or an explicit render rate): synthesize once and convert for each file.
+        // Each file is normalized after conversion, which can raise the peaks.
+        bool convert = sample_rates.size() > 1 || render_rate > 0;
+        int synth_rate = render_rate > 0 ? render_rate : *std::max_element(sample_rates.begin(), sample_rates.end());
+        std::vector<float> rendered;
+        if (convert) rendered = timed_render(synth_rate, false);
+
+        for (int sample_rate : sample_rates) {
+            std::string output_file_path = output_base_name;
+            if (sample_rates.size() > 1) output_file_path += "_" + std::to_string(sample_rate);
+            output_file_path += "." + format;
+
+            std::vector<float> pcm;
+            if (convert) {
+                pcm = Resampler::convert(rendered, synth_rate, sample_rate);
+                AudioRenderer::normalize(pcm);
+            } else {
+                pcm = timed_render(sample_rate, true);
+            }
+            if (format == "wav") {
+                WavWriter().write(pcm, output_file_path, sample_rate);
+            } else if (format == "mp3") {
+                Mp3Writer().write(pcm, output_file_path, sample_rate);
+            } else {
+                OggWriter().write(pcm, output_file_path, sample_rate);
+            }
+            std::cout << "Rendered song to " << output_file_path << " at " << sample_rate << "Hz";
+            if (convert && sample_rate != synth_rate) std::cout << " (synthesized at " << synth_rate << "Hz)";
+            std::cout << std::endl;
+        }
+        if (write_levels) {
+            // Of the synthesized mix, normalized like the files
+            std::string levels_path = output_base_name + "_levels.json";
+            if (save_level_report(renderer.read_levels(), levels_path)) {
+                std::cout << "Saved levels to " << levels_path << std::endl;
+            } else {
+                std::cerr << "Could not write " << levels_path << std::endl;
+            }
+        }
+        if (!cache_dir.empty()) {
+            std::cout << "Reused " << renderer.get_render_cache_hits() << " cached tracks from " << cache_dir << std::endl;
+        }
+        if (show_stats && audio_seconds > 0) {
+            // Offline the load is the share of real time synthesis took; above 100% playback can't keep up
+            std::printf("Synthesized %.1f s of audio in %.2f s: DSP load %.1f%% (%.1fx real time)\n", audio_seconds, synth_seconds,
+                        synth_seconds / audio_seconds * 100.0, audio_seconds / (std::max)(synth_seconds, 1e-9));
+            std::vector<InstrumentCost> costs = renderer.take_instrument_costs();
+            std::sort(costs.begin(), costs.end(), [](const InstrumentCost& a, const InstrumentCost& b) { return a.seconds > b.seconds; });
+            for (const auto& cost : costs) {
+                std::printf("    %-24s %5.1f%%  %.2f s over %zu voice blocks\n", cost.name.c_str(), cost.seconds / audio_seconds * 100.0,
+                            cost.seconds, cost.voice_blocks);
+            }
+            if (size_t stolen = renderer.get_stolen_voice_count()) std::printf("%zu voices stolen by polyphony limits\n", stolen);
+        }
     }
 
     return 0;
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "../src/Convolver.h"
+#include "../src/EffectProcessor.h"
+#include "../src/ScriptParser.h"
+
+int main() {
+    std::cout << "Testing Partitioned Convolution..." << std::endl;
+
+    // Long enough to use the head and all three partition stages (64, 512 and 4096 samples)
+    const size_t ir_length = 12000;
+    std::vector<float> ir_left(ir_length), ir_right(ir_length);
+    unsigned int seed = 1;
+    for (size_t i = 0; i < ir_length; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        float noise = ((seed >> 8) / 16777216.0f) * 2.0f - 1.0f;
+        float decay = std::exp(-static_cast<float>(i) / 3000.0f);
+        ir_left[i] = noise * decay;
+        ir_right[i] = (i % 2 ? -0.5f : 0.5f) * noise * decay;
+    }
+    auto ir = std::make_shared<const ImpulseResponse>(ir_left, ir_right);
+    if (ir->get_stages().size() != 3) {
+        std::cerr << "FAILURE: Expected 3 partition stages, got " << ir->get_stages().size() << std::endl;
+        return 1;
+    }
+
+    // Clicks and a noise burst, processed in blocks that don't line up with any partition
+    const int frames = 30000;
+    std::vector<float> input(frames * 2, 0.0f);
+    input[0] = 1.0f;
+    input[5000 * 2 + 1] = -0.7f;
+    for (int i = 9000; i < 9500; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        input[i * 2] = input[i * 2 + 1] = ((seed >> 8) / 16777216.0f) - 0.5f;
+    }
+
+    std::vector<float> output = input;
+    Convolver convolver(ir);
+    convolver.set_wet(1.0f);
+    const int block = 333;
+    for (int start = 0; start < frames; start += block) {
+        convolver.process(output.data() + start * 2, (std::min)(block, frames - start));
+    }
+
+    // Direct convolution with the same normalization
+    double energy = 0;
+    for (size_t i = 0; i < ir_length; ++i) energy += ir_left[i] * ir_left[i] + ir_right[i] * ir_right[i];
+    double scale = 1.0 / std::sqrt(energy / 2.0);
+
+    double max_error = 0, max_value = 0;
+    for (int n = 0; n < frames; n += 7) {
+        double left = 0, right = 0;
+        for (size_t k = 0; k < ir_length && k <= static_cast<size_t>(n); ++k) {
+            double x = (input[(n - k) * 2] + input[(n - k) * 2 + 1]) * 0.5;
+            left += x * ir_left[k] * scale;
+            right += x * ir_right[k] * scale;
+        }
+        left += input[n * 2];
+        right += input[n * 2 + 1];
+        max_error = (std::max)(max_error, std::abs(left - output[n * 2]));
+        max_error = (std::max)(max_error, std::abs(right - output[n * 2 + 1]));
+        max_value = (std::max)(max_value, std::abs(left));
+    }
+    std::cout << "Max error (expected < 1e-4 of peak): " << max_error << " / " << max_value << std::endl;
+    if (max_error > 1e-4 * max_value) {
+        std::cerr << "FAILURE: Partitioned convolution doesn't match direct convolution." << std::endl;
+        return 1;
+    }
+
+    // A reset convolver starts over exactly like a new one
+    std::vector<float> again = input;
+    convolver.reset();
+    for (int start = 0; start < frames; start += block) {
+        convolver.process(again.data() + start * 2, (std::min)(block, frames - start));
+    }
+    if (again != output) {
+        std::cerr << "FAILURE: A reset convolver didn't repeat its output." << std::endl;
+        return 1;
+    }
+
+    // Effect chains take the impulse response the renderer resolved for the path
+    DelayLinePool pool;
+    Effect convolve;
+    convolve.type = EffectType::CONVOLVE;
+    convolve.path = "room.wav";
+    convolve.param1 = 1.0f;
+    EffectChain chain({ convolve }, 1.0f, 44100.0f, frames, pool, ImpulseResponseMap{ { "room.wav", ir } });
+    EffectChain missing({ convolve }, 1.0f, 44100.0f, frames, pool, ImpulseResponseMap{ { "room.wav", nullptr } });
+    if (chain.get_stage_count() != 1 || chain.get_impulse_length() != ir_length || !missing.empty()) {
+        std::cerr << "FAILURE: The effect chain didn't use the resolved impulse response." << std::endl;
+        return 1;
+    }
+
+    // Script syntax: quoted path (may contain spaces) and optional wet level
+    Song song = ScriptParser::parse_string(R"(
+        instrument Room {
+            waveform sine
+            effect convolve "irs/large hall.wav" 0.3
+        }
+        Room { notes C4 }
+    )");
+    auto inst = std::dynamic_pointer_cast<InstrumentElement>(song.root->children.empty() ? nullptr : song.root->children[0]);
+    if (!inst || inst->instrument.effects.size() != 1 || inst->instrument.effects[0].type != EffectType::CONVOLVE ||
+        inst->instrument.effects[0].path != "irs/large hall.wav" || inst->instrument.effects[0].param1 != 0.3f) {
+        std::cerr << "FAILURE: 'effect convolve' was not parsed." << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: Partitioned convolution matches direct convolution." << std::endl;
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "../src/DelayLine.h"
+#include "../src/EffectProcessor.h"
+#include "../src/ScriptParser.h"
+
+int main() {
+    std::cout << "Testing Pooled Delay Lines..." << std::endl;
+
+    DelayLinePool pool;
+    DelayLine line = pool.acquire(1000);
+    if (line.get_capacity() != 1024 || line.buffer.size() != 2048) {
+        std::cerr << "FAILURE: Expected a 1024 frame line, got " << line.get_capacity() << std::endl;
+        return 1;
+    }
+
+    // Integer and fractional reads of a ramp
+    for (int i = 0; i < 1500; ++i) line.write(static_cast<float>(i), static_cast<float>(-i));
+    if (line.read(0, 1) != 1499.0f || line.read(1, 1000) != -500.0f) {
+        std::cerr << "FAILURE: Integer delay read the wrong frame." << std::endl;
+        return 1;
+    }
+    if (std::abs(line.read_fractional(0, 10.25f) - 1489.75f) > 1e-3f) {
+        std::cerr << "FAILURE: Fractional delay doesn't interpolate: " << line.read_fractional(0, 10.25f) << std::endl;
+        return 1;
+    }
+
+    // A released line is handed out again, zeroed, for any request of the same size
+    const float* memory = line.buffer.data();
+    pool.release(line);
+    if (!line.empty() || pool.get_pooled_bytes() != 2048 * sizeof(float)) {
+        std::cerr << "FAILURE: Released line was not pooled." << std::endl;
+        return 1;
+    }
+    DelayLine reused = pool.acquire(600);
+    if (reused.buffer.data() != memory || reused.read(0, 5) != 0.0f || pool.get_pooled_bytes() != 0) {
+        std::cerr << "FAILURE: Pooled line was not reused and cleared." << std::endl;
+        return 1;
+    }
+
+    // Releasing never frees: lines beyond the budget are only dropped by trim()
+    pool.set_budget_bytes(0);
+    pool.release(reused);
+    if (pool.get_pooled_bytes() != 2048 * sizeof(float)) {
+        std::cerr << "FAILURE: Releasing a line beyond the budget freed it." << std::endl;
+        return 1;
+    }
+    pool.trim();
+    if (pool.get_pooled_bytes() != 0) {
+        std::cerr << "FAILURE: Pool kept a line beyond its budget after trimming." << std::endl;
+        return 1;
+    }
+
+    // Flanger feedback past 1 is clamped, so an impulse dies away instead of growing without bound
+    Effect flanger;
+    flanger.type = EffectType::FLANGER;
+    flanger.param1 = 0.2f;
+    flanger.param2 = 2.0f;
+    flanger.param3 = 1.5f;
+    const int frames = 44100;
+    EffectChain chain({ flanger }, 1.0f, 44100.0f, frames, pool, ImpulseResponseMap());
+    std::vector<float> impulse(frames * 2, 0.0f);
+    std::vector<double> position(frames);
+    for (int f = 0; f < frames; ++f) position[f] = f;
+    impulse[0] = impulse[1] = 1.0f;
+    chain.process(EffectBlock{ impulse.data(), frames, position.data() });
+    float tail = 0.0f;
+    for (int i = frames; i < frames * 2; ++i) tail = (std::max)(tail, std::abs(impulse[i]));
+    if (!(tail < 1e-3f)) {
+        std::cerr << "FAILURE: Flanger with feedback 1.5 still rings at " << tail << " after half a second." << std::endl;
+        return 1;
+    }
+
+    Song song = ScriptParser::parse_string(R"(
+        instrument Pad {
+            waveform sawtooth
+            effect chorus 0.8 4
+            effect flanger 0.2 2 0.7
+        }
+        Pad { notes C4 }
+    )");
+    auto inst = std::dynamic_pointer_cast<InstrumentElement>(song.root->children.empty() ? nullptr : song.root->children[0]);
+    if (!inst || inst->instrument.effects.size() != 2 ||
+        inst->instrument.effects[0].type != EffectType::CHORUS || inst->instrument.effects[0].param3 != 0.5f ||
+        inst->instrument.effects[1].type != EffectType::FLANGER || inst->instrument.effects[1].param3 != 0.7f) {
+        std::cerr << "FAILURE: 'effect chorus' / 'effect flanger' were not parsed." << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: Delay lines are sized, pooled and interpolated correctly." << std::endl;
+    return 0;
+}
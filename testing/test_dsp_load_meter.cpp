@@ -0,0 +1,99 @@
+#include <iostream>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "../src/DspLoadMeter.h"
+
+int main() {
+    std::cout << "Testing DSP load meter..." << std::endl;
+
+    // 250-frame blocks at 1 kHz hold a quarter second each, so a one-second window is four blocks
+    const float SAMPLE_RATE = 1000.0f;
+    const int FRAMES = 250;
+    DspLoadMeter meter;
+    meter.reset(SAMPLE_RATE, 1.0);
+
+    const double loads[] = { 0.5, 0.25, 1.5, 0.75 };
+    const size_t voices[] = { 2, 2, 4, 4 };
+    for (int i = 0; i < 4; ++i) {
+        if (i == 1) {
+            meter.add_callback(0.001, 4); // A quarter of its period
+            meter.add_callback(0.002, 4); // Half
+        }
+        bool complete = meter.add_block(loads[i] * 0.25, FRAMES, voices[i]);
+        if (complete != (i == 3)) {
+            std::cerr << "FAILURE: The window " << (complete ? "ended" : "didn't end") << " after block " << i << std::endl;
+            return 1;
+        }
+    }
+
+    // Ten instruments over two renderers' reports; "Pad" shows up in both and is merged
+    std::vector<InstrumentCost> first, second;
+    for (int i = 0; i < 5; ++i) first.push_back({ "Inst" + std::to_string(i), 0.01 * (i + 1), 1 });
+    first.push_back({ "Pad", 0.02, 1 });
+    for (int i = 5; i < 9; ++i) second.push_back({ "Inst" + std::to_string(i), 0.01 * (i + 1), 1 });
+    second.push_back({ "Pad", 0.08, 1 });
+    meter.add_instruments(first);
+    meter.add_instruments(second);
+    meter.publish();
+
+    const DspStats& stats = meter.read();
+    if (stats.load_min != 0.25f || stats.load_max != 1.5f || stats.load_avg != 0.75f) {
+        std::cerr << "FAILURE: Load " << stats.load_min << " / " << stats.load_avg << " / " << stats.load_max
+                  << ", expected 0.25 / 0.75 / 1.5" << std::endl;
+        return 1;
+    }
+    if (stats.blocks != 4 || stats.deadline_misses != 1) {
+        std::cerr << "FAILURE: " << stats.blocks << " blocks with " << stats.deadline_misses << " misses, expected 4 with 1." << std::endl;
+        return 1;
+    }
+    if (stats.callback_load_max != 0.5f || stats.active_voices != 3.0f) {
+        std::cerr << "FAILURE: Callback load " << stats.callback_load_max << " and " << stats.active_voices
+                  << " voices, expected 0.5 and 3." << std::endl;
+        return 1;
+    }
+
+    // Costliest first, cut to MAX_INSTRUMENTS; the per-voice load still counts every instrument
+    const char* expected[] = { "Pad", "Inst8", "Inst7", "Inst6", "Inst5", "Inst4", "Inst3", "Inst2" };
+    if (stats.instrument_count != DspStats::MAX_INSTRUMENTS) {
+        std::cerr << "FAILURE: " << stats.instrument_count << " instruments published, expected " << DspStats::MAX_INSTRUMENTS << std::endl;
+        return 1;
+    }
+    for (int i = 0; i < stats.instrument_count; ++i) {
+        if (std::string(stats.instruments[i].name) != expected[i]) {
+            std::cerr << "FAILURE: Instrument " << i << " is " << stats.instruments[i].name << ", expected " << expected[i] << std::endl;
+            return 1;
+        }
+    }
+    if (std::abs(stats.instruments[0].load - 0.1f) > 1e-6f || std::abs(stats.load_per_voice - 0.55f / 3.0f) > 1e-6f) {
+        std::cerr << "FAILURE: Pad's load is " << stats.instruments[0].load << " and a voice's " << stats.load_per_voice << std::endl;
+        return 1;
+    }
+
+    // The next window starts over, apart from the running totals
+    for (int i = 0; i < 4; ++i) meter.add_block(0.125, FRAMES, 0);
+    meter.publish();
+    const DspStats& next = meter.read();
+    if (next.load_min != 0.5f || next.load_max != 0.5f || next.load_avg != 0.5f) {
+        std::cerr << "FAILURE: The previous window's loads carried over." << std::endl;
+        return 1;
+    }
+    if (next.callback_load_max != 0.0f || next.instrument_count != 0 || next.load_per_voice != 0.0f) {
+        std::cerr << "FAILURE: The callback load or instruments weren't reset when published." << std::endl;
+        return 1;
+    }
+    if (next.blocks != 8 || next.deadline_misses != 1) {
+        std::cerr << "FAILURE: The block and miss counts didn't keep running." << std::endl;
+        return 1;
+    }
+
+    // Reset clears everything
+    meter.reset(SAMPLE_RATE, 1.0);
+    if (meter.read().blocks != 0 || meter.read().deadline_misses != 0) {
+        std::cerr << "FAILURE: Reset kept the counts." << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: Load windows, deadline misses and instrument costs are published as measured." << std::endl;
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include "../src/FastMath.h"
+
+namespace {
+    // Largest error of 'approx' against 'reference' over [from, to]; relative where the reference scales
+    double max_error(const std::function<double(double)>& approx, const std::function<double(double)>& reference,
+                     double from, double to, bool relative) {
+        const int steps = 200000;
+        double worst = 0;
+        for (int i = 0; i <= steps; ++i) {
+            double x = from + (to - from) * i / steps;
+            double expected = reference(x);
+            double error = std::abs(approx(x) - expected);
+            if (relative) error /= std::abs(expected);
+            worst = (std::max)(worst, error);
+        }
+        return worst;
+    }
+
+    bool check(const char* name, MathPrecision precision, double error, double bound) {
+        std::cout << name << " (" << FastMath::get_precision_name(precision) << "): " << error
+                  << " (bound " << bound << ")" << std::endl;
+        if (error > bound) {
+            std::cerr << "FAILURE: " << name << " exceeds its error bound." << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    std::cout << "Testing DSP math approximations..." << std::endl;
+
+    const double PI = 3.14159265358979323846;
+    struct Bounds { MathPrecision precision; double exp2, tanh, sin, pan, hz; };
+    const Bounds tiers[] = {
+        { MathPrecision::EXACT, 0.0, 0.0, 0.0, 0.0, 0.0 },
+        { MathPrecision::HIGH, 5e-7, 1e-6, 1e-6, 1e-6, 1e-6 },
+        { MathPrecision::FAST, 1e-4, 2e-3, 1e-4, 1e-4, 1e-4 },
+    };
+
+    bool ok = true;
+    for (const Bounds& b : tiers) {
+        MathPrecision p = b.precision;
+        // EXACT is libm itself, so it's compared against the same float calls
+        bool exact = p == MathPrecision::EXACT;
+
+        ok &= check("exp2", p, max_error([&](double x) { return FastMath::exp2(static_cast<float>(x), p); },
+            [&](double x) { return exact ? std::pow(2.0f, static_cast<float>(x)) : std::exp2(static_cast<float>(x)); },
+            -30.0, 30.0, true), b.exp2);
+
+        ok &= check("tanh", p, max_error([&](double x) { return FastMath::tanh(static_cast<float>(x), p); },
+            [&](double x) { return exact ? std::tanh(static_cast<float>(x)) : std::tanh(static_cast<double>(static_cast<float>(x))); },
+            -12.0, 12.0, false), b.tanh);
+
+        // Sweep phases reach thousands of radians after a few minutes
+        ok &= check("sin", p, max_error([&](double x) { return FastMath::sin(x, p); },
+            [](double x) { return std::sin(x); }, -5000.0, 5000.0, false), b.sin);
+        ok &= check("cos", p, max_error([&](double x) { return FastMath::cos(static_cast<float>(x), p); },
+            [&](double x) { return exact ? std::cos(static_cast<float>(x)) : std::cos(static_cast<double>(static_cast<float>(x))); },
+            -50.0, 50.0, false), b.sin);
+
+        double pan_error = max_error([&](double pan) {
+            float left, right;
+            FastMath::pan_gains(static_cast<float>(pan), left, right, p);
+            float p01 = (static_cast<float>(pan) + 1.0f) / 2.0f;
+            return (std::max)(std::abs(left - std::cos(p01 * PI / 2.0)), std::abs(right - std::sin(p01 * PI / 2.0)));
+        }, [](double) { return 0.0; }, -1.0, 1.0, false);
+        ok &= check("pan law", p, pan_error, b.pan + 1e-7);
+
+        ok &= check("midi to hz", p, max_error([&](double pitch) { return FastMath::midi_to_hz(static_cast<float>(pitch), p); },
+            [&](double pitch) {
+                float f = static_cast<float>(pitch);
+                return exact ? 440.0f * std::pow(2.0f, (f - 69.0f) / 12.0f) : 440.0 * std::pow(2.0, (f - 69.0) / 12.0);
+            }, -12.0, 140.0, true), b.hz + 1e-7);
+    }
+
+    // Whole semitones come straight from the table: correctly rounded
+    for (int note = 0; note < 128; ++note) {
+        float expected = static_cast<float>(440.0 * std::pow(2.0, (note - 69) / 12.0));
+        if (FastMath::midi_to_hz(static_cast<float>(note), MathPrecision::FAST) != expected) {
+            std::cerr << "FAILURE: MIDI note " << note << " isn't the correctly rounded frequency." << std::endl;
+            return 1;
+        }
+    }
+
+    // The block tanh (vectorized) agrees with the scalar one
+    for (MathPrecision p : { MathPrecision::EXACT, MathPrecision::HIGH, MathPrecision::FAST }) {
+        std::vector<float> block(1027);
+        for (size_t i = 0; i < block.size(); ++i) block[i] = static_cast<float>(std::sin(i * 0.37) * 1.5);
+        std::vector<float> expected = block;
+        for (float& v : expected) v = FastMath::tanh(v * 4.0f, p);
+        FastMath::tanh(block.data(), static_cast<int>(block.size()), 4.0f, p);
+        for (size_t i = 0; i < block.size(); ++i) {
+            if (std::abs(block[i] - expected[i]) > 1e-6f) {
+                std::cerr << "FAILURE: Block tanh differs from scalar tanh at " << i << "." << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // Rounding away from the halfway points matches std::round
+    for (float x = -70000.0f; x < 70000.0f; x += 0.3f) {
+        if (FastMath::round(x, MathPrecision::FAST) != std::round(x) && std::abs(x - std::trunc(x)) != 0.5f) {
+            std::cerr << "FAILURE: Fast round of " << x << " is wrong." << std::endl;
+            return 1;
+        }
+    }
+
+    MathPrecision parsed;
+    if (!FastMath::parse_precision("high", parsed) || parsed != MathPrecision::HIGH || FastMath::parse_precision("rough", parsed)) {
+        std::cerr << "FAILURE: Precision names don't parse." << std::endl;
+        return 1;
+    }
+
+    if (!ok) return 1;
+    std::cout << "SUCCESS: Every tier is within its error bounds." << std::endl;
+    return 0;
+}
@@ -3,48 +3,50 @@
 #include <complex>
 #include <cmath>
 #include <cassert>
+#include "../src/Fft.h"
 
-// Copying iterative FFT for testing
 const double PI = 3.14159265358979323846;
-void fft_iterative(std::vector<std::complex<double>>& a) {
-    int n = a.size();
-    for (int i = 1, j = 0; i < n; i++) {
-        int bit = n >> 1;
-        for (; j & bit; bit >>= 1) j ^= bit;
-        j ^= bit;
-        if (i < j) std::swap(a[i], a[j]);
-    }
-    for (int len = 2; len <= n; len <<= 1) {
-        double ang = 2 * PI / len;
-        std::complex<double> wlen(cos(ang), sin(ang));
-        for (int i = 0; i < n; i += len) {
-            std::complex<double> w(1);
-            for (int j = 0; j < len / 2; j++) {
-                std::complex<double> u = a[i + j], v = a[i + j + len / 2] * w;
-                a[i + j] = u + v;
-                a[i + j + len / 2] = u - v;
-                w *= wlen;
-            }
-        }
-    }
-}
 
 int main() {
     const int N = 8;
-    std::vector<std::complex<double>> data(N);
-    
+    FftPlan plan(N);
+    std::vector<std::complex<float>> data(N);
+
     // DC component
-    for (int i = 0; i < N; ++i) data[i] = 1.0;
-    fft_iterative(data);
-    assert(std::abs(data[0].real() - 8.0) < 1e-9);
-    for (int i = 1; i < N; ++i) assert(std::abs(data[i]) < 1e-9);
-    
+    for (int i = 0; i < N; ++i) data[i] = 1.0f;
+    plan.forward(data.data());
+    assert(std::abs(data[0].real() - 8.0f) < 1e-5f);
+    for (int i = 1; i < N; ++i) assert(std::abs(data[i]) < 1e-5f);
+
     // Sine wave at bin 1
-    for (int i = 0; i < N; ++i) data[i] = std::complex<double>(cos(2.0 * PI * i / N), 0);
-    fft_iterative(data);
+    for (int i = 0; i < N; ++i) data[i] = std::complex<float>(static_cast<float>(std::cos(2.0 * PI * i / N)), 0.0f);
+    plan.forward(data.data());
     // Bin 1 and N-1 should be 4.0
-    assert(std::abs(data[1].real() - 4.0) < 1e-9);
-    assert(std::abs(data[7].real() - 4.0) < 1e-9);
+    assert(std::abs(data[1].real() - 4.0f) < 1e-5f);
+    assert(std::abs(data[7].real() - 4.0f) < 1e-5f);
+
+    // The real-input transform matches a direct DFT at every size
+    for (int size = 4; size <= 4096; size *= 2) {
+        std::vector<float> input(size);
+        for (int i = 0; i < size; ++i) {
+            input[i] = static_cast<float>(std::sin(0.37 * i) + 0.5 * std::cos(2.1 * i + 0.3) + ((i * 7919) % 13) / 13.0 - 0.5);
+        }
+        RealFftPlan real_plan(size);
+        std::vector<std::complex<float>> bins(size / 2 + 1);
+        real_plan.forward(input.data(), bins.data());
+
+        double max_error = 0, scale = 0;
+        for (int k = 0; k <= size / 2; ++k) {
+            std::complex<double> expected(0.0, 0.0);
+            for (int n = 0; n < size; ++n) expected += static_cast<double>(input[n]) * std::polar(1.0, -2.0 * PI * k * n / size);
+            max_error = (std::max)(max_error, std::abs(expected - std::complex<double>(bins[k])));
+            scale = (std::max)(scale, std::abs(expected));
+        }
+        if (max_error > 1e-5 * scale + 1e-5) {
+            std::cerr << "Real FFT of size " << size << " is off by " << max_error << std::endl;
+            return 1;
+        }
+    }
 
     std::cout << "FFT logic tests passed!" << std::endl;
     return 0;
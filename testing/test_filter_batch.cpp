@@ -0,0 +1,73 @@
+#include <iostream>
+#include <cmath>
+#include "../src/ScriptParser.h"
+#include "../src/AudioRenderer.h"
+#include "../src/FilterBatch.h"
+
+int main() {
+    std::cout << "Testing Batched Voice Filters..." << std::endl;
+
+    ScriptParser::set_global_bpm(120);
+
+    // Seven filtered voices (an odd count, so AVX2, SSE2 and scalar lanes are all used),
+    // with rests so some lanes hold their filter state while others run
+    std::string script = R"(
+        instrument Pad {
+            waveform sawtooth
+            filter lowpass 1200 2.0
+            envelope 0.05 0.1 0.7 0.3
+        }
+        instrument Pluck {
+            waveform square
+            filter highpass 300 0.8
+            envelope 0.001 0.1 0.0 0.1
+        }
+        instrument Reso {
+            waveform triangle
+            filter bandpass 900 4.0
+        }
+        parallel {
+            Pad { notes C3_1 Eb3_1 }
+            Pad { notes G3_1 Bb3_1 }
+            Pad { notes C4_2 R_2 D4_1 }
+            Pluck { notes C5_8*8 R_2 C5_8*4 }
+            Pluck { notes R_8 G5_8*7 }
+            Reso { notes C2_4 R_4 C2_2 }
+            Reso { notes G2_2 R_4 G2_4 }
+        }
+    )";
+
+    Song song = ScriptParser::parse_string(script);
+
+    SimdLevel supported = Simd::get_supported_level();
+    std::cout << "Supported instruction set: " << Simd::get_level_name(supported) << std::endl;
+
+    Simd::set_level(SimdLevel::SCALAR);
+    AudioRenderer scalar_renderer;
+    scalar_renderer.set_render_cache_enabled(false);
+    std::vector<float> reference = scalar_renderer.render(song, 44100.0f);
+
+    for (SimdLevel level : { SimdLevel::SSE2, SimdLevel::AVX2 }) {
+        Simd::set_level(level);
+        if (Simd::get_level() != level) continue; // Not available on this CPU
+
+        AudioRenderer renderer;
+        renderer.set_render_cache_enabled(false);
+        std::vector<float> result = renderer.render(song, 44100.0f);
+        if (result.size() != reference.size()) {
+            std::cerr << "FAILURE: Length mismatch with " << Simd::get_level_name(level) << std::endl;
+            return 1;
+        }
+        for (size_t i = 0; i < reference.size(); ++i) {
+            if (result[i] != reference[i]) {
+                std::cerr << "FAILURE: " << Simd::get_level_name(level) << " differs from scalar at sample " << i << std::endl;
+                return 1;
+            }
+        }
+        std::cout << Simd::get_level_name(level) << " matches the scalar path." << std::endl;
+    }
+    Simd::set_level(supported);
+
+    std::cout << "SUCCESS: Batched filters are identical on every instruction set." << std::endl;
+    return 0;
+}
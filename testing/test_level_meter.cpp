@@ -0,0 +1,90 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "../src/LevelMeter.h"
+#include "../src/Simd.h"
+
+// Stereo sine at 'amplitude', 'seconds' long
+static std::vector<float> sine(float rate, float hz, float amplitude, double seconds) {
+    const double PI = 3.14159265358979323846;
+    std::vector<float> stereo(static_cast<size_t>(rate * seconds) * 2);
+    for (size_t f = 0; f < stereo.size() / 2; ++f) {
+        stereo[f * 2] = stereo[f * 2 + 1] = amplitude * static_cast<float>(std::sin(2.0 * PI * hz * f / rate));
+    }
+    return stereo;
+}
+
+// Feeds 'signal' in blocks of 'block' frames
+static void feed(LevelMeter& meter, const std::vector<float>& signal, int block) {
+    int frames = static_cast<int>(signal.size() / 2);
+    for (int pos = 0; pos < frames; pos += block) meter.process(signal.data() + pos * 2, (std::min)(block, frames - pos));
+}
+
+int main() {
+    std::cout << "Testing level meter..." << std::endl;
+
+    // BS.1770 calibration: a 1 kHz sine in both channels reads its level in dBFS as LUFS, at any rate
+    for (float rate : { 44100.0f, 48000.0f, 96000.0f }) {
+        LevelMeter meter;
+        meter.reset(rate);
+        feed(meter, sine(rate, 1000.0f, std::pow(10.0f, -23.0f / 20.0f), 4.0), 512);
+        const Levels& l = meter.get_levels();
+        if (std::abs(l.short_term_lufs + 23.0f) > 0.1f || std::abs(l.momentary_lufs + 23.0f) > 0.1f || std::abs(l.integrated_lufs + 23.0f) > 0.1f) {
+            std::cerr << "FAILURE: -23 dBFS sine at " << rate << " Hz reads " << l.short_term_lufs << " LUFS short-term, "
+                      << l.integrated_lufs << " integrated" << std::endl;
+            return 1;
+        }
+        if (std::abs(l.peak - 0.0708f) > 0.001f || std::abs(l.rms - 0.0708f / std::sqrt(2.0f)) > 0.001f) {
+            std::cerr << "FAILURE: Sine peak " << l.peak << ", RMS " << l.rms << std::endl;
+            return 1;
+        }
+    }
+
+    // Silence is gated out of the integrated loudness, and the meter settles to it afterwards
+    LevelMeter gated;
+    gated.reset(48000.0f);
+    feed(gated, sine(48000.0f, 1000.0f, 0.1f, 5.0), 480);
+    feed(gated, std::vector<float>(48000 * 2 * 5, 0.0f), 480);
+    const Levels& g = gated.get_levels();
+    if (std::abs(g.integrated_lufs + 20.0f) > 0.1f || g.short_term_lufs != Levels::SILENCE_LUFS || g.peak != 0.0f
+        || std::abs(g.max_peak - 0.1f) > 0.001f || std::abs(g.max_short_term_lufs + 20.0f) > 0.1f) {
+        std::cerr << "FAILURE: After silence: integrated " << g.integrated_lufs << ", short-term " << g.short_term_lufs << std::endl;
+        return 1;
+    }
+
+    // Low frequencies are weighted down by the K-weighting high pass
+    LevelMeter low;
+    low.reset(48000.0f);
+    feed(low, sine(48000.0f, 20.0f, 1.0f, 4.0), 1024);
+    if (low.get_levels().short_term_lufs > -10.0f) {
+        std::cerr << "FAILURE: 20 Hz sine reads " << low.get_levels().short_term_lufs << " LUFS" << std::endl;
+        return 1;
+    }
+
+    // The SIMD path matches the scalar one
+    std::vector<float> mixed = sine(48000.0f, 440.0f, 0.5f, 2.0);
+    for (size_t i = 0; i < mixed.size(); i += 2) mixed[i] *= 0.25f;
+    LevelMeter scalar, vector;
+    Simd::set_level(SimdLevel::SCALAR);
+    scalar.reset(48000.0f);
+    feed(scalar, mixed, 333);
+    Simd::set_level(Simd::get_supported_level());
+    vector.reset(48000.0f);
+    feed(vector, mixed, 333);
+    if (scalar.get_levels().short_term_lufs != vector.get_levels().short_term_lufs || scalar.get_levels().peak != vector.get_levels().peak) {
+        std::cerr << "FAILURE: Scalar reads " << scalar.get_levels().short_term_lufs << " LUFS, " << Simd::get_level_name(Simd::get_level())
+                  << " " << vector.get_levels().short_term_lufs << std::endl;
+        return 1;
+    }
+
+    // Scaling by a gain moves loudness by its dB and leaves silence alone
+    Levels scaled = g.scaled(0.5f);
+    if (std::abs(scaled.integrated_lufs - (g.integrated_lufs - 6.0206f)) > 0.01f || scaled.short_term_lufs != Levels::SILENCE_LUFS) {
+        std::cerr << "FAILURE: Scaled levels read " << scaled.integrated_lufs << " LUFS" << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: Peak, RMS and BS.1770 loudness are right at every rate and SIMD level." << std::endl;
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "../src/ScriptParser.h"
+#include "../src/AudioRenderer.h"
+
+namespace {
+    const float SAMPLE_RATE = 32000.0f; // 16ms = one 512-frame block, so the 480ms beats fall on block starts
+    const int BLOCK = 512;
+
+    void render(AudioRenderer& renderer, std::vector<float>& out, int blocks = -1) {
+        float block[BLOCK * 2];
+        for (int n = 0; n != blocks && !renderer.is_finished(); ++n) {
+            renderer.render_block(block, BLOCK);
+            out.insert(out.end(), block, block + BLOCK * 2);
+        }
+    }
+
+    std::vector<float> reference(const Song& song, double from_ms = 0.0) {
+        AudioRenderer renderer;
+        renderer.set_render_cache_enabled(false);
+        renderer.load(song, SAMPLE_RATE);
+        if (from_ms > 0) renderer.seek(from_ms);
+        std::vector<float> out;
+        render(renderer, out);
+        return out;
+    }
+
+    // Index of the first sample from 'first' on where 'a' and 'b' differ by more than 'tolerance', or -1
+    long first_difference(const std::vector<float>& a, const std::vector<float>& b, size_t first, size_t end, float tolerance) {
+        if (a.size() < end || b.size() < end) return 0;
+        for (size_t i = first; i < end; ++i) {
+            if (std::abs(a[i] - b[i]) > tolerance) return static_cast<long>(i);
+        }
+        return -1;
+    }
+
+    std::string script(const std::string& bass_notes) {
+        return R"(
+            tempo 125
+            instrument Lead {
+                waveform sine
+                envelope 0.01 0.1 0.6 0.3
+                effect reverb 0.7 0.5
+            }
+            instrument Bass {
+                waveform triangle
+                envelope 0.005 0.05 0.8 0.05
+            }
+            parallel {
+                Lead { notes C5(960) G4(960) E5(960) }
+                Bass { notes )" + bass_notes + R"( }
+            }
+        )";
+    }
+}
+
+int main() {
+    std::cout << "Testing live song swaps..." << std::endl;
+
+    Song original = ScriptParser::parse_string(script("C2(240) C2(240) G2(240) G2(240) C2(240) C2(240) G2(240) G2(240) C2(960)"));
+    Song edited = ScriptParser::parse_string(script("C2(240) C2(240) G2(240) G2(240) A2(240) A2(240) F2(240) F2(240) C2(960)"));
+    if (original.bpm != 125) {
+        std::cerr << "FAILURE: The song's tempo is " << original.bpm << " BPM, expected 125." << std::endl;
+        return 1;
+    }
+    const double beat_ms = 60000.0 / original.bpm;
+    const size_t boundary = static_cast<size_t>(beat_ms / 1000.0 * SAMPLE_RATE) * 2;
+    std::vector<float> original_out = reference(original);
+    std::vector<float> edited_out = reference(edited);
+
+    // Swapping in the same song changes nothing: every voice plays on, tails and phases included
+    AudioRenderer same;
+    same.set_render_cache_enabled(false);
+    same.load(original, SAMPLE_RATE);
+    std::vector<float> out;
+    render(same, out, 20);
+    same.swap_song(same.prepare_swap(ScriptParser::parse_string(script("C2(240) C2(240) G2(240) G2(240) C2(240) C2(240) G2(240) G2(240) C2(960)"))), beat_ms);
+    render(same, out);
+    SongSwapStats stats = same.get_swap_stats();
+    if (out != original_out || stats.swaps != 1 || stats.kept_voices != 2 || stats.replaced_voices != 0 || stats.new_voices != 0) {
+        std::cerr << "FAILURE: Swapping in an unchanged song disturbed it (" << stats.kept_voices << " kept, "
+                  << stats.replaced_voices << " replaced, " << stats.new_voices << " new)." << std::endl;
+        return 1;
+    }
+
+    // An edit lands on the next beat: before it the original plays, after the fade the edited song
+    AudioRenderer live;
+    live.set_render_cache_enabled(false);
+    live.load(original, SAMPLE_RATE);
+    out.clear();
+    render(live, out, 20);
+    live.swap_song(live.prepare_swap(edited), beat_ms);
+    if (!live.is_swap_pending()) {
+        std::cerr << "FAILURE: The swap took over before its beat." << std::endl;
+        return 1;
+    }
+    render(live, out);
+    stats = live.get_swap_stats();
+    if (stats.swaps != 1 || stats.kept_voices != 1 || stats.replaced_voices != 1 || stats.new_voices != 1) {
+        std::cerr << "FAILURE: Expected the lead kept and the bass replaced, got " << stats.kept_voices << " kept, "
+                  << stats.replaced_voices << " replaced, " << stats.new_voices << " new." << std::endl;
+        return 1;
+    }
+    long diff = first_difference(out, original_out, 0, boundary, 0.0f);
+    if (diff >= 0 || out.size() != edited_out.size()) {
+        std::cerr << "FAILURE: The edit was heard before its beat (sample " << diff << ")." << std::endl;
+        return 1;
+    }
+    size_t faded = boundary + static_cast<size_t>(AudioRenderer::SWAP_FADE_SECONDS * SAMPLE_RATE) * 2;
+    diff = first_difference(out, edited_out, faded, out.size(), 1e-3f);
+    if (diff >= 0) {
+        std::cerr << "FAILURE: After the swap the output differs from the edited song at " << (diff / 2 / SAMPLE_RATE * 1000.0)
+                  << "ms: " << out[diff] << " vs " << edited_out[diff] << std::endl;
+        return 1;
+    }
+
+    // A seek doesn't wait for the boundary
+    AudioRenderer seeked;
+    seeked.set_render_cache_enabled(false);
+    seeked.load(original, SAMPLE_RATE);
+    seeked.swap_song(seeked.prepare_swap(edited), 60000.0);
+    seeked.seek(1120.0);
+    out.clear();
+    render(seeked, out);
+    std::vector<float> edited_from_seek = reference(edited, 1120.0);
+    if (seeked.is_swap_pending() || first_difference(out, edited_from_seek, 0, edited_from_seek.size(), 0.0f) >= 0) {
+        std::cerr << "FAILURE: A seek didn't take over the waiting swap." << std::endl;
+        return 1;
+    }
+
+    // With the render cache on, dropping a voice that records for later repeats must not leave
+    // them replaying an entry that never completes
+    auto repeats = [](const std::string& first) {
+        std::string text = "tempo 125\ninstrument Bass {\n waveform triangle\n envelope 0.005 0.05 0.8 0.05\n}\nsequential {\n";
+        text += "Bass { notes " + first + " }\n";
+        for (int i = 0; i < 7; ++i) text += "Bass { notes C2(240) }\n";
+        return ScriptParser::parse_string(text + "}\n");
+    };
+    Song lengthened = repeats("C2(480)");
+    std::vector<float> lengthened_out = reference(lengthened);
+    AudioRenderer cached;
+    cached.load(repeats("C2(240)"), SAMPLE_RATE);
+    out.clear();
+    render(cached, out, 5);
+    cached.swap_song(cached.prepare_swap(lengthened), 120.0);
+    render(cached, out, 2000);
+    size_t cached_boundary = static_cast<size_t>(0.12 * SAMPLE_RATE) * 2;
+    faded = cached_boundary + static_cast<size_t>(AudioRenderer::SWAP_FADE_SECONDS * SAMPLE_RATE) * 2;
+    diff = first_difference(out, lengthened_out, faded, lengthened_out.size(), 1e-3f);
+    if (!cached.is_finished() || out.size() != lengthened_out.size() || diff >= 0) {
+        std::cerr << "FAILURE: Repeats of a dropped recording didn't play the edited song (" << out.size() << " vs "
+                  << lengthened_out.size() << " samples, first difference at " << diff << ")." << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: Live swaps keep unchanged voices and switch the rest on the beat." << std::endl;
+    return 0;
+}
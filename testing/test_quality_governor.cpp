@@ -0,0 +1,73 @@
+#include <iostream>
+#include "../src/QualityGovernor.h"
+
+int main() {
+    std::cout << "Testing adaptive quality governor..." << std::endl;
+    const double block = 512.0 / 44100.0;
+
+    QualityGovernor governor;
+    for (int i = 0; i < 1000; ++i) governor.update(0.2, block);
+    if (governor.get_level() != QualityLevel::FULL) {
+        std::cerr << "FAILURE: Quality was reduced under a light load." << std::endl;
+        return 1;
+    }
+
+    // A missed deadline steps down at once, but the next step waits for the first to take effect
+    governor.update(1.5, block);
+    if (governor.get_level() != QualityLevel::FAST_MATH) {
+        std::cerr << "FAILURE: A missed deadline didn't reduce quality." << std::endl;
+        return 1;
+    }
+    governor.update(1.5, block);
+    if (governor.get_level() != QualityLevel::FAST_MATH) {
+        std::cerr << "FAILURE: Quality dropped again before the last step could settle." << std::endl;
+        return 1;
+    }
+
+    // Sustained overload walks down to the last level and stays there
+    for (int i = 0; i < 1000; ++i) governor.update(1.2, block);
+    if (governor.get_level() != QualityLevel::DROP_QUIET) {
+        std::cerr << "FAILURE: Sustained overload didn't reach the lowest level." << std::endl;
+        return 1;
+    }
+
+    // Recovery takes RECOVER_SECONDS of low load per level
+    int blocks_to_recover = 0;
+    while (governor.get_level() == QualityLevel::DROP_QUIET && blocks_to_recover < 10000) {
+        governor.update(0.1, block);
+        blocks_to_recover++;
+    }
+    if (governor.get_level() != QualityLevel::SHORT_TAILS || blocks_to_recover * block < 1.9) {
+        std::cerr << "FAILURE: Quality came back too early (" << blocks_to_recover * block << " s)." << std::endl;
+        return 1;
+    }
+
+    // A load between the thresholds neither steps down nor recovers
+    for (int i = 0; i < 1000; ++i) governor.update(0.5, block);
+    if (governor.get_level() != QualityLevel::SHORT_TAILS) {
+        std::cerr << "FAILURE: A moderate load changed the quality level." << std::endl;
+        return 1;
+    }
+
+    for (int i = 0; i < 10000; ++i) governor.update(0.1, block);
+    if (governor.get_level() != QualityLevel::FULL) {
+        std::cerr << "FAILURE: Full quality wasn't restored." << std::endl;
+        return 1;
+    }
+
+    // Rendering ahead, slow blocks only count once the buffer runs low
+    QualityGovernor buffered;
+    for (int i = 0; i < 1000; ++i) buffered.update(1.5, block, 0.9);
+    if (buffered.get_level() != QualityLevel::FULL) {
+        std::cerr << "FAILURE: Quality was reduced while the render-ahead buffer was full." << std::endl;
+        return 1;
+    }
+    buffered.update(1.5, block, 0.3);
+    if (buffered.get_level() != QualityLevel::FAST_MATH) {
+        std::cerr << "FAILURE: A draining buffer didn't reduce quality." << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: Quality steps down under load and recovers." << std::endl;
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <cmath>
+#include <filesystem>
+#include "../src/ScriptParser.h"
+#include "../src/AudioRenderer.h"
+
+int main() {
+    std::cout << "Testing Render Cache..." << std::endl;
+
+    ScriptParser::set_global_bpm(120);
+
+    std::string script = R"(
+        instrument Hat {
+            waveform square
+            envelope 0.001 0.05 0.0 0.05
+            effect delay 125 0.3
+        }
+        instrument Bass {
+            waveform sawtooth
+            filter lowpass 800 1.5
+        }
+        function Pattern {
+            parallel {
+                Hat { notes C6_8*4 }
+                Bass { notes C2_4 G1_4 }
+            }
+        }
+        repeat 8 {
+            call Pattern()
+        }
+    )";
+
+    Song song = ScriptParser::parse_string(script);
+
+    AudioRenderer uncached;
+    uncached.set_render_cache_enabled(false);
+    std::vector<float> reference = uncached.render(song, 44100.0f);
+
+    AudioRenderer cached;
+    std::vector<float> result = cached.render(song, 44100.0f);
+
+    if (reference.size() != result.size()) {
+        std::cerr << "FAILURE: Length mismatch " << reference.size() << " vs " << result.size() << std::endl;
+        return 1;
+    }
+    for (size_t i = 0; i < reference.size(); ++i) {
+        if (std::abs(reference[i] - result[i]) > 1e-6f) {
+            std::cerr << "FAILURE: Cached render differs at sample " << i << std::endl;
+            return 1;
+        }
+    }
+
+    // 8 repeats x 2 tracks: the first two occurrences of each track are synthesized, the rest replayed
+    size_t hits = cached.get_render_cache_hits();
+    std::cout << "Cache hits (expected 12): " << hits << std::endl;
+    if (hits != 12) {
+        std::cerr << "FAILURE: Unexpected cache hit count." << std::endl;
+        return 1;
+    }
+
+    // Disk cache: a second run replays every track from disk
+    std::filesystem::path cache_dir = std::filesystem::temp_directory_path() / "museq_render_cache_test";
+    std::filesystem::remove_all(cache_dir);
+
+    AudioRenderer first_run;
+    first_run.set_cache_dir(cache_dir.string());
+    first_run.render(song, 44100.0f);
+
+    AudioRenderer second_run;
+    second_run.set_cache_dir(cache_dir.string());
+    std::vector<float> from_disk = second_run.render(song, 44100.0f);
+    size_t disk_hits = second_run.get_render_cache_hits();
+    std::filesystem::remove_all(cache_dir);
+
+    std::cout << "Disk cache hits (expected 16): " << disk_hits << std::endl;
+    if (disk_hits != 16 || from_disk.size() != reference.size()) {
+        std::cerr << "FAILURE: Second run was not served from the disk cache." << std::endl;
+        return 1;
+    }
+    for (size_t i = 0; i < reference.size(); ++i) {
+        if (std::abs(reference[i] - from_disk[i]) > 1e-6f) {
+            std::cerr << "FAILURE: Disk cached render differs at sample " << i << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "SUCCESS: Cached voices replay identically." << std::endl;
+    return 0;
+}
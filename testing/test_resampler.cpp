@@ -0,0 +1,82 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "../src/Resampler.h"
+#include "../src/AudioRenderer.h"
+#include "../src/ScriptParser.h"
+
+namespace {
+    const double PI = 3.14159265358979323846;
+}
+
+int main() {
+    std::cout << "Testing Resampler..." << std::endl;
+
+    // Two tones through common rate pairs, compared with the tones evaluated at the output rate
+    const double rates[][2] = { { 44100, 48000 }, { 48000, 44100 }, { 44100, 96000 }, { 96000, 44100 }, { 22050, 44100 } };
+    for (const auto& pair : rates) {
+        int frames = static_cast<int>(pair[0]);
+        std::vector<float> input(frames * 2);
+        for (int i = 0; i < frames; ++i) {
+            input[i * 2] = static_cast<float>(std::sin(2.0 * PI * 1000.0 * i / pair[0]));
+            input[i * 2 + 1] = static_cast<float>(0.5 * std::cos(2.0 * PI * 5000.0 * i / pair[0]));
+        }
+        std::vector<float> output = Resampler::convert(input, pair[0], pair[1]);
+        long expected_frames = static_cast<long>(std::ceil(frames * pair[1] / pair[0]));
+        if (static_cast<long>(output.size() / 2) != expected_frames) {
+            std::cerr << "FAILURE: " << pair[0] << " -> " << pair[1] << " gave " << output.size() / 2 << " frames." << std::endl;
+            return 1;
+        }
+        double max_error = 0;
+        for (long i = 100; i < expected_frames - 100; ++i) {
+            double t = i / pair[1];
+            max_error = (std::max)(max_error, std::abs(output[i * 2] - std::sin(2.0 * PI * 1000.0 * t)));
+            max_error = (std::max)(max_error, std::abs(output[i * 2 + 1] - 0.5 * std::cos(2.0 * PI * 5000.0 * t)));
+        }
+        std::cout << pair[0] << " -> " << pair[1] << " error (expected < 1e-4): " << max_error << std::endl;
+        if (max_error > 1e-4) {
+            std::cerr << "FAILURE: Converted tones don't match." << std::endl;
+            return 1;
+        }
+
+        // Streaming in uneven blocks gives the same frames
+        Resampler streaming(pair[0], pair[1]);
+        std::vector<float> streamed;
+        for (int start = 0, block = 1; start < frames; start += block, block = block * 3 % 1000 + 1) {
+            streaming.process(input.data() + start * 2, (std::min)(block, frames - start), streamed);
+        }
+        streaming.flush(streamed);
+        if (streamed != output) {
+            std::cerr << "FAILURE: Streaming conversion differs from whole-buffer conversion." << std::endl;
+            return 1;
+        }
+    }
+
+    // A renderer synthesizing at a fixed internal rate streams at the requested output rate
+    Song song = ScriptParser::parse_string(R"(
+        instrument Lead { waveform sine }
+        Lead { notes C4 E4 G4 }
+    )");
+    AudioRenderer direct;
+    direct.set_render_cache_enabled(false);
+    std::vector<float> reference = direct.render(song, 48000.0f);
+
+    AudioRenderer converted;
+    converted.set_render_cache_enabled(false);
+    converted.set_internal_rate(44100.0f);
+    converted.load(song, 48000.0f);
+    std::vector<float> streamed;
+    float block[300 * 2];
+    while (!converted.is_finished()) {
+        converted.render_block(block, 300);
+        streamed.insert(streamed.end(), block, block + 600);
+    }
+    if (converted.get_render_rate() != 44100.0f || std::abs(static_cast<long>(streamed.size()) - static_cast<long>(reference.size())) > 2 * 600) {
+        std::cerr << "FAILURE: Expected about " << reference.size() / 2 << " frames at 48kHz, got " << streamed.size() / 2 << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: Resampler converts accurately between rates." << std::endl;
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../src/ScopeBus.h"
+
+// Frame n of the test signal: left is n, right is -n, so a reader can check every frame it gets
+static void fill(std::vector<float>& stereo, int first, int frames) {
+    stereo.resize(frames * 2);
+    for (int i = 0; i < frames; ++i) {
+        stereo[i * 2] = static_cast<float>(first + i);
+        stereo[i * 2 + 1] = -static_cast<float>(first + i);
+    }
+}
+
+int main() {
+    std::cout << "Testing scope bus..." << std::endl;
+    std::vector<float> block, out(2048 * 2);
+
+    // Decimation keeps every n-th frame, also across block boundaries
+    ScopeTap tap(256);
+    tap.set_decimation(3);
+    int written = 0;
+    for (int frames : { 7, 100, 1, 2000, 333 }) {
+        fill(block, written, frames);
+        tap.write(block.data(), frames);
+        written += frames;
+    }
+    int got = tap.snapshot(out.data(), 2048);
+    if (got != 256 || tap.get_frames_kept() != static_cast<uint64_t>((written + 2) / 3)) {
+        std::cerr << "FAILURE: Decimated tap kept " << tap.get_frames_kept() << " frames, snapshot has " << got << std::endl;
+        return 1;
+    }
+    int newest = (written - 1) / 3 * 3;
+    for (int i = 0; i < got; ++i) {
+        float expected = static_cast<float>(newest - (got - 1 - i) * 3);
+        if (out[i * 2] != expected || out[i * 2 + 1] != -expected) {
+            std::cerr << "FAILURE: Frame " << i << " of the decimated snapshot is " << out[i * 2] << ", expected " << expected << std::endl;
+            return 1;
+        }
+    }
+
+    // A writer racing readers: every snapshot and every streamed frame must be a run of consecutive frames
+    ScopeBus bus(512, 256);
+    std::atomic<bool> writing{ true };
+    std::thread writer([&]() {
+        std::vector<float> data;
+        int position = 0;
+        for (int n = 0; n < 20000; ++n) {
+            int frames = 1 + (n * 37) % 300;
+            fill(data, position, frames);
+            bus.tap(ScopeBus::MASTER).write(data.data(), frames);
+            position += frames;
+        }
+        writing = false;
+    });
+
+    bool ok = true;
+    int snapshots = 0;
+    uint64_t stream_position = 0;
+    float last_streamed = -1.0f;
+    std::vector<float> snapshot(512 * 2), stream(100 * 2);
+    while (writing && ok) {
+        int frames = bus.tap(ScopeBus::MASTER).snapshot(snapshot.data(), 512);
+        for (int i = 1; i < frames && ok; ++i) {
+            ok = snapshot[i * 2] == snapshot[i * 2 - 2] + 1 && snapshot[i * 2 + 1] == -snapshot[i * 2];
+        }
+        if (frames > 0) snapshots++;
+
+        uint64_t before = stream_position;
+        int streamed = bus.tap(ScopeBus::MASTER).read_since(stream_position, stream.data(), 100);
+        for (int i = 0; i < streamed && ok; ++i) {
+            // Skips are allowed (the reader fell behind), going backwards or tearing is not
+            ok = stream[i * 2] > last_streamed && stream[i * 2] == static_cast<float>(stream_position - streamed + i)
+                && stream[i * 2 + 1] == -stream[i * 2];
+            last_streamed = stream[i * 2];
+        }
+        ok = ok && stream_position >= before;
+    }
+    writer.join();
+    if (!ok || snapshots == 0) {
+        std::cerr << "FAILURE: A reader saw a torn or out-of-order copy (" << snapshots << " snapshots)." << std::endl;
+        return 1;
+    }
+
+    // Track taps are handed out by name and released for the next song
+    int drums = bus.find_or_assign_track("Drums");
+    int bass = bus.find_or_assign_track("Bass");
+    const ScopeBus::Layout& layout = bus.read_layout();
+    if (drums != 1 || bass != 2 || bus.find_or_assign_track("Drums") != 1 || layout.count != 3 || std::string(layout.names[2]) != "Bass") {
+        std::cerr << "FAILURE: Track taps weren't assigned by name." << std::endl;
+        return 1;
+    }
+    fill(block, 1, 64);
+    bus.tap(bass).write(block.data(), 64);
+    bus.release_tracks();
+    if (bus.read_layout().count != 1 || bus.tap(bass).snapshot(out.data(), 64) != 64 || out[127] != 0.0f) {
+        std::cerr << "FAILURE: Released track taps still hold the old song." << std::endl;
+        return 1;
+    }
+    for (int i = 0; i < ScopeBus::MAX_TAPS + 4; ++i) bus.find_or_assign_track("Track " + std::to_string(i));
+    if (bus.get_track_count() != ScopeBus::MAX_TAPS - 1 || bus.find_or_assign_track("One more") != -1) {
+        std::cerr << "FAILURE: More track taps were handed out than exist." << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: Scope taps decimate, stay consistent under a racing writer and are assigned by name." << std::endl;
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <cmath>
+#include "../src/ScriptParser.h"
+#include "../src/SongScheduler.h"
+
+int main() {
+    std::cout << "Testing Lazy Song Scheduler..." << std::endl;
+
+    ScriptParser::set_global_bpm(120);
+
+    // 4 sequential notes of 500ms each, followed by a parallel block at 2000ms
+    std::string script = R"(
+        instrument Lead { waveform sine }
+        instrument Pad { waveform triangle }
+        sequential {
+            Lead { notes C4 D4 E4 F4 }
+            parallel {
+                Lead { notes G4 }
+                Pad { notes C3 }
+            }
+        }
+    )";
+
+    Song song = ScriptParser::parse_string(script);
+
+    SongScheduler scheduler;
+    scheduler.reset(song.root);
+
+    // Nothing beyond the first second should be expanded yet
+    std::vector<ScheduledEvent> events;
+    scheduler.advance(1000.0, events);
+    if (events.size() != 1 || events[0].start_ms != 0.0) {
+        std::cerr << "FAILURE: Expected only the first track inside a 1000ms window, got " << events.size() << std::endl;
+        return 1;
+    }
+    if (scheduler.is_exhausted()) {
+        std::cerr << "FAILURE: Scheduler exhausted before the parallel block was reached." << std::endl;
+        return 1;
+    }
+
+    scheduler.advance(1e9, events);
+    if (events.size() != 3) {
+        std::cerr << "FAILURE: Expected 3 scheduled tracks, got " << events.size() << std::endl;
+        return 1;
+    }
+    for (size_t i = 1; i < events.size(); ++i) {
+        if (events[i].start_ms < events[i - 1].start_ms) {
+            std::cerr << "FAILURE: Events are not in start order." << std::endl;
+            return 1;
+        }
+    }
+    if (events[1].start_ms != 2000.0 || events[2].start_ms != 2000.0) {
+        std::cerr << "FAILURE: Parallel block should start at 2000ms, got " << events[1].start_ms << std::endl;
+        return 1;
+    }
+    if (!scheduler.is_exhausted()) {
+        std::cerr << "FAILURE: Scheduler should be exhausted." << std::endl;
+        return 1;
+    }
+
+    // Song end = 2500ms of notes + default 0.2s release tail
+    double end_ms = SongScheduler::compute_end_ms(song.root);
+    std::cout << "Computed end (expected ~2700): " << end_ms << std::endl;
+    if (std::abs(end_ms - 2700.0) > 0.01) {
+        std::cerr << "FAILURE: Unexpected song end " << end_ms << std::endl;
+        return 1;
+    }
+
+    // Auto-loop followers are scheduled once, however long the leader is
+    std::string loop_script = R"(
+        instrument Lead { waveform sine }
+        instrument Drum {
+            waveform square
+            envelope 0.01 0.1 0.8 0
+        }
+        function Beat {
+            Drum { notes C2 C2 }
+        }
+        loop start Beat
+            Lead { note C4 60000 100 }
+        loop stop
+    )";
+
+    Song loop_song = ScriptParser::parse_string(loop_script);
+    scheduler.reset(loop_song.root);
+    events.clear();
+    scheduler.advance(1e9, events);
+    if (events.size() != 2) {
+        std::cerr << "FAILURE: Expected leader + one looping follower, got " << events.size() << " events." << std::endl;
+        return 1;
+    }
+    const ScheduledEvent& follower = (events[0].loop_count > 1) ? events[0] : events[1];
+    if (follower.loop_count != 60 || follower.loop_period_ms != 1000.0) {
+        std::cerr << "FAILURE: Expected 60 iterations of 1000ms, got " << follower.loop_count
+                  << " x " << follower.loop_period_ms << "ms" << std::endl;
+        return 1;
+    }
+
+    // Iterations whose release rings into the next one take turns between voices, so no tail is cut
+    std::string tail_script = R"(
+        instrument Lead { waveform sine }
+        instrument Drum { waveform square }
+        function Beat {
+            Drum { notes C2 C2 }
+        }
+        loop start Beat
+            Lead { note C4 60000 100 }
+        loop stop
+    )";
+    scheduler.reset(ScriptParser::parse_string(tail_script).root);
+    events.clear();
+    scheduler.advance(1e9, events);
+    std::vector<const ScheduledEvent*> followers;
+    for (const auto& ev : events) {
+        if (ev.element->instrument.name == "Drum") followers.push_back(&ev);
+    }
+    if (followers.size() != 2 || followers[0]->start_ms != 0.0 || followers[1]->start_ms != 1000.0) {
+        std::cerr << "FAILURE: Expected two alternating follower voices, got " << followers.size() << std::endl;
+        return 1;
+    }
+    for (const ScheduledEvent* ev : followers) {
+        if (ev->loop_count != 30 || ev->loop_period_ms != 2000.0) {
+            std::cerr << "FAILURE: Expected 30 iterations of 2000ms per voice, got " << ev->loop_count
+                      << " x " << ev->loop_period_ms << "ms" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "SUCCESS: Song scheduled lazily and in order." << std::endl;
+    return 0;
+}
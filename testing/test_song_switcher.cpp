@@ -0,0 +1,146 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "../src/ScriptParser.h"
+#include "../src/SongSwitcher.h"
+
+namespace {
+    const float SAMPLE_RATE = 44100.0f;
+    const int BLOCK = 512;
+
+    Song song(const std::string& waveform) {
+        return ScriptParser::parse_string("instrument Lead {\n waveform " + waveform + "\n envelope 0.01 0.1 0.8 0.2\n}\n"
+                                          "Lead { notes C4(1000) E4(1000) G4(1000) }\n");
+    }
+
+    SongSwitcher::Request request(const std::string& waveform, double start_ms, uint64_t generation) {
+        SongSwitcher::Request r;
+        r.song = song(waveform);
+        r.rate = SAMPLE_RATE;
+        r.start_ms = start_ms;
+        r.generation = generation;
+        return r;
+    }
+
+    // 'blocks' blocks of a song played on its own
+    std::vector<float> reference(const std::string& waveform, double start_ms, int blocks) {
+        AudioRenderer renderer;
+        renderer.set_render_cache_enabled(false);
+        renderer.load(song(waveform), SAMPLE_RATE);
+        if (start_ms > 0) renderer.seek(start_ms);
+        std::vector<float> out(static_cast<size_t>(blocks) * BLOCK * 2);
+        for (int b = 0; b < blocks; ++b) renderer.render_block(out.data() + b * BLOCK * 2, BLOCK);
+        return out;
+    }
+}
+
+int main() {
+    std::cout << "Testing song switching..." << std::endl;
+
+    int standby_changes = 0;
+    SongSwitcher switcher([&] { standby_changes++; });
+    for (AudioRenderer& renderer : switcher.renderers()) renderer.set_render_cache_enabled(false);
+
+    // A song superseded while it loaded is never swapped in; the newest one is
+    uint64_t old_generation = switcher.begin_request();
+    uint64_t new_generation = switcher.begin_request();
+    AudioRenderer* silent = switcher.playing();
+    if (!switcher.can_load(old_generation) || !switcher.load(request("square", 0.0, old_generation))) {
+        std::cerr << "FAILURE: The standby renderer wasn't free to load." << std::endl;
+        return 1;
+    }
+    if (switcher.try_switch(0, 0) != SongSwitcher::SwitchResult::SUPERSEDED || switcher.playing() != silent ||
+        !switcher.is_switch_pending() || standby_changes != 1) {
+        std::cerr << "FAILURE: A superseded song was swapped in." << std::endl;
+        return 1;
+    }
+    if (!switcher.can_load(new_generation) || !switcher.load(request("sine", 0.0, new_generation)) ||
+        switcher.try_switch(0, 0) != SongSwitcher::SwitchResult::SWITCHED || switcher.playing() == silent ||
+        switcher.is_switch_pending() || switcher.is_fading()) {
+        std::cerr << "FAILURE: The newest song didn't take over." << std::endl;
+        return 1;
+    }
+    SongSwitcher::Marker marker;
+    if (switcher.take_switch(0, BLOCK, marker) != 0 || marker.frame != 0) {
+        std::cerr << "FAILURE: The first song's marker is missing." << std::endl;
+        return 1;
+    }
+
+    // Four blocks in, the next song starts 250 ms into itself and fades in over 700 frames
+    const int before = 4, after = 3, fade = 700;
+    std::vector<float> out(static_cast<size_t>(before + after) * BLOCK * 2);
+    for (int b = 0; b < before; ++b) switcher.render_block(out.data() + b * BLOCK * 2, BLOCK);
+    uint64_t generation = switcher.begin_request();
+    if (switcher.try_switch(before * BLOCK, fade) != SongSwitcher::SwitchResult::NONE || !switcher.load(request("triangle", 250.0, generation)) ||
+        switcher.try_switch(before * BLOCK, fade) != SongSwitcher::SwitchResult::SWITCHED || !switcher.is_fading()) {
+        std::cerr << "FAILURE: The second song didn't start a crossfade." << std::endl;
+        return 1;
+    }
+    for (int b = before; b < before + after; ++b) switcher.render_block(out.data() + b * BLOCK * 2, BLOCK);
+    if (switcher.is_fading() || standby_changes != 3) {
+        std::cerr << "FAILURE: The crossfade didn't end after " << fade << " frames." << std::endl;
+        return 1;
+    }
+
+    std::vector<float> first = reference("sine", 0.0, before + after);
+    std::vector<float> second = reference("triangle", 250.0, after);
+    for (size_t i = 0; i < out.size(); ++i) {
+        int frame = static_cast<int>(i / 2) - before * BLOCK;
+        float expected = first[i];
+        if (frame >= 0) {
+            float fade_in, fade_out;
+            SongSwitcher::crossfade_gains(frame, fade, fade_in, fade_out);
+            expected = (frame < fade) ? second[frame * 2 + i % 2] * fade_in + first[i] * fade_out : second[frame * 2 + i % 2];
+        }
+        if (out[i] != expected) {
+            std::cerr << "FAILURE: Output differs from the crossfaded songs at frame " << i / 2 << std::endl;
+            return 1;
+        }
+    }
+
+    // Equal power all the way through, from the old song to the new one
+    float fade_in, fade_out;
+    SongSwitcher::crossfade_gains(0, fade, fade_in, fade_out);
+    float start_in = fade_in, start_out = fade_out;
+    SongSwitcher::crossfade_gains(fade - 1, fade, fade_in, fade_out);
+    if (start_in > 0.01f || start_out < 0.99f || fade_in < 0.99f || fade_out > 0.01f) {
+        std::cerr << "FAILURE: The crossfade doesn't run from the old song to the new one." << std::endl;
+        return 1;
+    }
+    for (int f = 0; f < fade; ++f) {
+        SongSwitcher::crossfade_gains(f, fade, fade_in, fade_out);
+        if (std::abs(fade_in * fade_in + fade_out * fade_out - 1.0f) > 1e-5f) {
+            std::cerr << "FAILURE: The crossfade isn't equal-power at frame " << f << std::endl;
+            return 1;
+        }
+    }
+
+    // The consumer plays up to the marker frame, then moves the playhead on exactly that frame
+    uint64_t read = 1500;
+    size_t frames = switcher.take_switch(read, 1024, marker);
+    if (frames != static_cast<size_t>(before * BLOCK) - read) {
+        std::cerr << "FAILURE: " << frames << " frames would play before the switch, expected " << before * BLOCK - read << std::endl;
+        return 1;
+    }
+    read += frames;
+    if (switcher.take_switch(read, 1024, marker) != 0 || marker.frame != static_cast<uint64_t>(before * BLOCK) || marker.start_ms != 250.0) {
+        std::cerr << "FAILURE: The switch wasn't reported on its frame." << std::endl;
+        return 1;
+    }
+    if (switcher.take_switch(read, 1024, marker) != 1024) {
+        std::cerr << "FAILURE: A switch was reported twice." << std::endl;
+        return 1;
+    }
+
+    // Dropped audio skips the switches in it
+    generation = switcher.begin_request();
+    switcher.load(request("sawtooth", 0.0, generation));
+    switcher.try_switch(5000, 0);
+    if (!switcher.drain_switches(marker) || marker.frame != 5000 || switcher.drain_switches(marker)) {
+        std::cerr << "FAILURE: Draining didn't skip the queued switch." << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: Songs switch on their frame, newest first, with an equal-power crossfade." << std::endl;
+    return 0;
+}
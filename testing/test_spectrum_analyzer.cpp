@@ -0,0 +1,75 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "../src/SpectrumAnalyzer.h"
+
+int main() {
+    std::cout << "Testing spectrum analyzer..." << std::endl;
+    const double PI = 3.14159265358979323846;
+    const float rate = 48000.0f;
+
+    SpectrumAnalyzer analyzer;
+    analyzer.configure(2000, 0.75f, rate);
+    if (analyzer.get_size() != 2048 || analyzer.get_hop() != 512) {
+        std::cerr << "FAILURE: Size isn't rounded to a power of two or the hop is wrong." << std::endl;
+        return 1;
+    }
+
+    // A sine centred on bin 100, fed in odd-sized pieces: one frame per hop once the first is full
+    const float bin_hz = rate / 2048;
+    std::vector<float> signal(48000);
+    for (size_t i = 0; i < signal.size(); ++i) signal[i] = 0.5f * static_cast<float>(std::sin(2.0 * PI * 100 * bin_hz * i / rate));
+    int frames = 0;
+    for (size_t pos = 0; pos < signal.size(); pos += 333) {
+        frames += analyzer.push(signal.data() + pos, static_cast<int>((std::min)(static_cast<size_t>(333), signal.size() - pos)));
+    }
+    int expected_frames = (48000 - 2048) / 512 + 1;
+    if (frames != expected_frames) {
+        std::cerr << "FAILURE: Analyzed " << frames << " frames, expected " << expected_frames << std::endl;
+        return 1;
+    }
+
+    const Spectrum& spectrum = analyzer.read();
+    if (spectrum.magnitudes.size() != 1025 || spectrum.frame != static_cast<uint64_t>(frames)) {
+        std::cerr << "FAILURE: The reader didn't get the newest spectrum." << std::endl;
+        return 1;
+    }
+    size_t peak = 0;
+    for (size_t k = 1; k < spectrum.magnitudes.size(); ++k) {
+        if (spectrum.magnitudes[k] > spectrum.magnitudes[peak]) peak = k;
+    }
+    if (peak != 100 || std::abs(spectrum.magnitudes[peak] - 0.5f) > 0.01f || spectrum.magnitudes[300] > 1e-4f) {
+        std::cerr << "FAILURE: Sine reads " << spectrum.magnitudes[peak] << " at bin " << peak << std::endl;
+        return 1;
+    }
+
+    // Log bands: the sine (about 2.3 kHz) lands in one band, the bands far from it stay empty
+    float bands[30];
+    spectrum.to_log_bands(bands, 30, 20.0f, 20000.0f);
+    double ratio = std::log(1000.0) / 30;
+    int sine_band = static_cast<int>(std::log(100 * bin_hz / 20.0) / ratio);
+    for (int b = 0; b < 30; ++b) {
+        bool near = std::abs(b - sine_band) <= 1;
+        if ((b == sine_band && bands[b] < 0.05f) || (!near && bands[b] > 0.01f)) {
+            std::cerr << "FAILURE: Band " << b << " reads " << bands[b] << " (sine in band " << sine_band << ")" << std::endl;
+            return 1;
+        }
+    }
+
+    // At 16 kHz the bands above 8 kHz are past Nyquist and read nothing, even next to a loud tone
+    SpectrumAnalyzer narrow;
+    narrow.configure(2048, 0.5f, 16000.0f);
+    std::vector<float> high(16000);
+    for (size_t i = 0; i < high.size(); ++i) high[i] = 0.9f * static_cast<float>(std::sin(2.0 * PI * 7900.0 * i / 16000.0));
+    narrow.push(high.data(), static_cast<int>(high.size()));
+    narrow.read().to_log_bands(bands, 30, 20.0f, 20000.0f);
+    for (int b = 0; b < 30; ++b) {
+        if (20.0 * std::exp(ratio * b) >= 8000.0 && bands[b] != 0.0f) {
+            std::cerr << "FAILURE: Band " << b << " above Nyquist reads " << bands[b] << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "SUCCESS: Spectrum frames, levels and log bands are right." << std::endl;
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "../src/SpscRing.h"
+
+int main() {
+    std::cout << "Testing SPSC ring buffer..." << std::endl;
+
+    SpscRing<float> ring(1000);
+    if (ring.get_capacity() != 1024 || ring.get_read_available() != 0 || ring.get_write_available() != 1024) {
+        std::cerr << "FAILURE: Capacity isn't rounded up to a power of two." << std::endl;
+        return 1;
+    }
+
+    // Writes stop at the capacity, reads at what was written
+    std::vector<float> block(1500, 1.0f);
+    if (ring.write(block.data(), block.size()) != 1024 || ring.read(block.data(), 2000) != 1024) {
+        std::cerr << "FAILURE: Partial writes and reads are wrong." << std::endl;
+        return 1;
+    }
+
+    // A producer and a consumer thread pass a counting sequence through with odd block sizes,
+    // so the indices wrap many times at every offset
+    const int total = 2000000;
+    std::thread producer([&] {
+        std::vector<float> chunk(37);
+        int next = 0;
+        while (next < total) {
+            int count = (std::min)(static_cast<int>(chunk.size()), total - next);
+            for (int i = 0; i < count; ++i) chunk[i] = static_cast<float>(next + i);
+            size_t written = 0;
+            while (written < static_cast<size_t>(count)) written += ring.write(chunk.data() + written, count - written);
+            next += count;
+        }
+    });
+
+    std::vector<float> chunk(53);
+    int expected = 0;
+    bool in_order = true;
+    while (expected < total) {
+        size_t got = ring.read(chunk.data(), chunk.size());
+        for (size_t i = 0; i < got; ++i) {
+            if (chunk[i] != static_cast<float>(expected)) in_order = false;
+            expected++;
+        }
+    }
+    producer.join();
+
+    if (!in_order || ring.get_read_available() != 0) {
+        std::cerr << "FAILURE: Items were lost, duplicated or reordered between the threads." << std::endl;
+        return 1;
+    }
+
+    // discard() drops everything buffered
+    ring.write(block.data(), 100);
+    ring.discard();
+    if (ring.get_read_available() != 0) {
+        std::cerr << "FAILURE: discard() left items behind." << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: Items pass between threads in order without loss." << std::endl;
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <iostream>
+#include <algorithm>
+#include "../src/ScriptParser.h"
+#include "../src/AudioRenderer.h"
+
+int main() {
+    std::cout << "Testing Voice Pool and Shared Patches..." << std::endl;
+
+    ScriptParser::set_global_bpm(120);
+
+    // 32 bars of two instruments: every repeat creates new song elements with identical patches
+    std::string script = R"(
+        instrument Lead {
+            waveform sawtooth
+            filter lowpass 1200 1.2
+        }
+        instrument Bass {
+            waveform square
+        }
+        repeat 32 {
+            parallel {
+                Lead { notes C4 E4 G4 C5 }
+                Bass { notes C2_1 }
+            }
+        }
+    )";
+
+    Song song = ScriptParser::parse_string(script);
+
+    AudioRenderer renderer;
+    renderer.set_render_cache_enabled(false);
+    renderer.set_lookahead_ms(500.0);
+    renderer.load(song, 44100.0f);
+
+    float block[1024];
+    size_t max_capacity = 0;
+    while (!renderer.is_finished()) {
+        renderer.render_block(block, 512);
+        max_capacity = std::max(max_capacity, renderer.get_voice_pool_capacity());
+    }
+
+    size_t patches = renderer.get_patch_count();
+    std::cout << "Patches (expected 2): " << patches << ", pool slots used: " << max_capacity << std::endl;
+    if (patches != 2) {
+        std::cerr << "FAILURE: Identical instruments were not shared." << std::endl;
+        return 1;
+    }
+    // Only the voices inside the look-ahead window hold a slot, and finished voices hand theirs back
+    if (max_capacity > 8) {
+        std::cerr << "FAILURE: Voice pool kept growing (" << max_capacity << " slots for 64 voices)." << std::endl;
+        return 1;
+    }
+
+    std::cout << "SUCCESS: Voices share patches and reuse pool slots." << std::endl;
+    return 0;
+}